@@ -10,12 +10,7 @@ const vec2 OFFSETS[6] = vec2[](
 );
 
 layout(location = 0) out vec2 fragOffset;
-
-struct PointLight
-{
-    vec4 position; // ignore w
-    vec4 color; // w is intensity
-};
+layout(location = 1) flat out vec4 fragColor;
 
 // set0 per frame
 layout(set = 0, binding = 0) uniform GlobalUbo
@@ -24,27 +19,34 @@ layout(set = 0, binding = 0) uniform GlobalUbo
     mat4 viewMatrix;
     mat4 inverseViewMatrix;
     vec4 ambientLightColor; // w is intensity
-    PointLight PointLights[10];
-    int numLights;
+    uvec4 clusterGrid; // cluster counts x, y, z, w is the light count
+    vec4 clusterDepth; // near, far, slice scale, slice bias
 } ubo;
 
-// set1 per object
-layout(set = 1, binding = 0) uniform PerObjectUbo
+struct PointLightInstance
+{
+    vec4 position; // w is radius
+    vec4 color; // w is intensity
+};
+
+// set1 per draw: every light of the frame, sorted back to front, one instance each
+layout(set = 1, binding = 0) readonly buffer LightSsbo
 {
-    vec4 position;
-    vec4 color;
-    float radius;
-} perObjectUbo;
+    PointLightInstance lights[];
+} lightSsbo;
 
 void main()
 {
+    PointLightInstance light = lightSsbo.lights[gl_InstanceIndex];
     fragOffset = OFFSETS[gl_VertexIndex];
+    fragColor = light.color;
     vec3 cameraRightWorld = {ubo.viewMatrix[0][0], ubo.viewMatrix[1][0], ubo.viewMatrix[2][0]};
     vec3 cameraUpWorld = {ubo.viewMatrix[0][1], ubo.viewMatrix[1][1], ubo.viewMatrix[2][1]};
 
-    vec3 positionWorld = perObjectUbo.position.xyz
-        + perObjectUbo.radius * fragOffset.x * cameraRightWorld
-        + perObjectUbo.radius * fragOffset.y * cameraUpWorld;
+    float radius = light.position.w;
+    vec3 positionWorld = light.position.xyz
+        + radius * fragOffset.x * cameraRightWorld
+        + radius * fragOffset.y * cameraUpWorld;
 
     gl_Position = ubo.projectionMatrix * ubo.viewMatrix * vec4(positionWorld, 1.0f);
 }
@@ -9,12 +9,6 @@ layout(location = 3) in vec2 fragTexCoord;
 // output
 layout (location = 0) out vec4 outColor;
 
-struct PointLight
-{
-    vec4 position; // ignore w
-    vec4 color; // w is intensity
-};
-
 // set0: per frame constant
 layout(set = 0, binding = 0) uniform GlobalUbo
 {
@@ -22,15 +16,40 @@ layout(set = 0, binding = 0) uniform GlobalUbo
     mat4 viewMatrix;
     mat4 inverseViewMatrix;
     vec4 ambientLightColor; // w is intensity
-    PointLight PointLights[10];
-    int numLights;
+    uvec4 clusterGrid; // cluster counts x, y, z, w is the light count
+    vec4 clusterDepth; // near, far, slice scale, slice bias
 } ubo;
 
-// set2: per material constant
+struct PointLight
+{
+    vec4 position; // w is the range
+    vec4 color; // w is intensity
+};
+
+// set0: this frame's lights and their clusters (LightClusterGrid), every cluster lists the lights reaching it
+layout(std430, set = 0, binding = 1) readonly buffer ClusterLightSsbo
+{
+    PointLight lights[];
+} clusterLightSsbo;
+
+layout(std430, set = 0, binding = 2) readonly buffer ClusterSsbo
+{
+    uvec2 ranges[]; // offset, count into lightIndices
+} clusterSsbo;
+
+layout(std430, set = 0, binding = 3) readonly buffer ClusterLightIndexSsbo
+{
+    uint lightIndices[];
+} clusterLightIndexSsbo;
+
+// set2: per material constant, the vertex dequantization is read by the vertex shaders
 layout(set = 2, binding = 0) uniform MaterialUbo
 {
     vec4 final_ambient; // ignore w
     float blinnFactor;
+    vec4 positionScale; // ignore w
+    vec4 positionOffset; // ignore w
+    vec4 uvScaleOffset; // xy scale, zw offset
 } ubo2;
 layout(set = 2, binding = 1) uniform sampler2D mapKa;
 layout(set = 2, binding = 2) uniform sampler2D metallicMap;
@@ -78,6 +97,20 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
     return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 // ----------------------------------------------------------------------------
+// same mapping as LightClusterGrid on the cpu: ndc tile in x / y, logarithmic slice of the view depth
+uint clusterIndex(vec3 posWorld)
+{
+    vec4 posView = ubo.viewMatrix * vec4(posWorld, 1.0);
+    vec4 posClip = ubo.projectionMatrix * posView;
+    vec2 ndc = posClip.xy / posClip.w;
+
+    uvec3 grid = ubo.clusterGrid.xyz;
+    uvec2 tile = uvec2(clamp(floor((ndc * 0.5 + 0.5) * vec2(grid.xy)), vec2(0.0), vec2(grid.xy) - 1.0));
+    float slice = floor(log(max(posView.z, ubo.clusterDepth.x)) * ubo.clusterDepth.z + ubo.clusterDepth.w);
+    uint z = uint(clamp(slice, 0.0, float(grid.z) - 1.0));
+    return tile.x + grid.x * (tile.y + grid.y * z);
+}
+// ----------------------------------------------------------------------------
 
 
 void main()
@@ -97,15 +130,19 @@ void main()
 
     // reflectance equation
     vec3 Lo = vec3(0.0);
-    for(int i=0; i < ubo.numLights; i++)
+    // only the lights whose range reaches this fragment's cluster
+    uvec2 cluster = clusterSsbo.ranges[clusterIndex(fragPosWorld)];
+    for(uint i = 0; i < cluster.y; i++)
     {
-        PointLight light = ubo.PointLights[i];
+        PointLight light = clusterLightSsbo.lights[clusterLightIndexSsbo.lightIndices[cluster.x + i]];
 
         // calculate per-light radiance
         vec3 L = normalize(light.position.xyz - fragPosWorld);
         vec3 H = normalize(V + L);
         float distance = length(light.position.xyz - fragPosWorld);
-        float attenuation = 1.0 / (distance * distance);
+        // inverse square falloff, windowed to reach zero at the light's range so the cluster cut is invisible
+        float falloff = clamp(1.0 - pow(distance / light.position.w, 4.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (distance * distance);
         vec3 radiance = light.color.xyz * light.color.w * attenuation;
 
         // Cook-Torrance BRDF
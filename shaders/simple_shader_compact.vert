@@ -0,0 +1,14 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// LveModel::VertexFormat::Compact: snorm16 position, octahedral snorm16 normal, unorm16 uv, no color stream
+layout(location = 0) in vec4 position;
+layout(location = 2) in vec2 normal;
+layout(location = 3) in vec2 uv;
+
+#include "simple_shader_vertex.glsl"
+
+void main()
+{
+    writeVertex(dequantizePosition(position.xyz), vec3(1.0f), decodeOctahedral(normal), dequantizeUv(uv));
+}
@@ -0,0 +1,15 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// LveModel::VertexFormat::CompactColor: Compact plus an unorm8 rgba color stream
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 normal;
+layout(location = 3) in vec2 uv;
+
+#include "simple_shader_vertex.glsl"
+
+void main()
+{
+    writeVertex(dequantizePosition(position.xyz), color.rgb, decodeOctahedral(normal), dequantizeUv(uv));
+}
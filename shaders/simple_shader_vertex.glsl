@@ -0,0 +1,79 @@
+// shared by the simple_shader*.vert variants, one per LveModel::VertexFormat. They decode their vertex
+// inputs and hand local space attributes to writeVertex
+
+// vertex output layout
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragTexCoord;
+
+// set0: per frame constant
+layout(set = 0, binding = 0) uniform GlobalUbo
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 inverseViewMatrix;
+    vec4 ambientLightColor; // w is intensity
+    uvec4 clusterGrid; // cluster counts x, y, z, w is the light count
+    vec4 clusterDepth; // near, far, slice scale, slice bias
+} ubo;
+
+struct PerObjectData
+{
+    mat4 modelMatrix; // model
+    mat4 normalMatrix;
+};
+
+// set1 binding0: object index per instance, the dynamic offset points at the first instance of the draw,
+// or at the draw table's instances when cull.comp wrote the draws (firstInstance is the table instance)
+layout(std430, set = 1, binding = 0) readonly buffer InstanceSsbo
+{
+    uint objectIndices[];
+} instanceSsbo;
+
+// set1 binding1: persistent per object data, only rewritten when the object's transform changed
+layout(std430, set = 1, binding = 1) readonly buffer ObjectSsbo
+{
+    PerObjectData objects[];
+} objectSsbo;
+
+// set2: per material constant, also holds the submesh's vertex dequantization
+layout(set = 2, binding = 0) uniform MaterialUbo
+{
+    vec4 final_ambient; // ignore w
+    float blinnFactor;
+    vec4 positionScale; // ignore w
+    vec4 positionOffset; // ignore w
+    vec4 uvScaleOffset; // xy scale, zw offset
+} ubo2;
+
+vec3 dequantizePosition(vec3 position)
+{
+    return position * ubo2.positionScale.xyz + ubo2.positionOffset.xyz;
+}
+
+vec2 dequantizeUv(vec2 uv)
+{
+    return uv * ubo2.uvScaleOffset.xy + ubo2.uvScaleOffset.zw;
+}
+
+// inverse of encodeOctahedral in lve_model.cpp
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+void writeVertex(vec3 position, vec3 color, vec3 normal, vec2 uv)
+{
+    PerObjectData perObject = objectSsbo.objects[instanceSsbo.objectIndices[gl_InstanceIndex]];
+    vec4 positionWorld = perObject.modelMatrix * vec4(position, 1.0f); // position is a column vector
+    gl_Position = ubo.projectionMatrix * ubo.viewMatrix * positionWorld;
+    fragNormalWorld = normalize(mat3(perObject.normalMatrix) * normal);
+    fragPosWorld = positionWorld.xyz;
+    fragColor = color;
+    fragTexCoord = uv;
+}
@@ -1,6 +1,6 @@
 
 rule("ShaderCompile")
-    set_extensions(".frag", ".vert")
+    set_extensions(".frag", ".vert", ".comp")
     on_build_file(function (target, sourcefile, opt)
         -- find path of vulkan_sdk, and get path of glslangValidator.exe
         local vulkan_sdk = find_package("vulkansdk") 
@@ -26,4 +26,4 @@ rule("ShaderCompile")
 target("shader")
     set_kind("object")
     add_rules("ShaderCompile")
-    add_files("*.vert", "*.frag")
\ No newline at end of file
+    add_files("*.vert", "*.frag", "*.comp")
\ No newline at end of file
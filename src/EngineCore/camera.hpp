@@ -39,9 +39,15 @@ namespace EngineCore
 
         const glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
 
+        // view space depth range of the last projection
+        float getNear() const { return nearPlane; }
+        float getFar() const { return farPlane; }
+
     private:
         glm::mat4 projectionMatrix{1.0f};
         glm::mat4 viewMatrix{1.0f};
         glm::mat4 inverseViewMatrix{1.0f};
+        float nearPlane = 0.1f;
+        float farPlane = 1000.0f;
     };
 }
\ No newline at end of file
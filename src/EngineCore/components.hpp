@@ -0,0 +1,109 @@
+#pragma once
+
+#include "model.hpp"
+
+// libs
+#include <glm/gtc/matrix_transform.hpp>
+
+//std
+#include <cstdint>
+#include <memory>
+
+namespace EngineCore
+{
+    class Registry;
+
+    struct Entity
+    {
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        uint32_t index = INVALID_INDEX;
+        uint32_t generation = 0;
+
+        bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const Entity& other) const { return !(*this == other); }
+    };
+
+    // local transform relative to the parent (the world for roots). The world matrices are cached,
+    // TransformSystem rebuilds them only for dirty transforms and their descendants
+    class TransformComponent
+    {
+    public:
+        const glm::vec3& getTranslation() const { return translation; }
+        const glm::vec3& getScale() const { return scale; }
+        const glm::vec3& getRotation() const { return rotation; }
+        void setTranslation(const glm::vec3& value) { translation = value; dirty = true; }
+        void setScale(const glm::vec3& value) { scale = value; dirty = true; }
+        void setRotation(const glm::vec3& value) { rotation = value; dirty = true; }
+
+        // set through Registry::setParent, invalid for roots
+        Entity getParent() const { return parent; }
+
+        bool isDirty() const { return dirty; }
+        void markDirty() { dirty = true; }
+
+        const glm::mat4& getWorldMatrix() const { return worldMatrix; }
+        const glm::mat3& getWorldNormalMatrix() const { return worldNormalMatrix; }
+        glm::vec3 getWorldPosition() const { return glm::vec3(worldMatrix[3]); }
+        // changes whenever the world matrices are rebuilt, unique over all transforms, 0 until the first build
+        uint64_t getVersion() const { return version; }
+
+        // TransformSystem only: stores the rebuilt world matrices and clears the dirty flag
+        void setWorld(const glm::mat4& world, const glm::mat3& worldNormal, uint64_t newVersion)
+        {
+            worldMatrix = world;
+            worldNormalMatrix = worldNormal;
+            version = newVersion;
+            dirty = false;
+        }
+
+        // local matrices
+        // Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
+        // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
+        // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
+        glm::mat4 mat4() const;
+        glm::mat3 normalMatrix() const;
+
+    private:
+        friend class Registry;
+
+        glm::vec3 translation{}; // position offset
+        glm::vec3 scale{1.0f, 1.0f, 1.0f};
+        glm::vec3 rotation{}; // euler angles: Y-X-Z  (in radians)
+        Entity parent{};
+
+        bool dirty = true;
+        uint64_t version = 0;
+        glm::mat4 worldMatrix{1.0f};
+        glm::mat3 worldNormalMatrix{1.0f};
+    };
+
+    struct PerObjectUboData
+    {
+        glm::mat4 modelMatrix{1.0f};
+        glm::mat4 normalMatrix{1.0f};
+        //alignas(16) glm::vec3 color; // make sure the memory align as 16 bytes, to match the data alignment in shader
+    };
+
+    struct ModelComponent
+    {
+        std::shared_ptr<Model> model{};     // shared by every entity drawing the same mesh
+    };
+
+    struct PointLightComponent
+    {
+        float lightIntensity = 1.0f;
+        glm::vec3 color{1.0f};
+    };
+
+    // per light billboard instance in the frame ring, matches the std430 PointLightInstance of point_light.vert
+    struct PointLightPerObjectData
+    {
+        glm::vec4 position{};   // w is the radius, the transform's local scale.x
+        glm::vec4 color{};      // w is intensity
+    };
+
+    PerObjectUboData makeSimpleObjectData(const TransformComponent& transform);
+    PointLightPerObjectData makePointLightObjectData(const TransformComponent& transform, const PointLightComponent& pointLight);
+
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "draw_table.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace EngineCore
+{
+    bool DrawTable::update(Registry& registry, uint32_t maxObjects)
+    {
+        if(version != 0 && registryVersion == registry.getStructureVersion())
+        {
+            return false;
+        }
+
+        rebuild(registry, maxObjects);
+        registryVersion = registry.getStructureVersion();
+        version++;
+        return true;
+    }
+
+    void DrawTable::rebuild(Registry& registry, uint32_t maxObjects)
+    {
+        batches.clear();
+        batchSources.clear();
+        objects.clear();
+        objectModels.clear();
+        models.clear();
+        firstBatches.clear();
+
+        // same selection as the cpu culling path: loaded model + transform
+        auto& modelPool = registry.getPool<ModelComponent>();
+        auto& transforms = registry.getPool<TransformComponent>();
+        for(size_t i = 0; i < modelPool.size(); i++)
+        {
+            Model* model = modelPool.at(i).model.get();
+            const uint32_t objectIndex = modelPool.entityAt(i).index;
+            if(model == nullptr || model->empty() || transforms.tryGet(objectIndex) == nullptr) continue;
+
+            if(objectIndex >= maxObjects)
+            {
+                throw std::runtime_error("object buffer overflow, raise maxObjects!");
+            }
+
+            auto inserted = firstBatches.emplace(model, static_cast<uint32_t>(batches.size()));
+            if(inserted.second)
+            {
+                models.push_back(model);
+                for(uint32_t s = 0; s < model->getSubmeshCount(); s++)
+                {
+                    const Vk::LveModel& submesh = model->getSubmesh(s);
+                    assert(submesh.getIndexCount() > 0 && "indirect draws are indexed, every submesh needs an index buffer");
+
+                    const auto& sphere = submesh.getBoundingSphere();
+                    batches.push_back(DrawBatch{glm::vec4(sphere.center, sphere.radius), submesh.getIndexCount(),
+                        submesh.getFirstIndex(), submesh.getVertexOffset(), 0});
+                    batchSources.push_back(BatchSource{model, s, 0});
+                }
+            }
+
+            const uint32_t firstBatch = inserted.first->second;
+            for(uint32_t s = 0; s < model->getSubmeshCount(); s++)
+            {
+                batchSources[firstBatch + s].instanceCount++;
+            }
+            objects.push_back(objectIndex);
+            objectModels.push_back(model);
+        }
+
+        // exclusive prefix sum: every batch's run of instances / command slots
+        uint32_t total = 0;
+        for(size_t b = 0; b < batches.size(); b++)
+        {
+            batches[b].commandOffset = total;
+            total += batchSources[b].instanceCount;
+        }
+
+        // fill pass, instances of a batch stay in entity order
+        instanceObjects.resize(total);
+        instanceBatches.resize(total);
+        std::vector<uint32_t> cursors(batches.size(), 0);
+        for(size_t i = 0; i < objects.size(); i++)
+        {
+            Model* model = objectModels[i];
+            const uint32_t firstBatch = firstBatches[model];
+            for(uint32_t s = 0; s < model->getSubmeshCount(); s++)
+            {
+                const uint32_t batch = firstBatch + s;
+                const uint32_t instance = batches[batch].commandOffset + cursors[batch]++;
+                instanceObjects[instance] = objects[i];
+                instanceBatches[instance] = batch;
+            }
+        }
+    }
+}
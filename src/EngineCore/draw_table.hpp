@@ -0,0 +1,81 @@
+/*************************************************
+Draw Table (gpu driven drawing):
+1. one batch per submesh of every model in use, one instance per (entity, submesh) pair
+2. instances are grouped by batch, batch b owns the indirect command slots
+   [commandOffset, commandOffset + instanceCount) so the cull shader can compact its visible
+   instances to the front of that run
+3. rebuilt only when the registry's structure version changed, batches / instance arrays are laid
+   out like the buffers read by cull.comp and simple_shader.vert
+*************************************************/
+#pragma once
+
+#include "registry.hpp"
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace EngineCore
+{
+    // one submesh of one model, std430 layout of DrawBatch in cull.comp
+    struct DrawBatch
+    {
+        glm::vec4 boundingSphere;   // local space center, radius
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t commandOffset;     // first of the batch's command slots, one per instance
+    };
+
+    class DrawTable
+    {
+    public:
+        // what the cpu needs to record a batch's indirect draw
+        struct BatchSource
+        {
+            Model* model;
+            uint32_t submesh;
+            uint32_t instanceCount;
+        };
+
+        // rebuilds when entities or components were added / removed since the last call, returns true if it did.
+        // Throws when a drawable entity's index reaches maxObjects (it addresses the object buffer)
+        bool update(Registry& registry, uint32_t maxObjects);
+
+        // changes with every rebuild, 0 before the first one
+        uint64_t getVersion() const { return version; }
+
+        const std::vector<DrawBatch>& getBatches() const { return batches; }
+        const std::vector<BatchSource>& getBatchSources() const { return batchSources; }
+        // per instance: the entity index (object buffer slot) and its batch
+        const std::vector<uint32_t>& getInstanceObjects() const { return instanceObjects; }
+        const std::vector<uint32_t>& getInstanceBatches() const { return instanceBatches; }
+        uint32_t getInstanceCount() const { return static_cast<uint32_t>(instanceObjects.size()); }
+
+        // every drawn entity once, and every model in use once
+        const std::vector<uint32_t>& getObjects() const { return objects; }
+        const std::vector<Model*>& getModels() const { return models; }
+
+    private:
+        void rebuild(Registry& registry, uint32_t maxObjects);
+
+        uint64_t version = 0;
+        uint64_t registryVersion = 0;
+
+        std::vector<DrawBatch> batches;
+        std::vector<BatchSource> batchSources;
+        std::vector<uint32_t> instanceObjects;
+        std::vector<uint32_t> instanceBatches;
+
+        std::vector<uint32_t> objects;
+        std::vector<Model*> objectModels;       // parallel to objects
+        std::vector<Model*> models;
+        std::unordered_map<Model*, uint32_t> firstBatches;  // the model's submesh s is batch firstBatches[model] + s
+    };
+}
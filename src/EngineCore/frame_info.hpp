@@ -1,7 +1,8 @@
 #pragma once
 
 #include "camera.hpp"
-#include "game_object.hpp"
+#include "registry.hpp"
+#include "Vk/lve_ring_buffer.hpp"
 
 // lib
 #include <vulkan/vulkan.h>
@@ -9,12 +10,11 @@
 namespace EngineCore
 {
 
-#define MAX_LIGHTS 10
-
+    // clustered light in the frame ring, matches PointLight in simple_shader.frag (std430)
     struct PointLight
     {
-        glm::vec4 position{}; // ignore w
-        alignas(16) glm::vec4 color{}; // w is intensity
+        glm::vec4 position{}; // w is the range, the light is ignored beyond it
+        glm::vec4 color{}; // w is intensity
     };
 
     struct GlobalUbo
@@ -23,16 +23,21 @@ namespace EngineCore
         glm::mat4 view{1.0f};
         glm::mat4 inverseView{1.0f};
         glm::vec4 ambientLightColor{1.0f, 1.0f, 1.0f, 0.02f}; // w is light intensity
-        PointLight pointLights[MAX_LIGHTS];
-        int numLights;
+        glm::uvec4 clusterGrid{};   // cluster counts in x, y, z (LightClusterGrid), w is the light count
+        glm::vec4 clusterDepth{};   // LightClusterGrid::getDepthParams()
     };
 
+    // frame ring dynamic offsets of the clustered lights, in set0 binding order
+    enum LightClusterBuffer { CLUSTER_LIGHTS, CLUSTER_RANGES, CLUSTER_LIGHT_INDICES, LIGHT_CLUSTER_BUFFER_COUNT };
+
     struct FrameInfo
     {
         int frameIndex;
         float frameTime;
         VkCommandBuffer commandBuffer;
         Camera& camera;
-        EngineCore::GameObject::Map& gameObjects;
+        EngineCore::Registry& registry;
+        Vk::LveRingBuffer& frameRing;   // transient per-frame data, already rewound to this frame's region
+        uint32_t lightClusterOffsets[LIGHT_CLUSTER_BUFFER_COUNT] = {};  // written by PointLightSystem::writeLightClusters
     };
 }
\ No newline at end of file
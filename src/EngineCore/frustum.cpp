@@ -0,0 +1,143 @@
+#include "frustum.hpp"
+
+// std
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define LVE_FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace EngineCore
+{
+    void BoxList::clear()
+    {
+        centerX.clear();
+        centerY.clear();
+        centerZ.clear();
+        extentX.clear();
+        extentY.clear();
+        extentZ.clear();
+    }
+
+    void BoxList::push(const glm::vec3& center, const glm::vec3& extent)
+    {
+        centerX.push_back(center.x);
+        centerY.push_back(center.y);
+        centerZ.push_back(center.z);
+        extentX.push_back(extent.x);
+        extentY.push_back(extent.y);
+        extentZ.push_back(extent.z);
+    }
+
+    void BoxList::pushTransformed(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& transform)
+    {
+        // Arvo: the new half extent is |M| * extent, the center is transformed as a point
+        const glm::vec3 localCenter = 0.5f * (localMax + localMin);
+        const glm::vec3 localExtent = 0.5f * (localMax - localMin);
+
+        const glm::vec3 center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+        const glm::mat3 absolute{glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2]))};
+        push(center, absolute * localExtent);
+    }
+
+    Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection)
+    {
+        // glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+        const glm::mat4 rows = glm::transpose(viewProjection);
+
+        Frustum frustum;
+        frustum.planes[LEFT_PLANE] = rows[3] + rows[0];
+        frustum.planes[RIGHT_PLANE] = rows[3] - rows[0];
+        frustum.planes[BOTTOM_PLANE] = rows[3] + rows[1];
+        frustum.planes[TOP_PLANE] = rows[3] - rows[1];
+        frustum.planes[NEAR_PLANE] = rows[2];             // 0 <= z, not -w <= z as with an OpenGL projection
+        frustum.planes[FAR_PLANE] = rows[3] - rows[2];
+
+        for(glm::vec4& plane : frustum.planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    bool Frustum::isBoxVisible(const glm::vec3& center, const glm::vec3& extent) const
+    {
+        for(const glm::vec4& plane : planes)
+        {
+            const glm::vec3 normal{plane};
+            const float distance = glm::dot(normal, center) + plane.w;
+            const float radius = glm::dot(glm::abs(normal), extent);
+            if(distance + radius < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t Frustum::cullBoxes(const BoxList& boxes, uint8_t* visible) const
+    {
+        const size_t count = boxes.size();
+        uint32_t visibleCount = 0;
+        size_t i = 0;
+
+#ifdef LVE_FRUSTUM_SSE
+        // every plane component broadcast once, the loop then only loads the boxes
+        __m128 normalX[PLANE_COUNT], normalY[PLANE_COUNT], normalZ[PLANE_COUNT], distance[PLANE_COUNT];
+        __m128 absX[PLANE_COUNT], absY[PLANE_COUNT], absZ[PLANE_COUNT];
+        for(int p = 0; p < PLANE_COUNT; p++)
+        {
+            normalX[p] = _mm_set1_ps(planes[p].x);
+            normalY[p] = _mm_set1_ps(planes[p].y);
+            normalZ[p] = _mm_set1_ps(planes[p].z);
+            distance[p] = _mm_set1_ps(planes[p].w);
+            absX[p] = _mm_set1_ps(std::fabs(planes[p].x));
+            absY[p] = _mm_set1_ps(std::fabs(planes[p].y));
+            absZ[p] = _mm_set1_ps(std::fabs(planes[p].z));
+        }
+        const __m128 zero = _mm_setzero_ps();
+
+        for(; i + 4 <= count; i += 4)
+        {
+            const __m128 centerX = _mm_loadu_ps(&boxes.centerX[i]);
+            const __m128 centerY = _mm_loadu_ps(&boxes.centerY[i]);
+            const __m128 centerZ = _mm_loadu_ps(&boxes.centerZ[i]);
+            const __m128 extentX = _mm_loadu_ps(&boxes.extentX[i]);
+            const __m128 extentY = _mm_loadu_ps(&boxes.extentY[i]);
+            const __m128 extentZ = _mm_loadu_ps(&boxes.extentZ[i]);
+
+            // lanes stay set while the box reaches the inner side of every plane
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for(int p = 0; p < PLANE_COUNT; p++)
+            {
+                __m128 d = _mm_add_ps(_mm_mul_ps(normalX[p], centerX), distance[p]);
+                d = _mm_add_ps(d, _mm_mul_ps(normalY[p], centerY));
+                d = _mm_add_ps(d, _mm_mul_ps(normalZ[p], centerZ));
+                d = _mm_add_ps(d, _mm_mul_ps(absX[p], extentX));
+                d = _mm_add_ps(d, _mm_mul_ps(absY[p], extentY));
+                d = _mm_add_ps(d, _mm_mul_ps(absZ[p], extentZ));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+            }
+
+            const int mask = _mm_movemask_ps(inside);
+            for(int lane = 0; lane < 4; lane++)
+            {
+                const uint8_t laneVisible = static_cast<uint8_t>((mask >> lane) & 1);
+                visible[i + lane] = laneVisible;
+                visibleCount += laneVisible;
+            }
+        }
+#endif
+
+        for(; i < count; i++)
+        {
+            const bool boxVisible = isBoxVisible(
+                {boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]},
+                {boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]});
+            visible[i] = boxVisible ? 1 : 0;
+            visibleCount += boxVisible ? 1 : 0;
+        }
+        return visibleCount;
+    }
+}
@@ -0,0 +1,54 @@
+/*************************************************
+Frustum:
+1. six planes extracted from projection * view (Gribb / Hartmann), normals point inside
+2. world space boxes are kept as structure of arrays (center / half extent per axis)
+3. cullBoxes tests four boxes per iteration with SSE, the scalar path handles the tail
+   and builds without SSE
+
+A box is culled only if it lies completely outside one plane, so boxes near the frustum
+corners may be kept (conservative).
+*************************************************/
+#pragma once
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace EngineCore
+{
+    struct BoxList
+    {
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+
+        size_t size() const { return centerX.size(); }
+        void clear();
+        void push(const glm::vec3& center, const glm::vec3& extent);
+        // bounds of a local space box after the (affine) transform, as a world space box
+        void pushTransformed(const glm::vec3& localMin, const glm::vec3& localMax, const glm::mat4& transform);
+    };
+
+    class Frustum
+    {
+    public:
+        // NEAR / FAR alone clash with the windows.h macros
+        enum Plane { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+        // expects a [0, 1] depth range (GLM_FORCE_DEPTH_ZERO_TO_ONE)
+        static Frustum fromViewProjection(const glm::mat4& viewProjection);
+
+        bool isBoxVisible(const glm::vec3& center, const glm::vec3& extent) const;
+        // visible[i] = 1 if boxes[i] intersects the frustum, 0 otherwise, returns the visible count
+        uint32_t cullBoxes(const BoxList& boxes, uint8_t* visible) const;
+
+        const glm::vec4& getPlane(Plane index) const { return planes[index]; }
+
+    private:
+        glm::vec4 planes[PLANE_COUNT];   // xyz: unit normal, w: distance, dot(n, p) + w >= 0 inside
+    };
+}
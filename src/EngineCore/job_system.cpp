@@ -0,0 +1,120 @@
+#include "job_system.hpp"
+
+#include "Platform/cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+
+namespace EngineCore
+{
+    JobSystem::JobSystem(uint32_t threadCount)
+    {
+        if(threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        workers.reserve(threadCount - 1);
+        for(uint32_t i = 1; i < threadCount; i++)
+        {
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+
+        for(auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    uint32_t JobSystem::runTasks(const Task& task, uint32_t taskCount, uint32_t threadIndex)
+    {
+        uint32_t done = 0;
+        for(uint32_t i = nextTask.fetch_add(1); i < taskCount; i = nextTask.fetch_add(1))
+        {
+            task(i, threadIndex);
+            done++;
+        }
+        return done;
+    }
+
+    void JobSystem::parallelFor(uint32_t taskCount, const Task& task)
+    {
+        if(taskCount == 0)
+        {
+            return;
+        }
+
+        if(workers.empty() || taskCount == 1)
+        {
+            for(uint32_t i = 0; i < taskCount; i++)
+            {
+                task(i, 0);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentTask = &task;
+            currentTaskCount = taskCount;
+            nextTask.store(0);
+            finishedTasks = 0;
+            generation++;
+        }
+        wakeCondition.notify_all();
+
+        uint32_t done = runTasks(task, taskCount, 0);
+
+        // wait for the tasks still running on workers, and for every worker to let go of the batch
+        // (task lives on the caller's stack)
+        std::unique_lock<std::mutex> lock(mutex);
+        finishedTasks += done;
+        doneCondition.wait(lock, [this, taskCount] { return finishedTasks == taskCount && activeWorkers == 0; });
+        currentTask = nullptr;
+        currentTaskCount = 0;
+    }
+
+    void JobSystem::workerLoop(uint32_t threadIndex)
+    {
+        Platform::CpuProfiler::setThreadName("JobWorker");
+        uint64_t seenGeneration = 0;
+        while(true)
+        {
+            const Task* task = nullptr;
+            uint32_t taskCount = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeCondition.wait(lock, [this, seenGeneration] {
+                    return stopping || (currentTask != nullptr && generation != seenGeneration);
+                });
+                if(stopping)
+                {
+                    return;
+                }
+
+                seenGeneration = generation;
+                task = currentTask;
+                taskCount = currentTaskCount;
+                activeWorkers++;
+            }
+
+            uint32_t done = runTasks(*task, taskCount, threadIndex);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finishedTasks += done;
+                activeWorkers--;
+            }
+            doneCondition.notify_one();
+        }
+    }
+}
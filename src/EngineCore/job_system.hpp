@@ -0,0 +1,58 @@
+/*************************************************
+Job System Class:
+1. fixed pool of worker threads, created once
+2. parallelFor: fan a batch of tasks out over the workers and the calling thread
+3. every task knows which thread runs it, so per-thread resources (command pools) need no locking
+
+Thread index 0 is always the calling thread, workers are 1..getThreadCount()-1
+*************************************************/
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace EngineCore
+{
+    class JobSystem
+    {
+    public:
+        using Task = std::function<void(uint32_t taskIndex, uint32_t threadIndex)>;
+
+        // threadCount includes the calling thread, 0 picks one thread per hardware core
+        explicit JobSystem(uint32_t threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+        // runs task(i, threadIndex) for every i in [0, taskCount) and blocks until all of them finished
+        void parallelFor(uint32_t taskCount, const Task& task);
+
+    private:
+        void workerLoop(uint32_t threadIndex);
+        uint32_t runTasks(const Task& task, uint32_t taskCount, uint32_t threadIndex);
+
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable wakeCondition;
+        std::condition_variable doneCondition;
+
+        // current batch, guarded by mutex (nextTask is claimed lock free)
+        const Task* currentTask = nullptr;
+        uint32_t currentTaskCount = 0;
+        std::atomic<uint32_t> nextTask{0};
+        uint32_t finishedTasks = 0;
+        uint32_t activeWorkers = 0;
+        uint64_t generation = 0;
+        bool stopping = false;
+    };
+}
@@ -2,7 +2,7 @@
 
 namespace EngineCore 
 {
-    void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, EngineCore::GameObject& gameObject)
+    void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, EngineCore::TransformComponent& transform)
     {
         glm::vec3 rotate{0};
         if(glfwGetKey(window, keys.lookRight) == GLFW_PRESS)
@@ -22,15 +22,21 @@ namespace EngineCore
             rotate.x -= 1.f;
         }
 
+        glm::vec3 rotation = transform.getRotation();
         if(glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon())
         {
-            gameObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+            rotation += lookSpeed * dt * glm::normalize(rotate);
         }
 
-        gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-        gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y,  glm::two_pi<float>());
+        rotation.x = glm::clamp(rotation.x, -1.5f, 1.5f);
+        rotation.y = glm::mod(rotation.y,  glm::two_pi<float>());
+        // only touch the transform when it moved, it stays clean otherwise
+        if(rotation != transform.getRotation())
+        {
+            transform.setRotation(rotation);
+        }
     
-        float yaw = gameObject.transform.rotation.y;
+        float yaw = rotation.y;
         const glm::vec3 forwardDir{sin(yaw), 0.0f, cos(yaw)};
         const glm::vec3 rightDir{forwardDir.z, 0.0f, -forwardDir.x};
         const glm::vec3 upDir{0.0f, -1.0f, 0.0f};
@@ -63,7 +69,7 @@ namespace EngineCore
 
         if(glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon())
         {
-            gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+            transform.setTranslation(transform.getTranslation() + moveSpeed * dt * glm::normalize(moveDir));
         }
     }
 
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "game_object.hpp"
+#include "components.hpp"
 
 namespace EngineCore 
 {
@@ -22,7 +22,7 @@ namespace EngineCore
             int lookDown = GLFW_KEY_DOWN;
         };
 
-        void moveInPlaneXZ(GLFWwindow* window, float dt, EngineCore::GameObject& gameObject);
+        void moveInPlaneXZ(GLFWwindow* window, float dt, EngineCore::TransformComponent& transform);
 
         KeyMappings keys{};
         float moveSpeed{2.0f};
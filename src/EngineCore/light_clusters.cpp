@@ -0,0 +1,114 @@
+#include "light_clusters.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace EngineCore
+{
+    void LightClusterGrid::build(const glm::mat4& view, const glm::mat4& projection, float near, float far,
+        const glm::vec3* positions, const float* ranges, uint32_t lightCount)
+    {
+        const float logDepthRatio = std::log(far / near);
+        depthParams = glm::vec4{
+            near,
+            far,
+            static_cast<float>(GRID_Z) / logDepthRatio,
+            -static_cast<float>(GRID_Z) * std::log(near) / logDepthRatio};
+
+        // count pass: clusters touched by every light
+        clusters.assign(CLUSTER_COUNT, ClusterRange{0, 0});
+        bounds.resize(lightCount);
+        for(uint32_t i = 0; i < lightCount; i++)
+        {
+            const glm::vec3 viewCenter{view * glm::vec4(positions[i], 1.0f)};
+            bounds[i] = computeBounds(viewCenter, ranges[i], projection);
+            const LightBounds& b = bounds[i];
+            if(b.visible == false) continue;
+
+            for(uint32_t z = b.minZ; z <= b.maxZ; z++)
+            for(uint32_t y = b.minY; y <= b.maxY; y++)
+            for(uint32_t x = b.minX; x <= b.maxX; x++)
+            {
+                clusters[x + GRID_X * (y + GRID_Y * z)].count++;
+            }
+        }
+
+        // exclusive prefix sum gives every cluster its run in the index list
+        uint32_t total = 0;
+        for(ClusterRange& cluster : clusters)
+        {
+            cluster.offset = total;
+            total += cluster.count;
+            cluster.count = 0;
+        }
+        lightIndices.resize(total);
+
+        // fill pass, lights stay in index order inside a cluster
+        for(uint32_t i = 0; i < lightCount; i++)
+        {
+            const LightBounds& b = bounds[i];
+            if(b.visible == false) continue;
+
+            for(uint32_t z = b.minZ; z <= b.maxZ; z++)
+            for(uint32_t y = b.minY; y <= b.maxY; y++)
+            for(uint32_t x = b.minX; x <= b.maxX; x++)
+            {
+                ClusterRange& cluster = clusters[x + GRID_X * (y + GRID_Y * z)];
+                lightIndices[cluster.offset + cluster.count++] = i;
+            }
+        }
+    }
+
+    LightClusterGrid::LightBounds LightClusterGrid::computeBounds(const glm::vec3& viewCenter, float range, const glm::mat4& projection) const
+    {
+        const float near = depthParams.x;
+        const float far = depthParams.y;
+        LightBounds b{};
+        if(viewCenter.z + range < near || viewCenter.z - range > far)
+        {
+            b.visible = false;
+            return b;
+        }
+        b.visible = true;
+
+        // the part of the sphere's view space box in front of the near plane; x / z and y / z are extreme
+        // at its corners, so the projected corners bound the sphere's screen rectangle conservatively
+        const float minDepth = std::max(viewCenter.z - range, near);
+        const float maxDepth = std::min(viewCenter.z + range, far);
+        glm::vec2 ndcMin{1.0f};
+        glm::vec2 ndcMax{-1.0f};
+        for(int corner = 0; corner < 8; corner++)
+        {
+            const glm::vec4 point{
+                viewCenter.x + ((corner & 1) != 0 ? range : -range),
+                viewCenter.y + ((corner & 2) != 0 ? range : -range),
+                (corner & 4) != 0 ? maxDepth : minDepth,
+                1.0f};
+            const glm::vec4 clip = projection * point;
+            const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+
+        // ndc [-1, 1] -> tiles, clamped to the grid
+        auto toTile = [](float ndc, uint32_t tiles)
+        {
+            const float tile = std::floor((ndc * 0.5f + 0.5f) * static_cast<float>(tiles));
+            return static_cast<uint8_t>(std::clamp(tile, 0.0f, static_cast<float>(tiles - 1)));
+        };
+        b.minX = toTile(ndcMin.x, GRID_X);
+        b.maxX = toTile(ndcMax.x, GRID_X);
+        b.minY = toTile(ndcMin.y, GRID_Y);
+        b.maxY = toTile(ndcMax.y, GRID_Y);
+        b.minZ = static_cast<uint8_t>(sliceOf(minDepth));
+        b.maxZ = static_cast<uint8_t>(sliceOf(maxDepth));
+        return b;
+    }
+
+    uint32_t LightClusterGrid::sliceOf(float viewDepth) const
+    {
+        const float slice = std::floor(std::log(std::max(viewDepth, depthParams.x)) * depthParams.z + depthParams.w);
+        return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(GRID_Z - 1)));
+    }
+}
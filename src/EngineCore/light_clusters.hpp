@@ -0,0 +1,69 @@
+/*************************************************
+Light Cluster Grid (clustered forward shading):
+1. the view frustum is split into GRID_X * GRID_Y screen tiles and GRID_Z depth slices, the slices
+   grow exponentially with view depth so clusters stay roughly cubic
+2. every light's sphere of influence is projected to a conservative range of clusters on the cpu,
+   lights behind the near or beyond the far plane are dropped
+3. output is compact: per cluster an (offset, count) range into one light index list, built with a
+   count pass + prefix sum + fill pass, the arrays keep their capacity between frames
+
+The fragment shader computes its cluster the same way (see simple_shader.frag) and only shades
+the lights listed there.
+*************************************************/
+#pragma once
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace EngineCore
+{
+    // one cluster's lights: lightIndices[offset, offset + count), matches uvec2 in the shader
+    struct ClusterRange
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    class LightClusterGrid
+    {
+    public:
+        static constexpr uint32_t GRID_X = 16;
+        static constexpr uint32_t GRID_Y = 9;
+        static constexpr uint32_t GRID_Z = 24;
+        static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+        // positions are world space, ranges the distance where a light's contribution ends
+        void build(const glm::mat4& view, const glm::mat4& projection, float near, float far,
+            const glm::vec3* positions, const float* ranges, uint32_t lightCount);
+
+        const std::vector<ClusterRange>& getClusters() const { return clusters; }
+        const std::vector<uint32_t>& getLightIndices() const { return lightIndices; }
+
+        // near, far, slice scale, slice bias: slice = floor(log(viewDepth) * scale + bias)
+        const glm::vec4& getDepthParams() const { return depthParams; }
+
+    private:
+        // inclusive cluster coordinates covered by one light
+        struct LightBounds
+        {
+            uint8_t minX, maxX;
+            uint8_t minY, maxY;
+            uint8_t minZ, maxZ;
+            bool visible;
+        };
+
+        LightBounds computeBounds(const glm::vec3& viewCenter, float range, const glm::mat4& projection) const;
+        uint32_t sliceOf(float viewDepth) const;
+
+        glm::vec4 depthParams{};
+        std::vector<LightBounds> bounds;
+        std::vector<ClusterRange> clusters;
+        std::vector<uint32_t> lightIndices;
+    };
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "texture_manager.hpp"
+
 #include "Vk/lve_buffer.hpp"
 
 // libs
@@ -21,11 +23,20 @@ namespace EngineCore
             glm::vec4 ambient; // ignore w
             float blinn_factor = 32.0f;
             // ....        
+            // vertex dequantization of the submesh (LveModel::Quantization), written by Model::addSubmesh
+            alignas(16) glm::vec4 positionScale{1.0f}; // ignore w
+            glm::vec4 positionOffset{0.0f}; // ignore w
+            glm::vec4 uvScaleOffset{1.0f, 1.0f, 0.0f, 0.0f};
         } materialData;
 
         std::string ambientTextureName;
         std::string roughnessTextureName;
         std::string metallicTextureName;
+
+        TextureHandle ambientTexture = TextureManager::INVALID_TEXTURE;
+        TextureHandle roughnessTexture = TextureManager::INVALID_TEXTURE;
+        TextureHandle metallicTexture = TextureManager::INVALID_TEXTURE;
+        uint32_t residentTextureMask = 0; // bit per texture above that descriptorSet points at, the rest use the placeholder
         
 
         // Vk::LvePipeline& pipeline;
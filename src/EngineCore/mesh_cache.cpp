@@ -0,0 +1,235 @@
+#include "mesh_cache.hpp"
+
+#include "Platform/atomic_file_writer.hpp"
+#include "ThirdParty/utility.hpp"
+
+// std
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace EngineCore
+{
+    using Platform::SECTION_ALIGNMENT;
+    using Platform::alignSection;
+
+    static constexpr uint64_t INDEX_RUN_ALIGNMENT = 4;
+
+    static void copyName(char (&dst)[MeshCache::MAX_PATH_LENGTH], const std::string& name)
+    {
+        if(name.size() >= MeshCache::MAX_PATH_LENGTH)
+        {
+            throw std::runtime_error("texture path too long for mesh cache: " + name);
+        }
+        memset(dst, 0, sizeof(dst));
+        memcpy(dst, name.data(), name.size());
+    }
+
+    std::string MeshCache::getCachePath(const std::string& objPath)
+    {
+        const std::filesystem::path path{objPath};
+        const uint64_t pathHash = Util::fnv1a64(objPath.data(), objPath.size());
+
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "_%016llx.lvemesh", static_cast<unsigned long long>(pathHash));
+        return (std::filesystem::path("./build/MeshCache") / (path.stem().string() + suffix)).string();
+    }
+
+    uint64_t MeshCache::hashSource(const std::string& objPath, const std::string& mtlBasePath)
+    {
+        Platform::MappedFile objFile{objPath};
+        if(objFile.isOpen() == false)
+        {
+            throw std::runtime_error("failed to open obj file: " + objPath);
+        }
+
+        uint64_t hash = Util::fnv1a64(&VERSION, sizeof(VERSION));
+        hash = Util::fnv1a64(objFile.data(), objFile.size(), hash);
+
+        // find "mtllib a.mtl [b.mtl ...]" lines, tinyobj resolves them against mtlBasePath
+        const char* text = reinterpret_cast<const char*>(objFile.data());
+        const size_t size = objFile.size();
+        for(size_t lineBegin = 0; lineBegin < size; )
+        {
+            size_t lineEnd = lineBegin;
+            while(lineEnd < size && text[lineEnd] != '\n') lineEnd++;
+
+            const std::string line(text + lineBegin, lineEnd - lineBegin);
+            if(line.compare(0, 7, "mtllib ") == 0)
+            {
+                size_t pos = 7;
+                while(pos < line.size())
+                {
+                    while(pos < line.size() && isspace(static_cast<unsigned char>(line[pos]))) pos++;
+                    size_t end = pos;
+                    while(end < line.size() && isspace(static_cast<unsigned char>(line[end])) == 0) end++;
+                    if(end > pos)
+                    {
+                        const std::string mtlPath = (std::filesystem::path(mtlBasePath) / line.substr(pos, end - pos)).string();
+                        Platform::MappedFile mtlFile{mtlPath};
+                        if(mtlFile.isOpen())
+                        {
+                            hash = Util::fnv1a64(mtlFile.data(), mtlFile.size(), hash);
+                        }
+                    }
+                    pos = end;
+                }
+            }
+            lineBegin = lineEnd + 1;
+        }
+        return hash;
+    }
+
+    void MeshCache::write(
+        const std::string& cachePath,
+        uint64_t sourceHash,
+        const std::vector<Material>& materials,
+        const std::vector<Vk::LveModel::Builder>& builders)
+    {
+        assert(materials.size() == builders.size() && "one material per submesh");
+
+        // value initialized, padding and unused name bytes are written as zeros
+        std::vector<Submesh> submeshTable(builders.size());
+        std::vector<MaterialRecord> materialTable(materials.size());
+        uint64_t vertexCount = 0;
+        uint64_t indexDataSize = 0;
+        for(size_t i = 0; i < builders.size(); i++)
+        {
+            Submesh& submesh = submeshTable[i];
+            submesh.materialIndex = static_cast<uint32_t>(i);
+            submesh.vertexOffset = static_cast<uint32_t>(vertexCount);
+            submesh.vertexCount = static_cast<uint32_t>(builders[i].vertices.size());
+            submesh.indexCount = static_cast<uint32_t>(builders[i].indices.size());
+            submesh.indexSize = Vk::LveModel::getIndexSize(Vk::LveModel::selectIndexType(submesh.vertexCount));
+            // runs stay 4 byte aligned behind odd length 16 bit runs
+            indexDataSize = (indexDataSize + INDEX_RUN_ALIGNMENT - 1) / INDEX_RUN_ALIGNMENT * INDEX_RUN_ALIGNMENT;
+            submesh.indexOffset = static_cast<uint32_t>(indexDataSize);
+            vertexCount += submesh.vertexCount;
+            indexDataSize += uint64_t(submesh.indexCount) * submesh.indexSize;
+
+            MaterialRecord& record = materialTable[i];
+            record.data = materials[i].materialData;
+            copyName(record.ambientTextureName, materials[i].ambientTextureName);
+            copyName(record.roughnessTextureName, materials[i].roughnessTextureName);
+            copyName(record.metallicTextureName, materials[i].metallicTextureName);
+        }
+
+        Header header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.sourceHash = sourceHash;
+        header.vertexStride = sizeof(Vk::LveModel::Vertex);
+        header.submeshCount = static_cast<uint32_t>(submeshTable.size());
+        header.materialCount = static_cast<uint32_t>(materialTable.size());
+        header.submeshTableOffset = alignSection(sizeof(Header));
+        header.materialTableOffset = alignSection(header.submeshTableOffset + submeshTable.size() * sizeof(Submesh));
+        header.vertexDataOffset = alignSection(header.materialTableOffset + materialTable.size() * sizeof(MaterialRecord));
+        header.vertexDataSize = vertexCount * sizeof(Vk::LveModel::Vertex);
+        header.indexDataOffset = alignSection(header.vertexDataOffset + header.vertexDataSize);
+        header.indexDataSize = indexDataSize;
+        header.fileSize = header.indexDataOffset + header.indexDataSize;
+
+        Platform::AtomicFileWriter out{cachePath};
+        out.write(&header, sizeof(header));
+        out.padTo(header.submeshTableOffset);
+        out.write(submeshTable.data(), submeshTable.size() * sizeof(Submesh));
+        out.padTo(header.materialTableOffset);
+        out.write(materialTable.data(), materialTable.size() * sizeof(MaterialRecord));
+        out.padTo(header.vertexDataOffset);
+        for(const auto& builder : builders)
+        {
+            out.write(builder.vertices.data(), builder.vertices.size() * sizeof(Vk::LveModel::Vertex));
+        }
+        std::vector<uint16_t> narrowed;
+        for(size_t i = 0; i < builders.size(); i++)
+        {
+            const auto& indices = builders[i].indices;
+            const Submesh& submesh = submeshTable[i];
+            out.padTo(header.indexDataOffset + submesh.indexOffset);
+            if(submesh.indexSize == sizeof(uint16_t))
+            {
+                narrowed.assign(indices.begin(), indices.end());
+                out.write(narrowed.data(), narrowed.size() * sizeof(uint16_t));
+            }
+            else
+            {
+                out.write(indices.data(), indices.size() * sizeof(uint32_t));
+            }
+        }
+        out.commit();
+    }
+
+    bool MeshCache::open(const std::string& cachePath, uint64_t sourceHash)
+    {
+        file = Platform::MappedFile{cachePath};
+        if(file.isOpen() && validate(sourceHash))
+        {
+            return true;
+        }
+
+        file.close();
+        header = nullptr;
+        return false;
+    }
+
+    bool MeshCache::validate(uint64_t sourceHash)
+    {
+        if(file.size() < sizeof(Header))
+        {
+            return false;
+        }
+
+        header = reinterpret_cast<const Header*>(file.data());
+        if(header->magic != MAGIC || header->version != VERSION || header->sourceHash != sourceHash ||
+            header->vertexStride != sizeof(Vk::LveModel::Vertex) || header->fileSize != file.size())
+        {
+            return false;
+        }
+
+        auto inFile = [this](uint64_t offset, uint64_t size)
+        {
+            return offset % SECTION_ALIGNMENT == 0 && offset <= file.size() && size <= file.size() - offset;
+        };
+        if(inFile(header->submeshTableOffset, uint64_t(header->submeshCount) * sizeof(Submesh)) == false ||
+            inFile(header->materialTableOffset, uint64_t(header->materialCount) * sizeof(MaterialRecord)) == false ||
+            inFile(header->vertexDataOffset, header->vertexDataSize) == false ||
+            inFile(header->indexDataOffset, header->indexDataSize) == false)
+        {
+            return false;
+        }
+
+        submeshes = reinterpret_cast<const Submesh*>(file.data() + header->submeshTableOffset);
+        materials = reinterpret_cast<const MaterialRecord*>(file.data() + header->materialTableOffset);
+        vertices = reinterpret_cast<const Vk::LveModel::Vertex*>(file.data() + header->vertexDataOffset);
+        indices = file.data() + header->indexDataOffset;
+
+        const uint64_t vertexTotal = header->vertexDataSize / sizeof(Vk::LveModel::Vertex);
+        for(uint32_t i = 0; i < header->submeshCount; i++)
+        {
+            const Submesh& submesh = submeshes[i];
+            if(submesh.materialIndex >= header->materialCount ||
+                uint64_t(submesh.vertexOffset) + submesh.vertexCount > vertexTotal ||
+                (submesh.indexSize != 2 && submesh.indexSize != 4) ||
+                submesh.indexOffset % INDEX_RUN_ALIGNMENT != 0 ||
+                (submesh.indexSize == 2 && Vk::LveModel::selectIndexType(submesh.vertexCount) != VK_INDEX_TYPE_UINT16) ||
+                uint64_t(submesh.indexOffset) + uint64_t(submesh.indexCount) * submesh.indexSize > header->indexDataSize)
+            {
+                return false;
+            }
+        }
+        for(uint32_t i = 0; i < header->materialCount; i++)
+        {
+            const MaterialRecord& record = materials[i];
+            if(record.ambientTextureName[MAX_PATH_LENGTH - 1] != '\0' ||
+                record.roughnessTextureName[MAX_PATH_LENGTH - 1] != '\0' ||
+                record.metallicTextureName[MAX_PATH_LENGTH - 1] != '\0')
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
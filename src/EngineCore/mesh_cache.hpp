@@ -0,0 +1,105 @@
+/*************************************************
+Mesh Cache Class:
+1. cooked binary copy of an OBJ model: per material submeshes, deduplicated vertices / indices, material references.
+   Indices are stored 16 bit for submeshes LveModel::selectIndexType allows it for, triangles and vertices
+   in the order MeshOptimizer left them
+2. keyed by a hash of the OBJ and its MTL files, stale or foreign-version files are ignored and rewritten
+3. read through a memory mapping, vertex / index data go from the mapping straight into the staging buffers
+
+File layout (16 byte aligned sections):
+    Header | Submesh[submeshCount] | MaterialRecord[materialCount] | vertex data | index data
+*************************************************/
+#pragma once
+
+#include "material.hpp"
+
+#include "Platform/mapped_file.hpp"
+#include "Vk/lve_model.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace EngineCore
+{
+    class MeshCache
+    {
+    public:
+        static constexpr uint32_t MAGIC = 0x4D45564C; // "LVEM"
+        static constexpr uint32_t VERSION = 4;
+        static constexpr uint32_t MAX_PATH_LENGTH = 256;
+
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t sourceHash;
+            uint32_t vertexStride;
+            uint32_t submeshCount;
+            uint32_t materialCount;
+            uint32_t reserved;
+            uint64_t submeshTableOffset;
+            uint64_t materialTableOffset;
+            uint64_t vertexDataOffset;
+            uint64_t vertexDataSize;
+            uint64_t indexDataOffset;
+            uint64_t indexDataSize;
+            uint64_t fileSize;
+        };
+
+        // vertex ranges are relative to the vertex section in elements, index ranges start at a 4 byte aligned
+        // byte offset into the index section and hold indexCount indices of indexSize bytes each
+        struct Submesh
+        {
+            uint32_t materialIndex;
+            uint32_t vertexOffset;
+            uint32_t vertexCount;
+            uint32_t indexOffset;
+            uint32_t indexCount;
+            uint32_t indexSize;     // 2 or 4
+            uint32_t reserved[2];
+        };
+
+        // texture names are stored resolved (mtl base path applied), empty when the material has none
+        struct MaterialRecord
+        {
+            Material::Data data;
+            char ambientTextureName[MAX_PATH_LENGTH];
+            char roughnessTextureName[MAX_PATH_LENGTH];
+            char metallicTextureName[MAX_PATH_LENGTH];
+        };
+
+        // ./build/MeshCache/<obj name>_<path hash>.lvemesh
+        static std::string getCachePath(const std::string& objPath);
+        // hashes the OBJ and every mtllib it references, any edit to them invalidates the cache
+        static uint64_t hashSource(const std::string& objPath, const std::string& mtlBasePath);
+
+        // one entry per submesh, materials[i] belongs to builders[i]
+        static void write(
+            const std::string& cachePath,
+            uint64_t sourceHash,
+            const std::vector<Material>& materials,
+            const std::vector<Vk::LveModel::Builder>& builders);
+
+        // maps the cache file, returns false (and stays closed) when it is missing, stale or malformed
+        bool open(const std::string& cachePath, uint64_t sourceHash);
+
+        uint32_t getSubmeshCount() const { return header->submeshCount; }
+        const Submesh& getSubmesh(uint32_t index) const { return submeshes[index]; }
+        const MaterialRecord& getMaterial(uint32_t index) const { return materials[index]; }
+        const Vk::LveModel::Vertex* getVertices(const Submesh& submesh) const { return vertices + submesh.vertexOffset; }
+        const void* getIndices(const Submesh& submesh) const { return indices + submesh.indexOffset; }
+        static VkIndexType getIndexType(const Submesh& submesh) { return submesh.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+
+    private:
+        bool validate(uint64_t sourceHash);
+
+        Platform::MappedFile file;
+        const Header* header = nullptr;
+        const Submesh* submeshes = nullptr;
+        const MaterialRecord* materials = nullptr;
+        const Vk::LveModel::Vertex* vertices = nullptr;
+        const uint8_t* indices = nullptr;
+    };
+}
@@ -0,0 +1,466 @@
+#include "mesh_optimizer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+
+namespace EngineCore
+{
+    namespace
+    {
+        // Forsyth's scoring parameters, the LRU cache is modelled a bit larger than real post transform caches
+        constexpr uint32_t SCORE_CACHE_SIZE = 32;
+        constexpr float CACHE_DECAY_POWER = 1.5f;
+        constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+        constexpr float VALENCE_BOOST_SCALE = 2.0f;
+        constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+        float vertexScore(int cachePosition, uint32_t remainingValence)
+        {
+            if(remainingValence == 0)
+            {
+                return -1.0f;
+            }
+
+            float score = 0.0f;
+            if(cachePosition >= 0)
+            {
+                // the last triangle's vertices get a fixed score, otherwise they would be reused right away
+                if(cachePosition < 3)
+                {
+                    score = LAST_TRIANGLE_SCORE;
+                }
+                else
+                {
+                    const float scale = 1.0f / static_cast<float>(SCORE_CACHE_SIZE - 3);
+                    score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale, CACHE_DECAY_POWER);
+                }
+            }
+
+            // vertices with few triangles left get finished first, they would otherwise be fetched again later
+            score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingValence), -VALENCE_BOOST_POWER);
+            return score;
+        }
+
+        // FIFO cache over insertion timestamps: a vertex is cached while fewer than cacheSize misses happened after its own
+        class FifoCache
+        {
+        public:
+            FifoCache(uint32_t vertexCount, uint32_t cacheSize): timestamps(vertexCount, 0), cacheSize{cacheSize}, time{cacheSize + 1} {}
+
+            // returns 1 on a miss
+            uint32_t access(uint32_t vertex)
+            {
+                if(time - timestamps[vertex] > cacheSize)
+                {
+                    timestamps[vertex] = time++;
+                    return 1;
+                }
+                return 0;
+            }
+
+            void flush() { time += cacheSize + 1; }
+
+        private:
+            std::vector<uint32_t> timestamps;
+            uint32_t cacheSize;
+            uint32_t time;
+        };
+    }
+
+    MeshOptimizer::Report MeshOptimizer::optimize(Vk::LveModel::Builder& builder)
+    {
+        Report report{};
+        report.before = analyzeVertexCache(builder.indices, static_cast<uint32_t>(builder.vertices.size()));
+
+        optimizeVertexCache(builder.indices, static_cast<uint32_t>(builder.vertices.size()));
+        report.clusterCount = optimizeOverdraw(builder.indices, builder.vertices);
+        optimizeVertexFetch(builder);
+
+        report.after = analyzeVertexCache(builder.indices, static_cast<uint32_t>(builder.vertices.size()));
+        return report;
+    }
+
+    void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount)
+    {
+        assert(indices.size() % 3 == 0 && "triangle lists only");
+        const size_t triangleCount = indices.size() / 3;
+        if(triangleCount == 0)
+        {
+            return;
+        }
+
+        // triangles per vertex: adjacency[adjacencyOffsets[v], + valence[v]) are the ones not emitted yet,
+        // a triangle using a vertex twice is listed twice
+        std::vector<uint32_t> valence(vertexCount, 0);
+        for(uint32_t index : indices)
+        {
+            assert(index < vertexCount);
+            valence[index]++;
+        }
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for(uint32_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + valence[v];
+        }
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for(size_t i = 0; i < indices.size(); i++)
+            {
+                adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        std::vector<int> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for(uint32_t v = 0; v < vertexCount; v++)
+        {
+            vertexScores[v] = vertexScore(-1, valence[v]);
+        }
+
+        auto scoreTriangle = [&](size_t t)
+        {
+            return vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+        };
+        std::vector<float> triangleScores(triangleCount);
+        size_t bestTriangle = 0;
+        for(size_t t = 0; t < triangleCount; t++)
+        {
+            triangleScores[t] = scoreTriangle(t);
+            if(triangleScores[t] > triangleScores[bestTriangle])
+            {
+                bestTriangle = t;
+            }
+        }
+
+        std::vector<uint8_t> emitted(triangleCount, 0);
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        // LRU, most recent first. Has room for a full cache plus the triangle pushed in front of it
+        uint32_t cache[SCORE_CACHE_SIZE + 3];
+        uint32_t cacheCount = 0;
+        size_t deadEndCursor = 0;   // triangles before it are all emitted
+
+        for(size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            const size_t t = bestTriangle;
+            assert(emitted[t] == 0);
+            emitted[t] = 1;
+            const uint32_t triangle[3] = {indices[3 * t], indices[3 * t + 1], indices[3 * t + 2]};
+            output.insert(output.end(), triangle, triangle + 3);
+
+            for(uint32_t v : triangle)
+            {
+                uint32_t* begin = adjacency.data() + adjacencyOffsets[v];
+                uint32_t* end = begin + valence[v];
+                uint32_t* found = std::find(begin, end, static_cast<uint32_t>(t));
+                assert(found != end);
+                *found = *(end - 1);
+                valence[v]--;
+            }
+
+            // the triangle's vertices move to the front, what falls off the end leaves the cache
+            uint32_t newCache[SCORE_CACHE_SIZE + 3];
+            uint32_t newCount = 0;
+            for(uint32_t v : triangle)
+            {
+                if(std::find(newCache, newCache + newCount, v) == newCache + newCount)
+                {
+                    newCache[newCount++] = v;
+                }
+            }
+            for(uint32_t i = 0; i < cacheCount; i++)
+            {
+                const uint32_t v = cache[i];
+                if(v != triangle[0] && v != triangle[1] && v != triangle[2])
+                {
+                    newCache[newCount++] = v;
+                }
+            }
+
+            for(uint32_t i = 0; i < newCount; i++)
+            {
+                const uint32_t v = newCache[i];
+                cachePositions[v] = i < SCORE_CACHE_SIZE ? static_cast<int>(i) : -1;
+                vertexScores[v] = vertexScore(cachePositions[v], valence[v]);
+            }
+            for(uint32_t i = 0; i < newCount; i++)
+            {
+                const uint32_t v = newCache[i];
+                for(uint32_t a = 0; a < valence[v]; a++)
+                {
+                    const uint32_t adjacent = adjacency[adjacencyOffsets[v] + a];
+                    triangleScores[adjacent] = scoreTriangle(adjacent);
+                }
+            }
+
+            cacheCount = std::min(newCount, SCORE_CACHE_SIZE);
+            std::copy(newCache, newCache + cacheCount, cache);
+
+            // next: the best triangle touching the cache, or the next unemitted one at a dead end
+            float bestScore = std::numeric_limits<float>::lowest();
+            bool found = false;
+            for(uint32_t i = 0; i < cacheCount; i++)
+            {
+                const uint32_t v = cache[i];
+                for(uint32_t a = 0; a < valence[v]; a++)
+                {
+                    const uint32_t adjacent = adjacency[adjacencyOffsets[v] + a];
+                    if(triangleScores[adjacent] > bestScore)
+                    {
+                        bestScore = triangleScores[adjacent];
+                        bestTriangle = adjacent;
+                        found = true;
+                    }
+                }
+            }
+            if(found == false)
+            {
+                while(deadEndCursor < triangleCount && emitted[deadEndCursor] != 0)
+                {
+                    deadEndCursor++;
+                }
+                bestTriangle = deadEndCursor;
+            }
+        }
+
+        indices.swap(output);
+    }
+
+    uint32_t MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vk::LveModel::Vertex>& vertices, float threshold)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if(triangleCount == 0)
+        {
+            return 0;
+        }
+        const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+
+        // hard boundaries: triangles sharing nothing with the cache, reordering there costs no cache hits
+        std::vector<uint32_t> hardClusters;
+        {
+            FifoCache cache{vertexCount, FIFO_CACHE_SIZE};
+            for(size_t t = 0; t < triangleCount; t++)
+            {
+                const uint32_t misses = cache.access(indices[3 * t]) + cache.access(indices[3 * t + 1]) + cache.access(indices[3 * t + 2]);
+                if(misses == 3 || t == 0)
+                {
+                    hardClusters.push_back(static_cast<uint32_t>(t));
+                }
+            }
+        }
+        hardClusters.push_back(static_cast<uint32_t>(triangleCount));
+
+        // soft boundaries: split a hard cluster once the part so far, simulated from a flushed cache, is within
+        // threshold of the hard cluster's ACMR. The flush at every split is what the split costs
+        std::vector<uint32_t> clusters;
+        {
+            FifoCache cache{vertexCount, FIFO_CACHE_SIZE};
+            auto triangleMisses = [&](size_t t)
+            {
+                return cache.access(indices[3 * t]) + cache.access(indices[3 * t + 1]) + cache.access(indices[3 * t + 2]);
+            };
+
+            for(size_t h = 0; h + 1 < hardClusters.size(); h++)
+            {
+                const uint32_t begin = hardClusters[h];
+                const uint32_t end = hardClusters[h + 1];
+
+                cache.flush();
+                uint32_t hardMisses = 0;
+                for(uint32_t t = begin; t < end; t++)
+                {
+                    hardMisses += triangleMisses(t);
+                }
+                const float hardAcmr = static_cast<float>(hardMisses) / static_cast<float>(end - begin);
+
+                cache.flush();
+                clusters.push_back(begin);
+                uint32_t clusterBegin = begin;
+                uint32_t clusterMisses = 0;
+                for(uint32_t t = begin; t < end; t++)
+                {
+                    clusterMisses += triangleMisses(t);
+                    const float clusterAcmr = static_cast<float>(clusterMisses) / static_cast<float>(t + 1 - clusterBegin);
+                    if(t + 1 < end && clusterAcmr <= threshold * hardAcmr)
+                    {
+                        cache.flush();
+                        clusters.push_back(t + 1);
+                        clusterBegin = t + 1;
+                        clusterMisses = 0;
+                    }
+                }
+            }
+        }
+        const uint32_t clusterCount = static_cast<uint32_t>(clusters.size());
+        clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+        // area weighted centroid and normal per cluster
+        std::vector<glm::vec3> centroids(clusterCount, glm::vec3{0.0f});
+        std::vector<glm::vec3> normals(clusterCount, glm::vec3{0.0f});
+        std::vector<float> areas(clusterCount, 0.0f);
+        glm::vec3 meshCentroid{0.0f};
+        float meshArea = 0.0f;
+        for(uint32_t c = 0; c < clusterCount; c++)
+        {
+            for(uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                const glm::vec3& p0 = vertices[indices[3 * t]].position;
+                const glm::vec3& p1 = vertices[indices[3 * t + 1]].position;
+                const glm::vec3& p2 = vertices[indices[3 * t + 2]].position;
+                const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                const float area = 0.5f * glm::length(normal);
+
+                centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+                normals[c] += normal;
+                areas[c] += area;
+            }
+            meshCentroid += centroids[c];
+            meshArea += areas[c];
+        }
+        if(meshArea > 0.0f)
+        {
+            meshCentroid /= meshArea;
+        }
+
+        // clusters facing away from the center are on the outside of the mesh, drawn first they hide what is behind them
+        std::vector<float> sortKeys(clusterCount, 0.0f);
+        for(uint32_t c = 0; c < clusterCount; c++)
+        {
+            const float normalLength = glm::length(normals[c]);
+            if(areas[c] > 0.0f && normalLength > 0.0f)
+            {
+                sortKeys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / normalLength);
+            }
+        }
+
+        std::vector<uint32_t> order(clusterCount);
+        for(uint32_t c = 0; c < clusterCount; c++)
+        {
+            order[c] = c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for(uint32_t c : order)
+        {
+            output.insert(output.end(), indices.begin() + 3 * size_t(clusters[c]), indices.begin() + 3 * size_t(clusters[c + 1]));
+        }
+        indices.swap(output);
+        return clusterCount;
+    }
+
+    void MeshOptimizer::optimizeVertexFetch(Vk::LveModel::Builder& builder)
+    {
+        constexpr uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(builder.vertices.size(), UNUSED);
+        std::vector<Vk::LveModel::Vertex> vertices;
+        vertices.reserve(builder.vertices.size());
+
+        for(uint32_t& index : builder.indices)
+        {
+            if(remap[index] == UNUSED)
+            {
+                remap[index] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(builder.vertices[index]);
+            }
+            index = remap[index];
+        }
+        builder.vertices.swap(vertices);
+    }
+
+    MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        CacheStats stats{};
+        if(indices.empty())
+        {
+            return stats;
+        }
+
+        FifoCache cache{vertexCount, cacheSize};
+        std::vector<uint8_t> referenced(vertexCount, 0);
+        uint32_t misses = 0;
+        uint32_t referencedCount = 0;
+        for(uint32_t index : indices)
+        {
+            misses += cache.access(index);
+            if(referenced[index] == 0)
+            {
+                referenced[index] = 1;
+                referencedCount++;
+            }
+        }
+
+        stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        stats.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+        return stats;
+    }
+
+    void MeshOptimizer::runBenchmark(uint32_t gridSize)
+    {
+        const uint32_t n = std::max<uint32_t>(gridSize, 2);
+        constexpr float PI = 3.14159265f;
+
+        Vk::LveModel::Builder grid{};
+        for(uint32_t y = 0; y <= n; y++)
+        {
+            for(uint32_t x = 0; x <= n; x++)
+            {
+                const float u = 2.0f * PI * static_cast<float>(x) / static_cast<float>(n);
+                const float v = PI * static_cast<float>(y) / static_cast<float>(n);
+                Vk::LveModel::Vertex vertex{};
+                vertex.position = {std::sin(v) * std::cos(u), std::cos(v), std::sin(v) * std::sin(u)};
+                vertex.normal = vertex.position;
+                vertex.uv = {static_cast<float>(x) / static_cast<float>(n), static_cast<float>(y) / static_cast<float>(n)};
+                grid.vertices.push_back(vertex);
+            }
+        }
+        for(uint32_t y = 0; y < n; y++)
+        {
+            for(uint32_t x = 0; x < n; x++)
+            {
+                const uint32_t a = y * (n + 1) + x;
+                const uint32_t b = a + n + 1;
+                grid.indices.insert(grid.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+            }
+        }
+
+        // same triangles in a deterministic random order, what an exporter without any ordering produces
+        Vk::LveModel::Builder shuffled = grid;
+        {
+            const size_t triangleCount = grid.indices.size() / 3;
+            std::vector<size_t> order(triangleCount);
+            for(size_t i = 0; i < triangleCount; i++)
+            {
+                order[i] = i;
+            }
+            std::mt19937 rng{1234};
+            std::shuffle(order.begin(), order.end(), rng);
+            for(size_t i = 0; i < triangleCount; i++)
+            {
+                for(size_t j = 0; j < 3; j++)
+                {
+                    shuffled.indices[3 * i + j] = grid.indices[3 * order[i] + j];
+                }
+            }
+        }
+
+        printf("mesh optimizer benchmark: %ux%u sphere grid, %zu vertices, %zu triangles, FIFO cache of %u\n",
+            n, n, grid.vertices.size(), grid.indices.size() / 3, FIFO_CACHE_SIZE);
+        auto print = [](const char* name, Vk::LveModel::Builder& builder)
+        {
+            const Report report = optimize(builder);
+            printf("  %-10s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u clusters\n",
+                name, report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr, report.clusterCount);
+        };
+        print("row order", grid);
+        print("shuffled", shuffled);
+    }
+}
@@ -0,0 +1,58 @@
+/*************************************************
+Mesh Optimizer (cook time, runs before a mesh goes into the MeshCache):
+1. vertex cache order: Tom Forsyth's linear speed vertex cache optimization, greedily emits the
+   triangle whose vertices score highest in a simulated LRU cache, scores favour recently used
+   vertices and vertices with few triangles left
+2. overdraw order: the cache optimized triangles are split into clusters (hard boundaries where a
+   triangle misses the whole cache, soft ones where a cluster's ACMR is within threshold of its hard
+   cluster's), clusters are drawn outward facing first so they occlude the rest of the mesh
+3. vertex fetch order: vertices are renumbered in the order the index buffer first uses them,
+   unreferenced vertices are dropped
+
+analyzeVertexCache simulates a FIFO post transform cache: ACMR is misses per triangle (0.5 at best,
+3 at worst), ATVR misses per referenced vertex (1 at best).
+runBenchmark prints the report for a generated sphere grid in row order and in shuffled order (--bench-mesh-optimizer).
+*************************************************/
+#pragma once
+
+#include "Vk/lve_model.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace EngineCore
+{
+    class MeshOptimizer
+    {
+    public:
+        static constexpr uint32_t FIFO_CACHE_SIZE = 16;         // of the simulated cache statistics are reported with
+        static constexpr float OVERDRAW_THRESHOLD = 1.05f;      // ACMR a soft cluster may lose against its hard cluster
+
+        struct CacheStats
+        {
+            float acmr = 0.0f;
+            float atvr = 0.0f;
+        };
+
+        struct Report
+        {
+            CacheStats before;
+            CacheStats after;
+            uint32_t clusterCount = 0;
+        };
+
+        // all three passes in order, builder's indices and vertices are rewritten in place
+        static Report optimize(Vk::LveModel::Builder& builder);
+
+        static void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+        // expects cache optimized indices, returns the number of clusters
+        static uint32_t optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vk::LveModel::Vertex>& vertices, float threshold = OVERDRAW_THRESHOLD);
+        static void optimizeVertexFetch(Vk::LveModel::Builder& builder);
+
+        static CacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = FIFO_CACHE_SIZE);
+
+        // gridSize quads around and gridSize quads from pole to pole
+        static void runBenchmark(uint32_t gridSize);
+    };
+}
@@ -1,4 +1,8 @@
 #include "model.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+
+#include "Platform/cpu_profiler.hpp"
 
 // libs
 #include "ThirdParty\utility.hpp"
@@ -29,27 +33,21 @@ namespace EngineCore
 {
     Model::Model(Vk::LveDevice& device): lveDevice{device} {}
 
-    void Model::bindAndDraw(VkCommandBuffer commandBuffer, Vk::DescriptorAllocator& descriptorAllocator, Vk::DescriptorLayoutCache& descriptorLayoutCache, VkPipelineLayout pipelineLayout, TextureManager& textureManager)
+    void Model::bindSubmesh(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t submesh, Vk::LveModel::BoundGeometry& boundGeometry)
     {
-        for(int i=0; i<lveModels.size(); i++)
-        {
-            auto& material = materials[i];
-
-            vkCmdBindDescriptorSets(
-                commandBuffer,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipelineLayout,
-                2,
-                1,
-                &material.descriptorSet,
-                0,
-                nullptr
-            );
-
-            auto& model = lveModels[i];
-            model->bind(commandBuffer);
-            model->draw(commandBuffer);
-        }
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            2,
+            1,
+            &materials[submesh].descriptorSet,
+            0,
+            nullptr
+        );
+
+        // all meshes of a block share its buffers, only the draw's offsets differ
+        lveModels[submesh]->bind(commandBuffer, boundGeometry);
     }
     
     std::unique_ptr<Model> Model::createModelFromFile(
@@ -58,10 +56,96 @@ namespace EngineCore
             Vk::DescriptorAllocator& descriptorAllocator, 
             Vk::DescriptorLayoutCache& descriptorLayoutCache, 
             const std::string& objPath, 
-            const std::string& mtlBasePath)
+            const std::string& mtlBasePath,
+            bool compactVertices)
     {
+        CPU_ZONE("Model::createModelFromFile");
         auto ret = std::make_unique<Model>(device);
 
+        const uint64_t sourceHash = MeshCache::hashSource(objPath, mtlBasePath);
+        const std::string cachePath = MeshCache::getCachePath(objPath);
+
+        // every submesh's vertex / index copy goes into one submission
+        Vk::LveUploadBatch uploadBatch{device.getUploadContext()};
+
+        // the cache keeps full vertices, the format is picked and encoded on every load
+        auto createSubmesh = [&](const Vk::LveModel::Vertex* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, VkIndexType indexType)
+        {
+            const auto format = Vk::LveModel::selectVertexFormat(vertices, vertexCount, compactVertices);
+            return std::make_unique<Vk::LveModel>(device, vertices, vertexCount, indices, indexCount, indexType, format, &uploadBatch);
+        };
+
+        MeshCache meshCache;
+        if(meshCache.open(cachePath, sourceHash))
+        {
+            // vertex / index data go from the mapping straight into the staging buffers
+            for(uint32_t i = 0; i < meshCache.getSubmeshCount(); i++)
+            {
+                const auto& submesh = meshCache.getSubmesh(i);
+                const auto& record = meshCache.getMaterial(submesh.materialIndex);
+
+                Material material{};
+                material.materialData = record.data;
+                material.ambientTextureName = record.ambientTextureName;
+                material.roughnessTextureName = record.roughnessTextureName;
+                material.metallicTextureName = record.metallicTextureName;
+
+                ret->addSubmesh(
+                    createSubmesh(meshCache.getVertices(submesh), submesh.vertexCount, meshCache.getIndices(submesh), submesh.indexCount, MeshCache::getIndexType(submesh)),
+                    material, textureManager, descriptorAllocator, descriptorLayoutCache);
+            }
+            uploadBatch.submitAndWait();
+            printf("Load %s from cache, shapes num %zu, material num %zu\n", objPath.c_str(), ret->lveModels.size(), ret->materials.size());
+            ret->printGeometryFormats();
+            return ret;
+        }
+
+        std::vector<Material> materials;
+        std::vector<Vk::LveModel::Builder> builders;
+        loadObj(objPath, mtlBasePath, materials, builders);
+
+        // cook time only, the cache keeps the optimized triangle and vertex order
+        {
+            CPU_ZONE("MeshOptimizer::optimize");
+            printf("Optimize %s\n", objPath.c_str());
+            for(size_t i = 0; i < builders.size(); i++)
+            {
+                const auto report = MeshOptimizer::optimize(builders[i]);
+                printf("    submesh %zu: %zu triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u overdraw clusters\n",
+                    i, builders[i].indices.size() / 3, report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr, report.clusterCount);
+            }
+        }
+
+        for(size_t i = 0; i < builders.size(); i++)
+        {
+            const auto& builder = builders[i];
+            ret->addSubmesh(
+                createSubmesh(builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()), builder.indices.data(), static_cast<uint32_t>(builder.indices.size()), VK_INDEX_TYPE_UINT32),
+                materials[i], textureManager, descriptorAllocator, descriptorLayoutCache);
+        }
+        uploadBatch.submitAndWait();
+
+        try
+        {
+            MeshCache::write(cachePath, sourceHash, materials, builders);
+        }
+        catch(const std::exception& e)
+        {
+            // not fatal, the next launch parses the OBJ again
+            printf("mesh cache not written: %s\n", e.what());
+        }
+
+        printf("Load %s, shapes num %zu, material num %zu\n", objPath.c_str(), ret->lveModels.size(), ret->materials.size());
+        ret->printGeometryFormats();
+        return ret;
+    }
+
+    void Model::loadObj(
+            const std::string& objPath, 
+            const std::string& mtlBasePath, 
+            std::vector<Material>& materials, 
+            std::vector<Vk::LveModel::Builder>& builders)
+    {
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
         std::vector<tinyobj::material_t> obj_materials;
@@ -89,21 +173,18 @@ namespace EngineCore
             {
                 std::filesystem::path ambientTextureName = obj_material.ambient_texname;
                 ambientTextureName = mtlBasePath / ambientTextureName;
-                textureManager.addTexture(ambientTextureName.string());
                 model_material.ambientTextureName = ambientTextureName.string();
             }
             if(obj_material.roughness_texname.empty() == false)
             {
                 std::filesystem::path roughnessTextureName = obj_material.roughness_texname;
                 roughnessTextureName = mtlBasePath / roughnessTextureName;
-                textureManager.addTexture(roughnessTextureName.string());
                 model_material.roughnessTextureName = roughnessTextureName.string();
             }
             if(obj_material.metallic_texname.empty() == false)
             {
                 std::filesystem::path metallicTextureName = obj_material.metallic_texname;
                 metallicTextureName = mtlBasePath / metallicTextureName;
-                textureManager.addTexture(metallicTextureName.string());
                 model_material.metallicTextureName = metallicTextureName.string();
             }
         }
@@ -177,46 +258,130 @@ namespace EngineCore
 
         }
 
-        // create submodel for each builder
-        for(int i=0; i<materialNum; i++)
+        // keep the non empty submeshes, one material each
+        for(size_t i = 0; i < materialNum; i++)
+        {
+            if(builder_array[i].indices.size() > 0 && builder_array[i].vertices.size() > 0)
+            {
+                builders.push_back(std::move(builder_array[i]));
+                materials.push_back(temp_materials[i]);
+            }
+        }
+    }
+
+    void Model::addSubmesh(
+            std::unique_ptr<Vk::LveModel> lveModel, 
+            const Material& material, 
+            TextureManager& textureManager, 
+            Vk::DescriptorAllocator& descriptorAllocator, 
+            Vk::DescriptorLayoutCache& descriptorLayoutCache)
+    {
+        const auto& submeshBox = lveModel->getBoundingBox();
+        if(lveModels.empty())
+        {
+            boundingBox = submeshBox;
+        }
+        else
+        {
+            boundingBox.min = glm::min(boundingBox.min, submeshBox.min);
+            boundingBox.max = glm::max(boundingBox.max, submeshBox.max);
+        }
+
+        materials.push_back(material);
+        Material& newMaterial = materials.back();
+
+        // the vertex shader dequantizes through the material ubo, it is per submesh anyway
+        const auto& quantization = lveModel->getQuantization();
+        newMaterial.materialData.positionScale = glm::vec4{quantization.positionScale, 0.0f};
+        newMaterial.materialData.positionOffset = glm::vec4{quantization.positionOffset, 0.0f};
+        newMaterial.materialData.uvScaleOffset = glm::vec4{quantization.uvScale, quantization.uvOffset};
+        lveModels.push_back(std::move(lveModel));
+
+        newMaterial.ubo = std::make_shared<Vk::LveBuffer>(
+            lveDevice,
+            sizeof(Material::Data),
+            1,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        newMaterial.ubo->map();
+        newMaterial.ubo->writeToBuffer(&newMaterial.materialData);
+
+        // decoded in the background, the descriptor set starts out with the placeholder
+        assert(newMaterial.ambientTextureName.empty() == false);
+        assert(newMaterial.metallicTextureName.empty() == false);
+        assert(newMaterial.roughnessTextureName.empty() == false);
+        newMaterial.ambientTexture = textureManager.requestTexture(newMaterial.ambientTextureName);
+        newMaterial.metallicTexture = textureManager.requestTexture(newMaterial.metallicTextureName);
+        newMaterial.roughnessTexture = textureManager.requestTexture(newMaterial.roughnessTextureName);
+
+        buildMaterialDescriptorSet(newMaterial, textureManager, descriptorAllocator, descriptorLayoutCache);
+    }
+
+    void Model::printGeometryFormats() const
+    {
+        uint64_t vertexBytes = 0;
+        uint64_t fullVertexBytes = 0;
+        uint64_t indexBytes = 0;
+        uint64_t fullIndexBytes = 0;
+        for(size_t i = 0; i < lveModels.size(); i++)
+        {
+            const auto& submesh = *lveModels[i];
+            vertexBytes += uint64_t(submesh.getVertexCount()) * Vk::LveModel::getVertexStride(submesh.getVertexFormat());
+            fullVertexBytes += uint64_t(submesh.getVertexCount()) * sizeof(Vk::LveModel::Vertex);
+            indexBytes += uint64_t(submesh.getIndexCount()) * Vk::LveModel::getIndexSize(submesh.getIndexType());
+            fullIndexBytes += uint64_t(submesh.getIndexCount()) * sizeof(uint32_t);
+            printf("    submesh %zu: %u vertices, %s, %u bit indices\n", i, submesh.getVertexCount(),
+                Vk::LveModel::getVertexFormatName(submesh.getVertexFormat()), Vk::LveModel::getIndexSize(submesh.getIndexType()) * 8);
+        }
+        printf("    vertex data %llu KB (%llu KB as full vertices), index data %llu KB (%llu KB as 32 bit)\n",
+            static_cast<unsigned long long>(vertexBytes / 1024), static_cast<unsigned long long>(fullVertexBytes / 1024),
+            static_cast<unsigned long long>(indexBytes / 1024), static_cast<unsigned long long>(fullIndexBytes / 1024));
+    }
+
+    void Model::updateMaterialDescriptors(TextureManager& textureManager, Vk::DescriptorAllocator& descriptorAllocator, Vk::DescriptorLayoutCache& descriptorLayoutCache)
+    {
+        if(textureGeneration == textureManager.getGeneration())
+        {
+            return;
+        }
+        textureGeneration = textureManager.getGeneration();
+
+        for(auto& material : materials)
         {
-            const auto& builder = builder_array[i];
-            if(builder.indices.size() > 0 && builder.vertices.size() > 0)
+            if(getResidentTextureMask(material, textureManager) != material.residentTextureMask)
             {
-                ret->lveModels.push_back(std::make_unique<Vk::LveModel>(device, builder));
-                ret->materials.push_back(temp_materials[i]);
-                ret->materials.back().ubo = std::make_shared<Vk::LveBuffer>(
-                    device,
-                    sizeof(Material::Data),
-                    1,
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-                ret->materials.back().ubo->map();
-                ret->materials.back().ubo->writeToBuffer(&ret->materials.back().materialData);
-
-                auto descriptorInfo = ret->materials.back().ubo->descriptorInfo();
-                Vk::DescriptorBuilder builder(descriptorLayoutCache, descriptorAllocator);
-                builder.bind_buffer(0, &descriptorInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
-
-                assert(ret->materials.back().ambientTextureName.empty() == false);
-                auto ambientTextureInfo = textureManager.getTexture(ret->materials.back().ambientTextureName)->getDescriptorImageInfo();
-                builder.bind_image(1, &ambientTextureInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-
-                assert(ret->materials.back().metallicTextureName.empty() == false);
-                auto matallicTextureInfo = textureManager.getTexture(ret->materials.back().metallicTextureName)->getDescriptorImageInfo();
-                builder.bind_image(2, &matallicTextureInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-
-                assert(ret->materials.back().roughnessTextureName.empty() == false);
-                auto roughnessTextureInfo = textureManager.getTexture(ret->materials.back().roughnessTextureName)->getDescriptorImageInfo();
-                builder.bind_image(3, &roughnessTextureInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-
-                builder.build(ret->materials.back().descriptorSet);
+                buildMaterialDescriptorSet(material, textureManager, descriptorAllocator, descriptorLayoutCache);
             }
         }
-        printf("Load %s, shapes num %d, material num %d\n", objPath.c_str(), ret->lveModels.size(), ret->materials.size());
+    }
 
-        
+    uint32_t Model::getResidentTextureMask(const Material& material, const TextureManager& textureManager)
+    {
+        return (textureManager.isResident(material.ambientTexture) ? 1u : 0u) |
+            (textureManager.isResident(material.metallicTexture) ? 2u : 0u) |
+            (textureManager.isResident(material.roughnessTexture) ? 4u : 0u);
+    }
 
-        return ret;
+    void Model::buildMaterialDescriptorSet(
+            Material& material, 
+            TextureManager& textureManager, 
+            Vk::DescriptorAllocator& descriptorAllocator, 
+            Vk::DescriptorLayoutCache& descriptorLayoutCache)
+    {
+        auto descriptorInfo = material.ubo->descriptorInfo();
+        Vk::DescriptorBuilder builder(descriptorLayoutCache, descriptorAllocator);
+        builder.bind_buffer(0, &descriptorInfo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+
+        auto ambientTextureInfo = textureManager.getDescriptorImageInfo(material.ambientTexture);
+        builder.bind_image(1, &ambientTextureInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+        auto matallicTextureInfo = textureManager.getDescriptorImageInfo(material.metallicTexture);
+        builder.bind_image(2, &matallicTextureInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+        auto roughnessTextureInfo = textureManager.getDescriptorImageInfo(material.roughnessTexture);
+        builder.bind_image(3, &roughnessTextureInfo, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+        builder.build(material.descriptorSet);
+        material.residentTextureMask = getResidentTextureMask(material, textureManager);
     }
-}
\ No newline at end of file
+}
@@ -20,21 +20,61 @@ namespace EngineCore
         Model(const Model&) = delete;
         Model& operator=(const Model&) = delete;
 
+        // compactVertices: every submesh may pick a compact vertex format, see LveModel::selectVertexFormat
         static std::unique_ptr<Model> createModelFromFile(
             Vk::LveDevice& device, 
             TextureManager& textureManager, 
             Vk::DescriptorAllocator& descriptorAllocator, 
             Vk::DescriptorLayoutCache& descriptorLayoutCache, 
             const std::string& filePath, 
-            const std::string& mtlBasePath);
+            const std::string& mtlBasePath,
+            bool compactVertices = true);
             
-        void bindAndDraw(VkCommandBuffer commandBuffer, Vk::DescriptorAllocator& descriptorAllocator, Vk::DescriptorLayoutCache& descriptorLayoutCache, VkPipelineLayout pipelineLayout, TextureManager& textureManager);
+        // rebuilds the descriptor sets of materials whose textures became resident since the last call, main thread only
+        void updateMaterialDescriptors(TextureManager& textureManager, Vk::DescriptorAllocator& descriptorAllocator, Vk::DescriptorLayoutCache& descriptorLayoutCache);
+
+        // submesh i is drawn with material i
+        uint32_t getSubmeshCount() const { return static_cast<uint32_t>(lveModels.size()); }
+        const Vk::LveModel& getSubmesh(uint32_t submesh) const { return *lveModels[submesh]; }
+        // binds the submesh's material (set2), and the vertex / index buffers of its geometry pool block unless
+        // boundGeometry already holds them (see LveModel::bind). The pipeline matching the submesh's vertex format and
+        // the draw are up to the caller
+        void bindSubmesh(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t submesh, Vk::LveModel::BoundGeometry& boundGeometry);
+
+        bool empty() const { return lveModels.empty(); }
+        // union of the submeshes' local space boxes, meaningless while empty()
+        const Vk::LveModel::BoundingBox& getBoundingBox() const { return boundingBox; }
         
     private:
+        // parses the OBJ into one builder per non empty material, materials[i] belongs to builders[i]
+        static void loadObj(
+            const std::string& objPath, 
+            const std::string& mtlBasePath, 
+            std::vector<Material>& materials, 
+            std::vector<Vk::LveModel::Builder>& builders);
+        // takes ownership of the mesh, creates the material's ubo and descriptor set
+        void addSubmesh(
+            std::unique_ptr<Vk::LveModel> lveModel, 
+            const Material& material, 
+            TextureManager& textureManager, 
+            Vk::DescriptorAllocator& descriptorAllocator, 
+            Vk::DescriptorLayoutCache& descriptorLayoutCache);
+        // vertex format and index type per submesh, the bytes saved against full vertices and 32 bit indices
+        void printGeometryFormats() const;
+        static uint32_t getResidentTextureMask(const Material& material, const TextureManager& textureManager);
+        // allocates a new set, the old one may still be referenced by frames in flight
+        static void buildMaterialDescriptorSet(
+            Material& material, 
+            TextureManager& textureManager, 
+            Vk::DescriptorAllocator& descriptorAllocator, 
+            Vk::DescriptorLayoutCache& descriptorLayoutCache);
+
         std::vector<std::unique_ptr<Vk::LveModel>> lveModels;
         std::vector<Material> materials;
+        Vk::LveModel::BoundingBox boundingBox;
 
         Vk::LveDevice& lveDevice;
+        uint64_t textureGeneration = 0;
         
     };
 }
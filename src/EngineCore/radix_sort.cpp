@@ -0,0 +1,82 @@
+#include "radix_sort.hpp"
+
+// std
+#include <cstring>
+#include <utility>
+
+namespace EngineCore
+{
+    void RadixSorter::reserve(size_t count)
+    {
+        items.reserve(count);
+        scratch.reserve(count);
+    }
+
+    void RadixSorter::push(float key, uint32_t index)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        // positive floats: set the sign bit so they sort above the negatives,
+        // negative floats: flip every bit so a larger magnitude sorts lower
+        bits ^= (bits & 0x80000000u) != 0 ? 0xFFFFFFFFu : 0x80000000u;
+        items.push_back({bits, index});
+    }
+
+    void RadixSorter::sort(Order order)
+    {
+        const size_t count = items.size();
+        if(count < 2)
+        {
+            return;
+        }
+        scratch.resize(count);
+
+        // descending sorts the inverted keys ascending, so ties still keep the push order
+        const uint32_t keyMask = order == Order::Descending ? 0xFFFFFFFFu : 0u;
+
+        // histograms of all four bytes in one read
+        uint32_t histograms[4][256] = {};
+        for(const Item& item : items)
+        {
+            const uint32_t key = item.key ^ keyMask;
+            histograms[0][key & 0xFF]++;
+            histograms[1][(key >> 8) & 0xFF]++;
+            histograms[2][(key >> 16) & 0xFF]++;
+            histograms[3][key >> 24]++;
+        }
+
+        Item* source = items.data();
+        Item* destination = scratch.data();
+        for(uint32_t pass = 0; pass < 4; pass++)
+        {
+            const uint32_t shift = pass * 8;
+            uint32_t* histogram = histograms[pass];
+            if(histogram[((source[0].key ^ keyMask) >> shift) & 0xFF] == count)
+            {
+                // every key has the same byte here, the pass would not move anything
+                continue;
+            }
+
+            // exclusive prefix sum: first output slot of every bucket
+            uint32_t offset = 0;
+            for(uint32_t bucket = 0; bucket < 256; bucket++)
+            {
+                const uint32_t bucketCount = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketCount;
+            }
+
+            for(size_t i = 0; i < count; i++)
+            {
+                const uint32_t bucket = ((source[i].key ^ keyMask) >> shift) & 0xFF;
+                destination[histogram[bucket]++] = source[i];
+            }
+            std::swap(source, destination);
+        }
+
+        if(source != items.data())
+        {
+            items.swap(scratch);
+        }
+    }
+}
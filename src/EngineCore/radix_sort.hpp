@@ -0,0 +1,47 @@
+/*************************************************
+Radix Sorter:
+1. sorts (float key, uint32 index) pairs, e.g. camera distances of transparent sprites
+2. LSD radix sort over the 32 key bits, 8 bits per pass, the float bits are flipped so their
+   unsigned order matches the float order (negative keys included, NaN is not supported)
+3. stable: equal keys keep the order they were pushed in, for both directions
+4. passes where every key has the same byte are skipped, the item and scratch arrays are kept
+   between frames, so a steady number of items sorts without allocations
+*************************************************/
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace EngineCore
+{
+    class RadixSorter
+    {
+    public:
+        enum class Order
+        {
+            Ascending,
+            Descending,
+        };
+
+        struct Item
+        {
+            uint32_t key;       // flipped float bits, see push
+            uint32_t index;
+        };
+
+        void clear() { items.clear(); }
+        void reserve(size_t count);
+        void push(float key, uint32_t index);
+        void sort(Order order = Order::Ascending);
+
+        size_t size() const { return items.size(); }
+        // sorted after sort(), in push order before
+        const std::vector<Item>& getItems() const { return items; }
+
+    private:
+        std::vector<Item> items;
+        std::vector<Item> scratch;
+    };
+}
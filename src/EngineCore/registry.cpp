@@ -0,0 +1,74 @@
+#include "registry.hpp"
+
+// std
+#include <stdexcept>
+
+namespace EngineCore
+{
+    Entity Registry::create()
+    {
+        structureVersion++;
+        if(freeIndices.empty() == false)
+        {
+            const uint32_t index = freeIndices.back();
+            freeIndices.pop_back();
+            return Entity{index, generations[index]};
+        }
+
+        const uint32_t index = static_cast<uint32_t>(generations.size());
+        assert(index != Entity::INVALID_INDEX && "entity indices exhausted");
+        generations.push_back(0);
+        return Entity{index, 0};
+    }
+
+    void Registry::destroy(Entity entity)
+    {
+        if(isAlive(entity) == false)
+        {
+            return;
+        }
+
+        structureVersion++;
+        std::apply([&entity](auto&... pool){ (pool.erase(entity.index), ...); }, pools);
+
+        // old handles no longer match once the index is reused
+        generations[entity.index]++;
+        freeIndices.push_back(entity.index);
+    }
+
+    void Registry::setParent(Entity child, Entity parent)
+    {
+        auto& transform = get<TransformComponent>(child);
+        if(isAlive(parent))
+        {
+            assert(has<TransformComponent>(parent) && "parent needs a transform");
+            // walk up from the new parent, meeting the child there would close a cycle
+            for(const TransformComponent* ancestor = &get<TransformComponent>(parent); ancestor != nullptr; ancestor = tryGet<TransformComponent>(ancestor->parent))
+            {
+                if(ancestor == &transform)
+                {
+                    throw std::runtime_error("failed to set parent, the hierarchy would contain a cycle!");
+                }
+            }
+            transform.parent = parent;
+        }
+        else
+        {
+            transform.parent = Entity{};
+        }
+
+        transform.markDirty();
+        structureVersion++;
+    }
+
+    Entity Registry::createPointLight(float intensity, float radius, glm::vec3 color)
+    {
+        const Entity entity = create();
+        auto& transform = add<TransformComponent>(entity);
+        transform.setScale({radius, 1.0f, 1.0f});
+        auto& pointLight = add<PointLightComponent>(entity);
+        pointLight.lightIntensity = intensity;
+        pointLight.color = color;
+        return entity;
+    }
+}
@@ -0,0 +1,180 @@
+/*************************************************
+Registry Class (ECS):
+1. entities are handles (index + generation), a destroyed index is reused with a new generation
+   so stale handles are detected
+2. every component type lives in its own ComponentPool: a sparse set with the components packed
+   densely in one array, systems iterate that array linearly
+3. create / destroy / add / remove / lookup are O(1), removal swaps the last component into the hole
+
+4. transforms may have a parent entity (setParent), TransformSystem orders them parents first
+
+Component pointers and dense indices stay valid until a component of that type is added or removed,
+getStructureVersion() changes whenever that may have happened. Main thread only.
+*************************************************/
+#pragma once
+
+#include "components.hpp"
+
+// std
+#include <cassert>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace EngineCore
+{
+    template<typename T>
+    class ComponentPool
+    {
+    public:
+        size_t size() const { return components.size(); }
+        bool empty() const { return components.empty(); }
+
+        // dense arrays, components[i] belongs to entities[i]
+        T* data() { return components.data(); }
+        const Entity* entities() const { return denseEntities.data(); }
+        T& at(size_t denseIndex) { return components[denseIndex]; }
+        Entity entityAt(size_t denseIndex) const { return denseEntities[denseIndex]; }
+
+        typename std::vector<T>::iterator begin() { return components.begin(); }
+        typename std::vector<T>::iterator end() { return components.end(); }
+
+        bool has(uint32_t entityIndex) const
+        {
+            return entityIndex < sparse.size() && sparse[entityIndex] != INVALID_DENSE;
+        }
+
+        T* tryGet(uint32_t entityIndex)
+        {
+            return has(entityIndex) ? &components[sparse[entityIndex]] : nullptr;
+        }
+
+        T& get(uint32_t entityIndex)
+        {
+            assert(has(entityIndex) && "entity does not have this component");
+            return components[sparse[entityIndex]];
+        }
+
+        T& insert(Entity entity, T&& component)
+        {
+            if(entity.index >= sparse.size())
+            {
+                sparse.resize(entity.index + 1, INVALID_DENSE);
+            }
+            if(sparse[entity.index] != INVALID_DENSE)
+            {
+                // replaces the old component
+                T& existing = components[sparse[entity.index]];
+                existing = std::move(component);
+                return existing;
+            }
+
+            sparse[entity.index] = static_cast<uint32_t>(components.size());
+            denseEntities.push_back(entity);
+            components.push_back(std::move(component));
+            return components.back();
+        }
+
+        void erase(uint32_t entityIndex)
+        {
+            if(has(entityIndex) == false)
+            {
+                return;
+            }
+
+            // keep the arrays packed: the last component moves into the hole
+            const uint32_t hole = sparse[entityIndex];
+            const uint32_t last = static_cast<uint32_t>(components.size()) - 1;
+            if(hole != last)
+            {
+                components[hole] = std::move(components[last]);
+                denseEntities[hole] = denseEntities[last];
+                sparse[denseEntities[hole].index] = hole;
+            }
+            components.pop_back();
+            denseEntities.pop_back();
+            sparse[entityIndex] = INVALID_DENSE;
+        }
+
+        void clear()
+        {
+            sparse.clear();
+            denseEntities.clear();
+            components.clear();
+        }
+
+    private:
+        static constexpr uint32_t INVALID_DENSE = UINT32_MAX;
+
+        std::vector<uint32_t> sparse;           // entity index -> dense index
+        std::vector<Entity> denseEntities;
+        std::vector<T> components;
+    };
+
+    class Registry
+    {
+    public:
+        Registry() = default;
+        Registry(const Registry&) = delete;
+        Registry& operator=(const Registry&) = delete;
+
+        Entity create();
+        // removes every component, the handle (and copies of it) become invalid
+        void destroy(Entity entity);
+        bool isAlive(Entity entity) const
+        {
+            return entity.index < generations.size() && generations[entity.index] == entity.generation;
+        }
+        size_t getEntityCount() const { return generations.size() - freeIndices.size(); }
+
+        // child and parent need a transform, an invalid parent makes child a root again
+        void setParent(Entity child, Entity parent);
+        // bumped by every create / destroy / add / remove / setParent
+        uint64_t getStructureVersion() const { return structureVersion; }
+
+        // transform + point light, the transform's scale.x is the billboard radius
+        Entity createPointLight(float intensity = 10.0f, float radius = 0.1f, glm::vec3 color = glm::vec3{1.0f});
+
+        template<typename T>
+        ComponentPool<T>& getPool() { return std::get<ComponentPool<T>>(pools); }
+
+        template<typename T>
+        T& add(Entity entity, T component = T{})
+        {
+            assert(isAlive(entity) && "adding a component to a dead entity");
+            structureVersion++;
+            return getPool<T>().insert(entity, std::move(component));
+        }
+
+        template<typename T>
+        void remove(Entity entity)
+        {
+            assert(isAlive(entity) && "removing a component from a dead entity");
+            structureVersion++;
+            getPool<T>().erase(entity.index);
+        }
+
+        template<typename T>
+        bool has(Entity entity) { return isAlive(entity) && getPool<T>().has(entity.index); }
+
+        template<typename T>
+        T* tryGet(Entity entity) { return isAlive(entity) ? getPool<T>().tryGet(entity.index) : nullptr; }
+
+        template<typename T>
+        T& get(Entity entity)
+        {
+            assert(isAlive(entity) && "stale entity handle");
+            return getPool<T>().get(entity.index);
+        }
+
+    private:
+        std::vector<uint32_t> generations;      // [entity index], bumped on destroy so no live handle matches a free index
+        std::vector<uint32_t> freeIndices;
+        uint64_t structureVersion = 0;
+
+        std::tuple<
+            ComponentPool<TransformComponent>,
+            ComponentPool<ModelComponent>,
+            ComponentPool<PointLightComponent>> pools;
+    };
+}
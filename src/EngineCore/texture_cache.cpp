@@ -0,0 +1,109 @@
+#include "texture_cache.hpp"
+
+#include "Platform/atomic_file_writer.hpp"
+#include "ThirdParty/utility.hpp"
+
+// std
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+namespace EngineCore
+{
+    using Platform::SECTION_ALIGNMENT;
+    using Platform::alignSection;
+
+    std::string TextureCache::getCachePath(const std::string& imagePath)
+    {
+        const std::filesystem::path path{imagePath};
+        const uint64_t pathHash = Util::fnv1a64(imagePath.data(), imagePath.size());
+
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "_%016llx.lvetex", static_cast<unsigned long long>(pathHash));
+        return (std::filesystem::path("./build/TextureCache") / (path.stem().string() + suffix)).string();
+    }
+
+    uint64_t TextureCache::hashSource(const std::string& imagePath)
+    {
+        Platform::MappedFile imageFile{imagePath};
+        if(imageFile.isOpen() == false)
+        {
+            throw std::runtime_error("failed to open texture image: " + imagePath);
+        }
+
+        uint64_t hash = Util::fnv1a64(&VERSION, sizeof(VERSION));
+        return Util::fnv1a64(imageFile.data(), imageFile.size(), hash);
+    }
+
+    void TextureCache::write(const std::string& cachePath, uint64_t sourceHash, const Vk::LveTexture::Builder& builder)
+    {
+        Header header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.sourceHash = sourceHash;
+        header.width = static_cast<uint32_t>(builder.width);
+        header.height = static_cast<uint32_t>(builder.height);
+        header.mipLevels = builder.mipLevels;
+        header.format = static_cast<uint32_t>(Vk::LveTexture::FORMAT);
+        header.dataOffset = alignSection(sizeof(Header));
+        header.dataSize = builder.getDataSize();
+        header.fileSize = header.dataOffset + header.dataSize;
+
+        Platform::AtomicFileWriter out{cachePath};
+        out.write(&header, sizeof(header));
+        out.padTo(header.dataOffset);
+        out.write(builder.data, header.dataSize);
+        out.commit();
+    }
+
+    bool TextureCache::open(const std::string& cachePath, uint64_t sourceHash)
+    {
+        file = Platform::MappedFile{cachePath};
+        if(file.isOpen() && validate(sourceHash))
+        {
+            return true;
+        }
+
+        file.close();
+        header = nullptr;
+        return false;
+    }
+
+    void TextureCache::fillBuilder(Vk::LveTexture::Builder& builder) const
+    {
+        builder.setExternalData(
+            static_cast<int>(header->width),
+            static_cast<int>(header->height),
+            header->mipLevels,
+            file.data() + header->dataOffset);
+    }
+
+    bool TextureCache::validate(uint64_t sourceHash)
+    {
+        if(file.size() < sizeof(Header))
+        {
+            return false;
+        }
+
+        header = reinterpret_cast<const Header*>(file.data());
+        if(header->magic != MAGIC || header->version != VERSION || header->sourceHash != sourceHash ||
+            header->format != static_cast<uint32_t>(Vk::LveTexture::FORMAT) || header->fileSize != file.size())
+        {
+            return false;
+        }
+
+        if(header->width == 0 || header->height == 0 || header->width > INT32_MAX || header->height > INT32_MAX ||
+            header->mipLevels == 0 || header->mipLevels > Vk::LveTexture::getMipLevelCount(static_cast<int>(header->width), static_cast<int>(header->height)))
+        {
+            return false;
+        }
+
+        // the pixel data has to be exactly the packed chain the header describes
+        Vk::LveTexture::Builder expected;
+        expected.setExternalData(static_cast<int>(header->width), static_cast<int>(header->height), header->mipLevels, nullptr);
+        return header->dataOffset % SECTION_ALIGNMENT == 0 &&
+            header->dataOffset <= file.size() &&
+            header->dataSize == expected.getDataSize() &&
+            header->dataSize <= file.size() - header->dataOffset;
+    }
+}
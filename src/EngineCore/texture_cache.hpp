@@ -0,0 +1,60 @@
+/*************************************************
+Texture Cache Class:
+1. cooked copy of a decoded image: rgba8 pixels with the full mip chain, ready for the staging buffer
+2. keyed by a hash of the source image file, stale or foreign-version files are ignored and rewritten
+3. read through a memory mapping, the decode threads skip stbi and the mip filter on a hit
+
+File layout (16 byte aligned sections):
+    Header | mip 0 | mip 1 | ... (tightly packed, like LveTexture::Builder data)
+*************************************************/
+#pragma once
+
+#include "Platform/mapped_file.hpp"
+#include "Vk/lve_texture.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace EngineCore
+{
+    class TextureCache
+    {
+    public:
+        static constexpr uint32_t MAGIC = 0x5445564C; // "LVET"
+        static constexpr uint32_t VERSION = 1;
+
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t sourceHash;
+            uint32_t width;
+            uint32_t height;
+            uint32_t mipLevels;
+            uint32_t format;        // VkFormat of the pixel data
+            uint64_t dataOffset;
+            uint64_t dataSize;
+            uint64_t fileSize;
+        };
+
+        // ./build/TextureCache/<image name>_<path hash>.lvetex
+        static std::string getCachePath(const std::string& imagePath);
+        // hashes the image file, any edit to it invalidates the cache
+        static uint64_t hashSource(const std::string& imagePath);
+
+        static void write(const std::string& cachePath, uint64_t sourceHash, const Vk::LveTexture::Builder& builder);
+
+        // maps the cache file, returns false (and stays closed) when it is missing, stale or malformed
+        bool open(const std::string& cachePath, uint64_t sourceHash);
+
+        // the builder points into the mapping, keep this cache open until the data is uploaded
+        void fillBuilder(Vk::LveTexture::Builder& builder) const;
+
+    private:
+        bool validate(uint64_t sourceHash);
+
+        Platform::MappedFile file;
+        const Header* header = nullptr;
+    };
+}
@@ -1,23 +1,280 @@
 #include "texture_manager.hpp"
 
+#include "Platform/cpu_profiler.hpp"
+
 // std
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <stdexcept>
 
 namespace EngineCore
 {
-    Vk::LveTexture* TextureManager::addTexture(const std::string& filePath)
+    TextureManager::TextureManager(Vk::LveDevice& device, uint32_t decodeThreadCount): device(device)
+    {
+        // mid grey reads as a neutral albedo / roughness / metallic until the real image arrives
+        const uint8_t placeholderColor[4] = {128, 128, 128, 255};
+        placeholder = Vk::LveTexture::createSolidColorTexture(device, placeholderColor);
+
+        if(decodeThreadCount == 0)
+        {
+            decodeThreadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+        for(uint32_t i = 0; i < decodeThreadCount; i++)
+        {
+            decodeThreads.emplace_back(&TextureManager::decodeLoop, this);
+        }
+    }
+
+    TextureManager::~TextureManager()
     {
-        if(textureRepo.find(filePath) == textureRepo.end())
         {
-            textureRepo[filePath] = Vk::LveTexture::createTextureFromFile(device, filePath);
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        decodeCondition.notify_all();
+        for(auto& thread : decodeThreads)
+        {
+            thread.join();
         }
 
-        return textureRepo[filePath].get();
+        // textures and staging buffers of in flight batches must outlive their submission
+        retireUploads(true);
+    }
+
+    TextureHandle TextureManager::requestTexture(const std::string& filePath)
+    {
+        auto it = handles.find(filePath);
+        if(it != handles.end())
+        {
+            return it->second;
+        }
+
+        const TextureHandle handle = static_cast<TextureHandle>(entries.size());
+        entries.push_back(Entry{filePath});
+        handles[filePath] = handle;
+        pendingCount++;
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            decodeQueue.emplace_back(handle, filePath);
+        }
+        decodeCondition.notify_one();
+        return handle;
+    }
+
+    Vk::LveTexture* TextureManager::addTexture(const std::string& filePath)
+    {
+        const TextureHandle handle = requestTexture(filePath);
+        finishPendingUploads();
+
+        if(entries[handle].texture == nullptr)
+        {
+            throw std::runtime_error("failed to load texture image!");
+        }
+        return entries[handle].texture.get();
     }
 
     Vk::LveTexture* TextureManager::getTexture(const std::string& filePath)
     {
-        assert(textureRepo.find(filePath) != textureRepo.end());
-        return textureRepo[filePath].get();
+        assert(handles.find(filePath) != handles.end());
+        return entries[handles[filePath]].texture.get();
+    }
+
+    VkDescriptorImageInfo TextureManager::getDescriptorImageInfo(TextureHandle handle)
+    {
+        if(isResident(handle))
+        {
+            return entries[handle].texture->getDescriptorImageInfo();
+        }
+        return placeholder->getDescriptorImageInfo();
+    }
+
+    bool TextureManager::isResident(TextureHandle handle) const
+    {
+        return handle < entries.size() && entries[handle].texture != nullptr;
+    }
+
+    void TextureManager::update()
+    {
+        CPU_ZONE("TextureManager::update");
+        retireUploads(false);
+        submitDecodedImages();
+    }
+
+    void TextureManager::finishPendingUploads()
+    {
+        while(pendingCount > 0)
+        {
+            // nothing to submit or wait for, so some image is still being decoded
+            if(readyImages.empty() && pendingUploads.empty())
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                decodedCondition.wait(lock, [this]{ return decodedImages.empty() == false; });
+            }
+
+            submitDecodedImages();
+            retireUploads(true);
+        }
+    }
+
+    void TextureManager::decodeLoop()
+    {
+        Platform::CpuProfiler::setThreadName("TextureDecode");
+        while(true)
+        {
+            std::pair<TextureHandle, std::string> request;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                decodeCondition.wait(lock, [this]{ return stopping || decodeQueue.empty() == false; });
+                if(stopping)
+                {
+                    return;
+                }
+                request = std::move(decodeQueue.front());
+                decodeQueue.pop_front();
+            }
+
+            DecodedImage image{request.first};
+            try
+            {
+                decodeTexture(request.second, image);
+            }
+            catch(const std::exception&)
+            {
+                image.builder.reset();
+                image.cache.reset();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                decodedImages.push_back(std::move(image));
+            }
+            decodedCondition.notify_all();
+        }
+    }
+
+    void TextureManager::decodeTexture(const std::string& filePath, DecodedImage& image)
+    {
+        CPU_ZONE("TextureManager::decodeTexture");
+        const std::string cachePath = TextureCache::getCachePath(filePath);
+        const uint64_t sourceHash = TextureCache::hashSource(filePath);
+
+        image.builder = std::make_unique<Vk::LveTexture::Builder>();
+        image.cache = std::make_unique<TextureCache>();
+        if(image.cache->open(cachePath, sourceHash))
+        {
+            image.cache->fillBuilder(*image.builder);
+            return;
+        }
+        image.cache.reset();
+
+        // filtered here rather than blitted on the gpu so the chain can be cooked
+        image.builder->loadTextureFromFile(filePath);
+        image.builder->generateMipmaps();
+        try
+        {
+            TextureCache::write(cachePath, sourceHash, *image.builder);
+        }
+        catch(const std::exception& e)
+        {
+            // not fatal, the next launch decodes the image again
+            printf("texture cache not written: %s\n", e.what());
+        }
+    }
+
+    void TextureManager::submitDecodedImages()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            for(auto& image : decodedImages)
+            {
+                readyImages.push_back(std::move(image));
+            }
+            decodedImages.clear();
+        }
+
+        // pick images up to the budget, the first one always goes so a huge image cannot block the queue
+        VkDeviceSize uploadSize = 0;
+        size_t batchEnd = 0;
+        for(; batchEnd < readyImages.size(); batchEnd++)
+        {
+            auto& image = readyImages[batchEnd];
+            if(image.builder == nullptr)
+            {
+                continue;
+            }
+
+            const VkDeviceSize imageSize = image.builder->getDataSize();
+            if(uploadSize > 0 && uploadSize + imageSize > UPLOAD_BUDGET_PER_UPDATE)
+            {
+                break;
+            }
+            uploadSize += imageSize;
+        }
+        if(batchEnd == 0)
+        {
+            return;
+        }
+
+        Vk::LveUploadBatch uploadBatch{device.getUploadContext()};
+        PendingUpload upload{};
+        for(size_t i = 0; i < batchEnd; i++)
+        {
+            auto& image = readyImages[i];
+            if(image.builder == nullptr)
+            {
+                // keeps the placeholder forever
+                printf("failed to load texture %s\n", entries[image.handle].filePath.c_str());
+                entries[image.handle].failed = true;
+                pendingCount--;
+                continue;
+            }
+
+            const auto& builder = *image.builder;
+            auto texture = std::make_unique<Vk::LveTexture>(device, builder.width, builder.height, builder.mipLevels);
+            const Vk::StagingRange staging = uploadBatch.stage(builder.data, builder.getDataSize());
+            texture->recordUpload(uploadBatch, staging, builder.mipLevels);
+            upload.textures.emplace_back(image.handle, std::move(texture));
+        }
+        readyImages.erase(readyImages.begin(), readyImages.begin() + batchEnd);
+
+        upload.ticket = uploadBatch.submit();
+        if(upload.textures.empty() == false)
+        {
+            pendingUploads.push_back(std::move(upload));
+        }
+    }
+
+    bool TextureManager::retireUploads(bool wait)
+    {
+        bool retired = false;
+        auto& uploadContext = device.getUploadContext();
+        for(auto it = pendingUploads.begin(); it != pendingUploads.end();)
+        {
+            if(wait)
+            {
+                uploadContext.wait(it->ticket);
+            }
+            if(uploadContext.isComplete(it->ticket) == false)
+            {
+                ++it;
+                continue;
+            }
+
+            for(auto& texture : it->textures)
+            {
+                entries[texture.first].texture = std::move(texture.second);
+                pendingCount--;
+            }
+            it = pendingUploads.erase(it);
+            retired = true;
+        }
+
+        if(retired)
+        {
+            generation++;
+        }
+        return retired;
     }
-}
\ No newline at end of file
+}
@@ -1,28 +1,104 @@
+/*************************************************
+Texture Manager Class:
+1. owns every texture, one per file path
+2. requestTexture: returns a handle at once, a pool of decode threads loads the cooked mip chain in the background
+   (or decodes, filters the mips and cooks it into the TextureCache on the first run)
+3. update (once per frame, main thread): records decoded images into one LveUploadBatch,
+   swaps the real image in once that batch completed
+4. until then a handle resolves to a 1x1 placeholder, getGeneration() tells users when to rebuild descriptors
+*************************************************/
 #pragma once
 
+#include "texture_cache.hpp"
+
 #include "Vk/lve_texture.hpp"
+#include "Vk/lve_upload_context.hpp"
 
 // std
-#include <unordered_map>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace EngineCore
 {
+    using TextureHandle = uint32_t;
+
     class TextureManager
     {
     public:
-        TextureManager(Vk::LveDevice& device): device(device) {}
-        ~TextureManager() = default;
+        static constexpr TextureHandle INVALID_TEXTURE = UINT32_MAX;
+        static constexpr VkDeviceSize UPLOAD_BUDGET_PER_UPDATE = 32 * 1024 * 1024; // staging bytes submitted per update()
+
+        // decodeThreadCount 0 picks one thread per hardware core minus the main thread
+        TextureManager(Vk::LveDevice& device, uint32_t decodeThreadCount = 0);
+        ~TextureManager();
         TextureManager(const TextureManager&) = delete;
         TextureManager& operator=(const TextureManager&) = delete;
 
+        TextureHandle requestTexture(const std::string& filePath);
+        // blocking, same as requestTexture followed by finishPendingUploads
         Vk::LveTexture* addTexture(const std::string& filePath);
         Vk::LveTexture* getTexture(const std::string& filePath);
 
+        // the placeholder's info while the texture is still decoding / uploading
+        VkDescriptorImageInfo getDescriptorImageInfo(TextureHandle handle);
+        bool isResident(TextureHandle handle) const;
+        // bumped every time at least one texture became resident
+        uint64_t getGeneration() const { return generation; }
+
+        void update();
+        // blocks until every requested texture is resident (or failed to load)
+        void finishPendingUploads();
+
     private:
+        struct Entry
+        {
+            std::string filePath;
+            std::unique_ptr<Vk::LveTexture> texture; // nullptr until the upload completed
+            bool failed = false;
+        };
+
+        struct DecodedImage
+        {
+            TextureHandle handle;
+            std::unique_ptr<Vk::LveTexture::Builder> builder; // nullptr when decoding failed
+            std::unique_ptr<TextureCache> cache;              // the mapping builder points into on a cache hit
+        };
+
+        struct PendingUpload
+        {
+            Vk::UploadTicket ticket = 0;
+            std::vector<std::pair<TextureHandle, std::unique_ptr<Vk::LveTexture>>> textures;
+        };
+
+        void decodeLoop();
+        static void decodeTexture(const std::string& filePath, DecodedImage& image);
+        void submitDecodedImages();
+        bool retireUploads(bool wait);
+
         Vk::LveDevice& device;
 
-        std::unordered_map<std::string, std::unique_ptr<Vk::LveTexture>> textureRepo;
+        std::vector<Entry> entries;                                 // indexed by handle, main thread only
+        std::unordered_map<std::string, TextureHandle> handles;
+        std::unique_ptr<Vk::LveTexture> placeholder;
+        uint64_t generation = 0;
+        uint32_t pendingCount = 0;                                  // requested, neither resident nor failed
+
+        // decode threads: decodeQueue in, decodedImages out, both guarded by mutex
+        std::vector<std::thread> decodeThreads;
+        std::mutex mutex;
+        std::condition_variable decodeCondition;
+        std::condition_variable decodedCondition;
+        std::deque<std::pair<TextureHandle, std::string>> decodeQueue;
+        std::vector<DecodedImage> decodedImages;
+        bool stopping = false;
+
+        std::vector<DecodedImage> readyImages;                      // decoded, waiting for upload budget
+        std::vector<PendingUpload> pendingUploads;                  // submitted, not yet seen complete
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,345 @@
+#include "transform_kernel.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_TRANSFORM_SSE2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace EngineCore
+{
+    namespace
+    {
+        // same math as TransformComponent::mat4() / normalMatrix(), sincos computed once for both
+        void buildScalar(const TransformSoA& in, size_t first, size_t count, PerObjectUboData* out, const uint32_t* outputIndices)
+        {
+            for(size_t i = first; i < count; i++)
+            {
+                const float c3 = std::cos(in.rotationZ[i]);
+                const float s3 = std::sin(in.rotationZ[i]);
+                const float c2 = std::cos(in.rotationX[i]);
+                const float s2 = std::sin(in.rotationX[i]);
+                const float c1 = std::cos(in.rotationY[i]);
+                const float s1 = std::sin(in.rotationY[i]);
+                const glm::vec3 scale{in.scaleX[i], in.scaleY[i], in.scaleZ[i]};
+                const glm::vec3 invScale = 1.0f / scale;
+
+                const glm::vec3 column0{c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1};
+                const glm::vec3 column1{c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3};
+                const glm::vec3 column2{c2 * s1, -s2, c1 * c2};
+
+                PerObjectUboData& data = out[outputIndices != nullptr ? outputIndices[i] : i];
+                data.modelMatrix[0] = glm::vec4(scale.x * column0, 0.0f);
+                data.modelMatrix[1] = glm::vec4(scale.y * column1, 0.0f);
+                data.modelMatrix[2] = glm::vec4(scale.z * column2, 0.0f);
+                data.modelMatrix[3] = glm::vec4(in.translationX[i], in.translationY[i], in.translationZ[i], 1.0f);
+                data.normalMatrix[0] = glm::vec4(invScale.x * column0, 0.0f);
+                data.normalMatrix[1] = glm::vec4(invScale.y * column1, 0.0f);
+                data.normalMatrix[2] = glm::vec4(invScale.z * column2, 0.0f);
+                data.normalMatrix[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            }
+        }
+    }
+
+#if defined(LVE_TRANSFORM_SSE2)
+    namespace sse2
+    {
+        struct Ops
+        {
+            using V = __m128;
+            using VI = __m128i;
+            static constexpr size_t LANES = 4;
+
+            static V load(const float* p) { return _mm_loadu_ps(p); }
+            static V set1(float value) { return _mm_set1_ps(value); }
+            static V add(V a, V b) { return _mm_add_ps(a, b); }
+            static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+            static V div(V a, V b) { return _mm_div_ps(a, b); }
+            static V bitXor(V a, V b) { return _mm_xor_ps(a, b); }
+            // mask ? a : b
+            static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+            // round to nearest (default mxcsr mode)
+            static V roundToInt(V x, VI& rounded)
+            {
+                rounded = _mm_cvtps_epi32(x);
+                return _mm_cvtepi32_ps(rounded);
+            }
+            static VI addOne(VI q) { return _mm_add_epi32(q, _mm_set1_epi32(1)); }
+            // float sign bit where bit 1 of q is set
+            static V signFromBit1(VI q) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30)); }
+            // all bits set where bit 0 of q is set
+            static V maskFromBit0(VI q)
+            {
+                const VI one = _mm_set1_epi32(1);
+                return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+            }
+
+            // lane l gets (x[l], y[l], z[l], w[l]) stored at dst[l] + offset
+            static void storeColumns(V x, V y, V z, V w, float* const* dst, size_t offset)
+            {
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+                _mm_storeu_ps(dst[0] + offset, x);
+                _mm_storeu_ps(dst[1] + offset, y);
+                _mm_storeu_ps(dst[2] + offset, z);
+                _mm_storeu_ps(dst[3] + offset, w);
+            }
+
+            static void finish() {}
+        };
+
+#include "transform_kernel_simd.inl"
+    }
+
+    // the AVX2 functions are compiled for AVX2 regardless of the global flags and only called when cpuid reports support
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+    namespace avx2
+    {
+        struct Ops
+        {
+            using V = __m256;
+            using VI = __m256i;
+            static constexpr size_t LANES = 8;
+
+            static V load(const float* p) { return _mm256_loadu_ps(p); }
+            static V set1(float value) { return _mm256_set1_ps(value); }
+            static V add(V a, V b) { return _mm256_add_ps(a, b); }
+            static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+            static V div(V a, V b) { return _mm256_div_ps(a, b); }
+            static V bitXor(V a, V b) { return _mm256_xor_ps(a, b); }
+            static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+
+            static V roundToInt(V x, VI& rounded)
+            {
+                rounded = _mm256_cvtps_epi32(x);
+                return _mm256_cvtepi32_ps(rounded);
+            }
+            static VI addOne(VI q) { return _mm256_add_epi32(q, _mm256_set1_epi32(1)); }
+            static V signFromBit1(VI q) { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30)); }
+            static V maskFromBit0(VI q)
+            {
+                const VI one = _mm256_set1_epi32(1);
+                return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+            }
+
+            // 4x4 transposes inside both 128 bit halves: the low half holds lanes 0-3, the high half lanes 4-7
+            static void storeColumns(V x, V y, V z, V w, float* const* dst, size_t offset)
+            {
+                const V xy0 = _mm256_unpacklo_ps(x, y);
+                const V xy1 = _mm256_unpackhi_ps(x, y);
+                const V zw0 = _mm256_unpacklo_ps(z, w);
+                const V zw1 = _mm256_unpackhi_ps(z, w);
+                const V column0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+                const V column1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+                const V column2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+                const V column3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+                _mm_storeu_ps(dst[0] + offset, _mm256_castps256_ps128(column0));
+                _mm_storeu_ps(dst[1] + offset, _mm256_castps256_ps128(column1));
+                _mm_storeu_ps(dst[2] + offset, _mm256_castps256_ps128(column2));
+                _mm_storeu_ps(dst[3] + offset, _mm256_castps256_ps128(column3));
+                _mm_storeu_ps(dst[4] + offset, _mm256_extractf128_ps(column0, 1));
+                _mm_storeu_ps(dst[5] + offset, _mm256_extractf128_ps(column1, 1));
+                _mm_storeu_ps(dst[6] + offset, _mm256_extractf128_ps(column2, 1));
+                _mm_storeu_ps(dst[7] + offset, _mm256_extractf128_ps(column3, 1));
+            }
+
+            // avoids the AVX -> SSE transition penalty in the code that follows
+            static void finish() { _mm256_zeroupper(); }
+        };
+
+#include "transform_kernel_simd.inl"
+    }
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+    namespace
+    {
+        bool detectAvx2()
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if(info[0] < 7)
+            {
+                return false;
+            }
+            // the os has to save the ymm registers (osxsave + xcr0 bits 1, 2)
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if(osxsave == false || avx == false || (_xgetbv(0) & 0x6) != 0x6)
+            {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__)
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+        }
+    }
+#endif
+
+    TransformKernel::Path TransformKernel::getBestPath()
+    {
+#if defined(LVE_TRANSFORM_SSE2)
+        static const Path best = detectAvx2() ? Path::AVX2 : Path::SSE2;
+        return best;
+#else
+        return Path::Scalar;
+#endif
+    }
+
+    bool TransformKernel::isSupported(Path path)
+    {
+        return static_cast<int>(path) <= static_cast<int>(getBestPath());
+    }
+
+    const char* TransformKernel::getPathName(Path path)
+    {
+        switch(path)
+        {
+        case Path::Scalar: return "scalar";
+        case Path::SSE2: return "sse2";
+        case Path::AVX2: return "avx2";
+        }
+        return "unknown";
+    }
+
+    void TransformKernel::build(const TransformSoA& input, size_t count, PerObjectUboData* out, const uint32_t* outputIndices)
+    {
+        build(input, count, out, outputIndices, getBestPath());
+    }
+
+    void TransformKernel::build(const TransformSoA& input, size_t count, PerObjectUboData* out, const uint32_t* outputIndices, Path path)
+    {
+        assert(isSupported(path) && "transform kernel path is not supported by this cpu");
+
+        size_t built = 0;
+#if defined(LVE_TRANSFORM_SSE2)
+        if(path == Path::AVX2)
+        {
+            built = avx2::buildBatch(input, count, out, outputIndices);
+        }
+        else if(path == Path::SSE2)
+        {
+            built = sse2::buildBatch(input, count, out, outputIndices);
+        }
+#endif
+        // scalar path, or the tail that does not fill a whole vector
+        buildScalar(input, built, count, out, outputIndices);
+    }
+
+    void TransformKernel::runBenchmark(uint32_t transformCount)
+    {
+        constexpr int RUNS = 25;
+        const size_t count = std::max<uint32_t>(transformCount, 1);
+
+        // deterministic random transforms, angles beyond one turn exercise the range reduction
+        std::mt19937 rng{1234};
+        std::uniform_real_distribution<float> translationDist{-50.0f, 50.0f};
+        std::uniform_real_distribution<float> rotationDist{-20.0f, 20.0f};
+        std::uniform_real_distribution<float> scaleDist{0.1f, 4.0f};
+
+        std::vector<TransformComponent> transforms(count);
+        std::vector<float> soa(9 * count);
+        for(size_t i = 0; i < count; i++)
+        {
+            const glm::vec3 translation{translationDist(rng), translationDist(rng), translationDist(rng)};
+            const glm::vec3 rotation{rotationDist(rng), rotationDist(rng), rotationDist(rng)};
+            const glm::vec3 scale{scaleDist(rng), scaleDist(rng), scaleDist(rng)};
+            transforms[i].setTranslation(translation);
+            transforms[i].setRotation(rotation);
+            transforms[i].setScale(scale);
+            for(int c = 0; c < 3; c++)
+            {
+                soa[(0 + c) * count + i] = translation[c];
+                soa[(3 + c) * count + i] = rotation[c];
+                soa[(6 + c) * count + i] = scale[c];
+            }
+        }
+        const TransformSoA input{
+            &soa[0 * count], &soa[1 * count], &soa[2 * count],
+            &soa[3 * count], &soa[4 * count], &soa[5 * count],
+            &soa[6 * count], &soa[7 * count], &soa[8 * count]};
+
+        std::vector<PerObjectUboData> reference(count);
+        std::vector<PerObjectUboData> result(count);
+
+        // best run in ns per transform
+        auto measure = [count](auto&& work)
+        {
+            double best = 1e30;
+            for(int run = 0; run < RUNS; run++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                work();
+                const auto end = std::chrono::steady_clock::now();
+                best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(count));
+            }
+            return best;
+        };
+
+        // what TransformSystem + the object upload did per transform before the kernel
+        const double baseline = measure([&]()
+        {
+            for(size_t i = 0; i < count; i++)
+            {
+                reference[i] = PerObjectUboData{transforms[i].mat4(), glm::mat4(transforms[i].normalMatrix())};
+            }
+        });
+
+        printf("transform benchmark: %zu transforms, best of %d runs\n", count, RUNS);
+        printf("  %-26s %8.2f ns/transform\n", "TransformComponent::mat4", baseline);
+
+        for(Path path : {Path::Scalar, Path::SSE2, Path::AVX2})
+        {
+            if(isSupported(path) == false)
+            {
+                printf("  %-26s not supported by this cpu\n", getPathName(path));
+                continue;
+            }
+
+            const double time = measure([&]()
+            {
+                build(input, count, result.data(), nullptr, path);
+            });
+
+            float maxError = 0.0f;
+            for(size_t i = 0; i < count; i++)
+            {
+                const float* a = &reference[i].modelMatrix[0][0];
+                const float* b = &result[i].modelMatrix[0][0];
+                for(size_t f = 0; f < sizeof(PerObjectUboData) / sizeof(float); f++)
+                {
+                    maxError = std::max(maxError, std::abs(a[f] - b[f]));
+                }
+            }
+            printf("  %-26s %8.2f ns/transform  %5.2fx  max error %.2e\n", getPathName(path), time, baseline / time, maxError);
+        }
+    }
+}
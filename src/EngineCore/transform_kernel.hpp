@@ -0,0 +1,58 @@
+/*************************************************
+Transform Kernel:
+1. builds model + normal matrices (PerObjectUboData, the layout of the gpu object buffer) for a batch
+   of transforms given as structure of arrays
+2. SSE2 and AVX2 paths process 4 / 8 transforms per iteration with a polynomial sincos, the scalar
+   path (and the tail of every batch) uses the same math as TransformComponent::mat4()
+3. the best path is picked at runtime from cpuid, AVX2 is only used when the cpu and os support it
+4. outputs go to out[i] or, with outputIndices, scatter to out[outputIndices[i]], so the kernel can
+   write straight into a mapped buffer
+
+runBenchmark compares the paths against the per object TransformComponent path (--bench-transforms).
+*************************************************/
+#pragma once
+
+#include "components.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace EngineCore
+{
+    // local TRS of count transforms, rotations are Y-X-Z euler angles in radians like TransformComponent
+    struct TransformSoA
+    {
+        const float* translationX;
+        const float* translationY;
+        const float* translationZ;
+        const float* rotationX;
+        const float* rotationY;
+        const float* rotationZ;
+        const float* scaleX;
+        const float* scaleY;
+        const float* scaleZ;
+    };
+
+    class TransformKernel
+    {
+    public:
+        enum class Path
+        {
+            Scalar,
+            SSE2,
+            AVX2,
+        };
+
+        // fastest path this cpu supports, detected once
+        static Path getBestPath();
+        static bool isSupported(Path path);
+        static const char* getPathName(Path path);
+
+        static void build(const TransformSoA& input, size_t count, PerObjectUboData* out, const uint32_t* outputIndices = nullptr);
+        static void build(const TransformSoA& input, size_t count, PerObjectUboData* out, const uint32_t* outputIndices, Path path);
+
+        // prints ns per transform of every supported path and their max error against TransformComponent
+        static void runBenchmark(uint32_t transformCount);
+    };
+}
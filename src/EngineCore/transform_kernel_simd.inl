@@ -0,0 +1,89 @@
+// SIMD body of the transform kernel, included once per instruction set by transform_kernel.cpp.
+// Expects an Ops struct in the enclosing namespace providing:
+//   V / VI, LANES, load, set1, add, sub, mul, div, bitXor, select, roundToInt, addOne, signFromBit1, maskFromBit0,
+//   storeColumns and finish (called once after the loop)
+
+// sin and cos of every lane: reduced to [-pi/4, pi/4] around the nearest multiple of pi/2, minimax
+// polynomials there (cephes sinf / cosf), then swapped / negated by quadrant
+static inline void sinCos(Ops::V x, Ops::V& sinOut, Ops::V& cosOut)
+{
+    Ops::VI quadrant;
+    const Ops::V k = Ops::roundToInt(Ops::mul(x, Ops::set1(0.63661977236758134f)), quadrant); // 2 / pi
+
+    // pi / 2 split in three parts, so the reduction stays exact for large k
+    Ops::V r = Ops::sub(x, Ops::mul(k, Ops::set1(1.5703125f)));
+    r = Ops::sub(r, Ops::mul(k, Ops::set1(4.837512969970703125e-4f)));
+    r = Ops::sub(r, Ops::mul(k, Ops::set1(7.54978995489188216e-8f)));
+    const Ops::V z = Ops::mul(r, r);
+
+    Ops::V sinR = Ops::add(Ops::mul(z, Ops::set1(-1.9515295891e-4f)), Ops::set1(8.3321608736e-3f));
+    sinR = Ops::add(Ops::mul(z, sinR), Ops::set1(-1.6666654611e-1f));
+    sinR = Ops::add(Ops::mul(Ops::mul(z, r), sinR), r);
+
+    Ops::V cosR = Ops::add(Ops::mul(z, Ops::set1(2.443315711809948e-5f)), Ops::set1(-1.388731625493765e-3f));
+    cosR = Ops::add(Ops::mul(z, cosR), Ops::set1(4.166664568298827e-2f));
+    cosR = Ops::add(Ops::mul(Ops::mul(z, z), cosR), Ops::sub(Ops::set1(1.0f), Ops::mul(z, Ops::set1(0.5f))));
+
+    // quadrant q: sin = (q odd ? cos(r) : sin(r)) negated for q = 2, 3; cos = (q odd ? sin(r) : cos(r)) negated for q = 1, 2
+    const Ops::V swap = Ops::maskFromBit0(quadrant);
+    sinOut = Ops::bitXor(Ops::select(swap, cosR, sinR), Ops::signFromBit1(quadrant));
+    cosOut = Ops::bitXor(Ops::select(swap, sinR, cosR), Ops::signFromBit1(Ops::addOne(quadrant)));
+}
+
+// processes full groups of LANES transforms, returns how many were built
+static size_t buildBatch(const EngineCore::TransformSoA& in, size_t count, EngineCore::PerObjectUboData* out, const uint32_t* outputIndices)
+{
+    const Ops::V zero = Ops::set1(0.0f);
+    const Ops::V one = Ops::set1(1.0f);
+
+    size_t i = 0;
+    for(; i + Ops::LANES <= count; i += Ops::LANES)
+    {
+        Ops::V s1, c1, s2, c2, s3, c3;
+        sinCos(Ops::load(in.rotationY + i), s1, c1);
+        sinCos(Ops::load(in.rotationX + i), s2, c2);
+        sinCos(Ops::load(in.rotationZ + i), s3, c3);
+
+        // rotation part of Translate * Ry * Rx * Rz, see TransformComponent::mat4()
+        const Ops::V s1s2 = Ops::mul(s1, s2);
+        const Ops::V c1s2 = Ops::mul(c1, s2);
+        const Ops::V r00 = Ops::add(Ops::mul(c1, c3), Ops::mul(s1s2, s3));
+        const Ops::V r01 = Ops::mul(c2, s3);
+        const Ops::V r02 = Ops::sub(Ops::mul(c1s2, s3), Ops::mul(c3, s1));
+        const Ops::V r10 = Ops::sub(Ops::mul(s1s2, c3), Ops::mul(c1, s3));
+        const Ops::V r11 = Ops::mul(c2, c3);
+        const Ops::V r12 = Ops::add(Ops::mul(c1s2, c3), Ops::mul(s1, s3));
+        const Ops::V r20 = Ops::mul(c2, s1);
+        const Ops::V r21 = Ops::sub(zero, s2);
+        const Ops::V r22 = Ops::mul(c1, c2);
+
+        const Ops::V scaleX = Ops::load(in.scaleX + i);
+        const Ops::V scaleY = Ops::load(in.scaleY + i);
+        const Ops::V scaleZ = Ops::load(in.scaleZ + i);
+        const Ops::V invScaleX = Ops::div(one, scaleX);
+        const Ops::V invScaleY = Ops::div(one, scaleY);
+        const Ops::V invScaleZ = Ops::div(one, scaleZ);
+
+        float* model[Ops::LANES];
+        float* normal[Ops::LANES];
+        for(size_t lane = 0; lane < Ops::LANES; lane++)
+        {
+            EngineCore::PerObjectUboData& data = out[outputIndices != nullptr ? outputIndices[i + lane] : i + lane];
+            model[lane] = &data.modelMatrix[0][0];
+            normal[lane] = &data.normalMatrix[0][0];
+        }
+
+        // column major, storeColumns transposes the lanes into one vec4 column per transform
+        Ops::storeColumns(Ops::mul(scaleX, r00), Ops::mul(scaleX, r01), Ops::mul(scaleX, r02), zero, model, 0);
+        Ops::storeColumns(Ops::mul(scaleY, r10), Ops::mul(scaleY, r11), Ops::mul(scaleY, r12), zero, model, 4);
+        Ops::storeColumns(Ops::mul(scaleZ, r20), Ops::mul(scaleZ, r21), Ops::mul(scaleZ, r22), zero, model, 8);
+        Ops::storeColumns(Ops::load(in.translationX + i), Ops::load(in.translationY + i), Ops::load(in.translationZ + i), one, model, 12);
+
+        Ops::storeColumns(Ops::mul(invScaleX, r00), Ops::mul(invScaleX, r01), Ops::mul(invScaleX, r02), zero, normal, 0);
+        Ops::storeColumns(Ops::mul(invScaleY, r10), Ops::mul(invScaleY, r11), Ops::mul(invScaleY, r12), zero, normal, 4);
+        Ops::storeColumns(Ops::mul(invScaleZ, r20), Ops::mul(invScaleZ, r21), Ops::mul(invScaleZ, r22), zero, normal, 8);
+        Ops::storeColumns(zero, zero, zero, one, normal, 12);
+    }
+    Ops::finish();
+    return i;
+}
@@ -1,5 +1,7 @@
 #include "point_light_system.hpp"
 
+#include "Platform/cpu_profiler.hpp"
+
 //libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -7,8 +9,9 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
-#include <map>
 
 namespace EngineSystem
 {
@@ -20,7 +23,8 @@ namespace EngineSystem
         descriptorBuilderPerFrame(descriptorLayoutCache, descriptorAllocator),
         shaderEffect(device.device(), descriptorLayoutCache, 
         "./build/ShaderBin/point_light.vert.spv", 
-        "./build/ShaderBin/point_light.frag.spv")
+        "./build/ShaderBin/point_light.frag.spv",
+        {{"lightSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC}})
     {
         createPipeline(renderPass);
     }
@@ -49,76 +53,127 @@ namespace EngineSystem
         );
     }
 
-    void PointLightSystem::update(EngineCore::FrameInfo& frameInfo, EngineCore::GlobalUbo& ubo)
+    void PointLightSystem::update(EngineCore::FrameInfo& frameInfo)
     {
         auto rotateLight = glm::rotate(
                 glm::mat4(1.0f),
                 frameInfo.frameTime,
                 {0.0f, -1.0f, 0.0f}
         );
-        int lightIndex = 0;
-        for(auto& kv : frameInfo.gameObjects)
+        auto& lights = frameInfo.registry.getPool<EngineCore::PointLightComponent>();
+        auto& transforms = frameInfo.registry.getPool<EngineCore::TransformComponent>();
+        for(size_t i = 0; i < lights.size(); i++)
         {
-            auto& obj = kv.second;
-            if(obj.pointLight == nullptr) continue;
-
-            assert(lightIndex < MAX_LIGHTS && "point light number limits!");
-            
             // update light position
-            obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.0f));
+            auto& transform = transforms.get(lights.entityAt(i).index);
+            transform.setTranslation(glm::vec3(rotateLight * glm::vec4(transform.getTranslation(), 1.0f)));
+        }
+    }
+
+    void PointLightSystem::writeLightClusters(EngineCore::FrameInfo& frameInfo, EngineCore::GlobalUbo& ubo)
+    {
+        CPU_ZONE("PointLightSystem::writeLightClusters");
+
+        auto& lights = frameInfo.registry.getPool<EngineCore::PointLightComponent>();
+        auto& transforms = frameInfo.registry.getPool<EngineCore::TransformComponent>();
+        const uint32_t lightCount = static_cast<uint32_t>(lights.size());
+
+        // the lights go to the gpu in pool order, the clusters index them
+        uint32_t& lightsOffset = frameInfo.lightClusterOffsets[EngineCore::CLUSTER_LIGHTS];
+        auto* gpuLights = static_cast<EngineCore::PointLight*>(
+            frameInfo.frameRing.allocate(std::max(lightCount, 1u) * sizeof(EngineCore::PointLight), lightsOffset));
+        clusterPositions.resize(lightCount);
+        clusterRanges.resize(lightCount);
+        for(uint32_t i = 0; i < lightCount; i++)
+        {
+            const auto& light = lights.at(i);
+            const auto& transform = transforms.get(lights.entityAt(i).index);
 
-            // copy light to ubo
-            ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.0f);
-            ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
+            // radiance falls off with 1 / d^2, beyond the range it is below LIGHT_RADIANCE_CUTOFF
+            const float peak = light.lightIntensity * std::max(light.color.r, std::max(light.color.g, light.color.b));
+            clusterPositions[i] = transform.getWorldPosition();
+            clusterRanges[i] = std::sqrt(std::max(peak, 0.0f) / LIGHT_RADIANCE_CUTOFF);
 
-            lightIndex++;
+            gpuLights[i].position = glm::vec4(clusterPositions[i], clusterRanges[i]);
+            gpuLights[i].color = glm::vec4(light.color, light.lightIntensity);
         }
-        ubo.numLights = lightIndex;
+
+        const EngineCore::Camera& camera = frameInfo.camera;
+        lightClusters.build(
+            camera.getView(), camera.getProjection(), camera.getNear(), camera.getFar(),
+            clusterPositions.data(), clusterRanges.data(), lightCount);
+
+        const auto& clusters = lightClusters.getClusters();
+        const auto& lightIndices = lightClusters.getLightIndices();
+        frameInfo.lightClusterOffsets[EngineCore::CLUSTER_RANGES] = frameInfo.frameRing.push(
+            clusters.data(), clusters.size() * sizeof(EngineCore::ClusterRange));
+        // a storage buffer window is never empty
+        uint32_t& indicesOffset = frameInfo.lightClusterOffsets[EngineCore::CLUSTER_LIGHT_INDICES];
+        void* indices = frameInfo.frameRing.allocate(std::max<size_t>(lightIndices.size(), 1) * sizeof(uint32_t), indicesOffset);
+        std::copy(lightIndices.begin(), lightIndices.end(), static_cast<uint32_t*>(indices));
+
+        ubo.clusterGrid = glm::uvec4(
+            EngineCore::LightClusterGrid::GRID_X,
+            EngineCore::LightClusterGrid::GRID_Y,
+            EngineCore::LightClusterGrid::GRID_Z,
+            lightCount);
+        ubo.clusterDepth = lightClusters.getDepthParams();
+        clusteredIndexCount = static_cast<uint32_t>(lightIndices.size());
     }
 
 
     void PointLightSystem::render(EngineCore::FrameInfo& frameInfo)
     {
-        // sort lights
-        std::map<float, EngineCore::GameObject::id_t> sorted;
-        for(auto& kv : frameInfo.gameObjects)
+        auto& lights = frameInfo.registry.getPool<EngineCore::PointLightComponent>();
+        auto& transforms = frameInfo.registry.getPool<EngineCore::TransformComponent>();
+
+        // sort lights back to front, items index the light pool densely
+        depthSorter.clear();
+        for(size_t i = 0; i < lights.size(); i++)
         {
-            auto& obj = kv.second;
-            if(obj.pointLight == nullptr) continue;
+            const auto& transform = transforms.get(lights.entityAt(i).index);
 
             // calculate distance
-            auto offset = frameInfo.camera.getPosition() - obj.transform.translation;
+            auto offset = frameInfo.camera.getPosition() - transform.getWorldPosition();
             float disSquared = glm::dot(offset, offset);
-            sorted[disSquared] = obj.getId();
+            depthSorter.push(disSquared, static_cast<uint32_t>(i));
+        }
+        depthSorter.sort(EngineCore::RadixSorter::Order::Descending);
+
+        const uint32_t lightCount = static_cast<uint32_t>(depthSorter.size());
+        if(lightCount == 0)
+        {
+            return;
+        }
+
+        // one instance per light in sorted order, farthest first, lights at equal distance keep their pool order
+        uint32_t dynamicOffset = 0;
+        auto* instances = static_cast<EngineCore::PointLightPerObjectData*>(
+            frameInfo.frameRing.allocate(lightCount * sizeof(EngineCore::PointLightPerObjectData), dynamicOffset));
+        for(uint32_t i = 0; i < lightCount; i++)
+        {
+            const size_t light = depthSorter.getItems()[i].index;
+            const auto& transform = transforms.get(lights.entityAt(light).index);
+            instances[i] = EngineCore::makePointLightObjectData(transform, lights.at(light));
         }
 
         // render
         lvePipeline->bind(frameInfo.commandBuffer);
 
         bindDescriptorSetsPerFrame(frameInfo.commandBuffer);
+        vkCmdBindDescriptorSets(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            shaderEffect.getPipelineLayout(),
+            1,
+            1,
+            &descriptorSetPerObject,
+            1,
+            &dynamicOffset
+        );
 
-        // iterate through sorted lights in reverse order
-        for(auto it = sorted.rbegin(); it != sorted.rend(); it++)
-        {
-            // use game obj id to find light obj
-            auto& obj = frameInfo.gameObjects.at(it->second);
-
-            obj.updatePointLightObject();
-
-            auto descriptorSet = obj.getPointLightDescriptor();
-            vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                shaderEffect.getPipelineLayout(),
-                1,
-                1,
-                &descriptorSet,
-                0,
-                nullptr
-            );
-
-            vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-        }
+        // instances blend in instance order, so one draw keeps the back to front order
+        vkCmdDraw(frameInfo.commandBuffer, 6, lightCount, 0, 0);
     }
 
 
@@ -149,6 +204,21 @@ namespace EngineSystem
         descriptorBuilderPerFrame.build(descriptorSetsPerFrame);
     }
 
+    void PointLightSystem::createDescriptorSetPerObject(const std::string& name, VkDescriptorBufferInfo bufferInfo)
+    {
+        const auto setAndBinding = shaderEffect.getSetAndBinding(name);
+        assert(setAndBinding.setId == 1); // per object set can only be set1
+        assert(setAndBinding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC && "light instance data must be dynamic");
+
+        // reuse the reflected stage flags so the set layout matches the pipeline layout exactly
+        Vk::DescriptorBuilder builder(descriptorLayoutCache, descriptorAllocator);
+        builder.bind_buffer(
+            setAndBinding.bindingId,
+            &bufferInfo,
+            setAndBinding.type,
+            setAndBinding.stageFlags).build(descriptorSetPerObject);
+    }
+
     void PointLightSystem::bindDescriptorSetsPerFrame(VkCommandBuffer commandBuffer)
     {
         vkCmdBindDescriptorSets(
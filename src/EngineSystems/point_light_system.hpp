@@ -16,9 +16,12 @@ It is application's resbonsibility to check whether an object is compatible to a
 #include "Vk/lve_device.hpp"
 #include "Vk/vk_shader_effect.hpp"
 #include "EngineCore/frame_info.hpp"
+#include "EngineCore/radix_sort.hpp"
+#include "EngineCore/light_clusters.hpp"
 
 // std
 #include <memory>
+#include <vector>
 
 namespace EngineSystem
 {
@@ -32,14 +35,27 @@ namespace EngineSystem
         PointLightSystem(const PointLightSystem&) = delete;
         PointLightSystem& operator=(const PointLightSystem&) = delete;
 
-        void update(EngineCore::FrameInfo& frameInfo, EngineCore::GlobalUbo& ubo);
+        // animates the lights, runs before TransformSystem::update
+        void update(EngineCore::FrameInfo& frameInfo);
+        // bins every light into the camera's clusters (LightClusterGrid) after TransformSystem::update:
+        // lights, cluster ranges and light indices go to the frame ring (frameInfo.lightClusterOffsets),
+        // the grid parameters into the global ubo
+        void writeLightClusters(EngineCore::FrameInfo& frameInfo, EngineCore::GlobalUbo& ubo);
         void render(EngineCore::FrameInfo& frameInfo);
 
         void createDescriptorSetPerFrame(const std::string& name, VkDescriptorBufferInfo bufferInfo, VkShaderStageFlags stageFlags);
         void createDescriptorSetPerFrame(const std::string& name, VkDescriptorImageInfo imageInfo, VkShaderStageFlags stageFlags);
         void finishCreateDescriptorSetPerFrame();
 
+        // set1 is a dynamic storage buffer window over the frame ring holding every light instance of the frame
+        void createDescriptorSetPerObject(const std::string& name, VkDescriptorBufferInfo bufferInfo);
+
+        // (light, cluster) pairs of the last writeLightClusters, the lights shaded over all clusters
+        uint32_t getClusteredIndexCount() const { return clusteredIndexCount; }
+
     private:
+        static constexpr float LIGHT_RADIANCE_CUTOFF = 0.005f;     // contribution where a light's range ends
+
         void createPipeline(VkRenderPass renderPass);
 
         void bindDescriptorSetsPerFrame(VkCommandBuffer commandBuffer);
@@ -51,9 +67,17 @@ namespace EngineSystem
 
         Vk::DescriptorBuilder descriptorBuilderPerFrame;
         VkDescriptorSet descriptorSetsPerFrame;
+        VkDescriptorSet descriptorSetPerObject;
         
         Vk::ShaderEffect shaderEffect;
         std::unique_ptr<Vk::LvePipeline> lvePipeline;
+
+        EngineCore::RadixSorter depthSorter;    // reused every frame, keeps its capacity
+
+        EngineCore::LightClusterGrid lightClusters;
+        std::vector<glm::vec3> clusterPositions;    // scratch, [dense light index]
+        std::vector<float> clusterRanges;
+        uint32_t clusteredIndexCount = 0;
     };
 
 }
\ No newline at end of file
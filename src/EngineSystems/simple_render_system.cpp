@@ -1,5 +1,7 @@
 #include "simple_render_system.hpp"
 
+#include "Platform/cpu_profiler.hpp"
+
 //libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -7,71 +9,595 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
 #include <stdexcept>
+#include <utility>
 
 namespace EngineSystem
 {
+    namespace
+    {
+        // std140 layout of CullUbo in cull.comp
+        struct CullUbo
+        {
+            glm::vec4 frustumPlanes[EngineCore::Frustum::PLANE_COUNT];
+            uint32_t instanceCount;
+            uint32_t compactCommands;
+        };
+
+        constexpr uint32_t CULL_GROUP_SIZE = 64;   // local_size_x of cull.comp
+
+        const std::vector<Vk::ShaderEffect::ReflectionOverride> SHADER_OVERRIDES = {
+            {"instanceSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            {"objectSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            {"clusterLightSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            {"clusterSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            {"clusterLightIndexSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC}
+        };
 
-    SimpleRenderSystem::SimpleRenderSystem(Vk::LveDevice& device, Vk::DescriptorLayoutCache& descriptorLayoutCache, VkRenderPass renderPass, EngineCore::TextureManager& textureManager, Vk::DescriptorAllocator& descriptorAllocator):
+        // vertex shader per LveModel::VertexFormat
+        const char* const VERTEX_SHADER_PATHS[Vk::LveModel::VERTEX_FORMAT_COUNT] = {
+            "./build/ShaderBin/simple_shader.vert.spv",
+            "./build/ShaderBin/simple_shader_compact.vert.spv",
+            "./build/ShaderBin/simple_shader_compact_color.vert.spv"
+        };
+        const char* const FRAG_SHADER_PATH = "./build/ShaderBin/simple_shader.frag.spv";
+    }
+
+    SimpleRenderSystem::SimpleRenderSystem(Vk::LveDevice& device, Vk::DescriptorLayoutCache& descriptorLayoutCache, VkRenderPass renderPass, EngineCore::TextureManager& textureManager, Vk::DescriptorAllocator& descriptorAllocator, uint32_t maxObjects, bool allowGpuDriven):
         lveDevice{device},
         descriptorAllocator(descriptorAllocator),
         descriptorLayoutCache(descriptorLayoutCache),
         descriptorBuilderPerFrame(descriptorLayoutCache, descriptorAllocator),
         shaderEffect(device.device(), descriptorLayoutCache, 
-        "./build/ShaderBin/simple_shader.vert.spv", 
-        "./build/ShaderBin/simple_shader.frag.spv"),
-        textureManager(textureManager)
+        VERTEX_SHADER_PATHS[static_cast<uint32_t>(Vk::LveModel::VertexFormat::Full)], 
+        FRAG_SHADER_PATH,
+        SHADER_OVERRIDES),
+        textureManager(textureManager),
+        maxObjects(maxObjects)
     {
-        createPipeline(renderPass);
+        createPipelines(renderPass);
+        createObjectBuffer();
+
+        gpuDriven = allowGpuDriven && lveDevice.hasMultiDrawIndirect();
+        if(gpuDriven)
+        {
+            createGpuDrivenResources();
+        }
+        printf("SimpleRenderSystem: %s\n", gpuDriven == false ? "cpu culling" :
+            lveDevice.hasDrawIndirectCount() ? "gpu culling, indirect count draws" : "gpu culling, fixed count indirect draws");
     }
 
     SimpleRenderSystem::~SimpleRenderSystem()
     {
     }
 
-    void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
+    void SimpleRenderSystem::createPipelines(VkRenderPass renderPass)
     {
         assert(shaderEffect.getPipelineLayout() != nullptr && "Cannot create pipeline before pipeline layout");
 
-        Vk::PipelineConfigInfo pipelineConfig{};
-        Vk::LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = shaderEffect.getPipelineLayout();
-        lvePipeline = std::make_unique<Vk::LvePipeline>(
-            lveDevice, 
-            shaderEffect.getVertShaderModule(), 
-            shaderEffect.getFragShaderModule(), 
-            pipelineConfig
+        for(uint32_t f = 0; f < Vk::LveModel::VERTEX_FORMAT_COUNT; f++)
+        {
+            const auto format = static_cast<Vk::LveModel::VertexFormat>(f);
+            const Vk::ShaderEffect* effect = &shaderEffect;
+            if(format != Vk::LveModel::VertexFormat::Full)
+            {
+                // the variants declare the same sets, pipelines created with shaderEffect's layout accept them
+                variantShaderEffects[f] = std::make_unique<Vk::ShaderEffect>(
+                    lveDevice.device(), descriptorLayoutCache, VERTEX_SHADER_PATHS[f], FRAG_SHADER_PATH, SHADER_OVERRIDES);
+                effect = variantShaderEffects[f].get();
+            }
+
+            Vk::PipelineConfigInfo pipelineConfig{};
+            Vk::LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+            pipelineConfig.bindingDescriptions = Vk::LveModel::getBindingDescriptions(format);
+            pipelineConfig.attributeDescriptions = Vk::LveModel::getAttributeDescriptions(format);
+            pipelineConfig.renderPass = renderPass;
+            pipelineConfig.pipelineLayout = shaderEffect.getPipelineLayout();
+            lvePipelines[f] = std::make_unique<Vk::LvePipeline>(
+                lveDevice, 
+                effect->getVertShaderModule(), 
+                effect->getFragShaderModule(), 
+                pipelineConfig
+            );
+        }
+    }
+
+    void SimpleRenderSystem::bindPipeline(VkCommandBuffer commandBuffer, Vk::LveModel::VertexFormat format, uint32_t& boundFormat)
+    {
+        // the layouts are compatible, bound descriptor sets and vertex buffers stay valid across the switch
+        const uint32_t f = static_cast<uint32_t>(format);
+        if(f != boundFormat)
+        {
+            lvePipelines[f]->bind(commandBuffer);
+            boundFormat = f;
+        }
+    }
+
+    void SimpleRenderSystem::createObjectBuffer()
+    {
+        // one region per frame in flight, each selected through the dynamic offset of objectSsbo
+        const VkDeviceSize alignment = lveDevice.properties.limits.minStorageBufferOffsetAlignment;
+        objectRegionSize = (maxObjects * sizeof(EngineCore::PerObjectUboData) + alignment - 1) / alignment * alignment;
+        objectBuffer = std::make_unique<Vk::LveBuffer>(
+            lveDevice,
+            objectRegionSize,
+            Vk::LveSwapChain::MAX_FRAMES_IN_FLIGHT,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
         );
+        objectBuffer->map();
+
+        for(auto& versions : uploadedVersions)
+        {
+            versions.assign(maxObjects, 0);
+        }
     }
 
-    void SimpleRenderSystem::renderGameObjects(EngineCore::FrameInfo& frameInfo)
+    void SimpleRenderSystem::uploadChangedObjects(int frameIndex)
+    {
+        CPU_ZONE("SimpleRenderSystem::uploadChangedObjects");
+
+        // the region was last read by the frame that used this slot, its fence already signaled
+        auto* objects = reinterpret_cast<EngineCore::PerObjectUboData*>(
+            static_cast<char*>(objectBuffer->getMappedMemory()) + frameIndex * objectRegionSize);
+        auto& versions = uploadedVersions[frameIndex];
+
+        uploadedCount = 0;
+        for(size_t i = 0; i < cullCandidates.size(); i++)
+        {
+            if(cullVisible[i] == 0) continue;
+
+            const CullCandidate& candidate = cullCandidates[i];
+            if(uploadObject(objects, versions, candidate.objectIndex, *candidate.transform))
+            {
+                uploadedCount++;
+            }
+        }
+    }
+
+    bool SimpleRenderSystem::uploadObject(EngineCore::PerObjectUboData* objects, std::vector<uint64_t>& versions, uint32_t objectIndex, const EngineCore::TransformComponent& transform)
+    {
+        assert(transform.getVersion() != 0 && "TransformSystem::update has to run before rendering");
+        if(versions[objectIndex] == transform.getVersion())
+        {
+            return false;
+        }
+
+        objects[objectIndex] = EngineCore::makeSimpleObjectData(transform);
+        versions[objectIndex] = transform.getVersion();
+        return true;
+    }
+
+    void SimpleRenderSystem::createGpuDrivenResources()
+    {
+        const std::vector<Vk::ShaderEffect::ReflectionOverride> cullOverrides{
+            {"cullUbo", VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC},
+            {"batchSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            {"instanceObjectSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            {"instanceBatchSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC},
+            {"objectSsbo", VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC}
+        };
+        cullShaderEffect = std::make_unique<Vk::ShaderEffect>(
+            lveDevice.device(),
+            descriptorLayoutCache,
+            "./build/ShaderBin/cull.comp.spv",
+            cullOverrides);
+        cullPipeline = std::make_unique<Vk::LveComputePipeline>(
+            lveDevice,
+            cullShaderEffect->getCompShaderModule(),
+            cullShaderEffect->getPipelineLayout());
+
+        // one region per frame in flight, every section starts aligned so it can be bound on its own
+        const VkDeviceSize alignment = lveDevice.properties.limits.minStorageBufferOffsetAlignment;
+        auto alignUp = [alignment](VkDeviceSize size) { return (size + alignment - 1) / alignment * alignment; };
+        maxDrawInstances = maxObjects * MAX_DRAW_INSTANCES_PER_OBJECT;
+        tableObjectsOffset = alignUp(MAX_DRAW_BATCHES * sizeof(EngineCore::DrawBatch));
+        tableInstanceBatchesOffset = tableObjectsOffset + alignUp(maxDrawInstances * sizeof(uint32_t));
+        tableRegionSize = tableInstanceBatchesOffset + alignUp(maxDrawInstances * sizeof(uint32_t));
+        tableBuffer = std::make_unique<Vk::LveBuffer>(
+            lveDevice,
+            tableRegionSize,
+            Vk::LveSwapChain::MAX_FRAMES_IN_FLIGHT,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        tableBuffer->map();
+
+        // gpu written, one command slot per draw table instance
+        indirectCommandBuffer = std::make_unique<Vk::LveBuffer>(
+            lveDevice,
+            sizeof(VkDrawIndexedIndirectCommand),
+            maxDrawInstances,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+        // cull.comp always declares the counts, they are only cleared and read with draw indirect count
+        drawCountBuffer = std::make_unique<Vk::LveBuffer>(
+            lveDevice,
+            sizeof(uint32_t),
+            MAX_DRAW_BATCHES,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+    }
+
+    void SimpleRenderSystem::uploadDrawTable(int frameIndex)
+    {
+        // the region was last read by the frame that used this slot, its fence already signaled
+        if(uploadedTableVersions[frameIndex] == drawTable.getVersion())
+        {
+            return;
+        }
+
+        char* region = static_cast<char*>(tableBuffer->getMappedMemory()) + frameIndex * tableRegionSize;
+        const auto& batches = drawTable.getBatches();
+        const auto& instanceObjects = drawTable.getInstanceObjects();
+        const auto& instanceBatches = drawTable.getInstanceBatches();
+        std::copy(batches.begin(), batches.end(), reinterpret_cast<EngineCore::DrawBatch*>(region));
+        std::copy(instanceObjects.begin(), instanceObjects.end(), reinterpret_cast<uint32_t*>(region + tableObjectsOffset));
+        std::copy(instanceBatches.begin(), instanceBatches.end(), reinterpret_cast<uint32_t*>(region + tableInstanceBatchesOffset));
+        uploadedTableVersions[frameIndex] = drawTable.getVersion();
+    }
+
+    void SimpleRenderSystem::recordGpuCulling(EngineCore::FrameInfo& frameInfo)
+    {
+        if(gpuDriven == false)
+        {
+            return;
+        }
+        CPU_ZONE("SimpleRenderSystem::recordGpuCulling");
+        culledFrameIndex = frameInfo.frameIndex;
+
+        if(drawTable.update(frameInfo.registry, maxObjects))
+        {
+            if(drawTable.getBatches().size() > MAX_DRAW_BATCHES)
+            {
+                throw std::runtime_error("draw table overflow, raise MAX_DRAW_BATCHES!");
+            }
+            if(drawTable.getInstanceCount() > maxDrawInstances)
+            {
+                throw std::runtime_error("draw table overflow, raise MAX_DRAW_INSTANCES_PER_OBJECT!");
+            }
+            for(const auto& source : drawTable.getBatchSources())
+            {
+                if(source.instanceCount > lveDevice.properties.limits.maxDrawIndirectCount)
+                {
+                    throw std::runtime_error("draw table batch exceeds maxDrawIndirectCount!");
+                }
+            }
+        }
+        uploadDrawTable(frameInfo.frameIndex);
+
+        // every drawn object, visibility is only known on the gpu
+        auto* objects = reinterpret_cast<EngineCore::PerObjectUboData*>(
+            static_cast<char*>(objectBuffer->getMappedMemory()) + frameInfo.frameIndex * objectRegionSize);
+        auto& versions = uploadedVersions[frameInfo.frameIndex];
+        auto& transforms = frameInfo.registry.getPool<EngineCore::TransformComponent>();
+        uploadedCount = 0;
+        for(uint32_t objectIndex : drawTable.getObjects())
+        {
+            if(uploadObject(objects, versions, objectIndex, transforms.get(objectIndex)))
+            {
+                uploadedCount++;
+            }
+        }
+
+        for(EngineCore::Model* model : drawTable.getModels())
+        {
+            model->updateMaterialDescriptors(textureManager, descriptorAllocator, descriptorLayoutCache);
+        }
+
+        const uint32_t instanceCount = drawTable.getInstanceCount();
+        if(instanceCount == 0)
+        {
+            return;
+        }
+
+        const EngineCore::Frustum frustum = EngineCore::Frustum::fromViewProjection(
+            frameInfo.camera.getProjection() * frameInfo.camera.getView());
+        CullUbo cullUbo{};
+        for(int i = 0; i < EngineCore::Frustum::PLANE_COUNT; i++)
+        {
+            cullUbo.frustumPlanes[i] = frustum.getPlane(static_cast<EngineCore::Frustum::Plane>(i));
+        }
+        cullUbo.instanceCount = instanceCount;
+        cullUbo.compactCommands = lveDevice.hasDrawIndirectCount() ? 1 : 0;
+        const uint32_t cullUboOffset = frameInfo.frameRing.push(cullUbo);
+
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+        // the previous frame's indirect draws are done with the commands / counts before they are rewritten
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        if(lveDevice.hasDrawIndirectCount())
+        {
+            vkCmdFillBuffer(commandBuffer, drawCountBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        cullPipeline->bind(commandBuffer);
+        // binding order: cullUbo, batchSsbo, instanceObjectSsbo, instanceBatchSsbo, objectSsbo
+        const uint32_t tableOffset = static_cast<uint32_t>(frameInfo.frameIndex * tableRegionSize);
+        const uint32_t dynamicOffsets[] = {
+            cullUboOffset,
+            tableOffset,
+            tableOffset,
+            tableOffset,
+            static_cast<uint32_t>(frameInfo.frameIndex * objectRegionSize)};
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            cullShaderEffect->getPipelineLayout(),
+            0,
+            1,
+            &cullDescriptorSet,
+            static_cast<uint32_t>(std::size(dynamicOffsets)),
+            dynamicOffsets
+        );
+        vkCmdDispatch(commandBuffer, (instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    void SimpleRenderSystem::recordIndirectDraws(VkCommandBuffer commandBuffer)
+    {
+        // the pipelines are bound per vertex format below, their layouts all match shaderEffect's
+        bindDescriptorSetsPerFrame(commandBuffer);
+
+        // binding order: instanceSsbo (the draw table's instance objects), objectSsbo
+        const uint32_t dynamicOffsets[] = {
+            static_cast<uint32_t>(culledFrameIndex * tableRegionSize),
+            static_cast<uint32_t>(culledFrameIndex * objectRegionSize)};
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            shaderEffect.getPipelineLayout(),
+            1,
+            1,
+            &descriptorSetPerDrawTable,
+            2,
+            dynamicOffsets
+        );
+
+        // one draw per batch since materials differ between submeshes, the geometry buffers are bound once per pool block
+        // and the pipeline once per run of batches with the same vertex format
+        Vk::LveModel::BoundGeometry boundGeometry{};
+        uint32_t boundVertexFormat = Vk::LveModel::VERTEX_FORMAT_COUNT;
+        constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        const auto& batches = drawTable.getBatches();
+        const auto& sources = drawTable.getBatchSources();
+        for(size_t b = 0; b < batches.size(); b++)
+        {
+            const auto& source = sources[b];
+            bindPipeline(commandBuffer, source.model->getSubmesh(source.submesh).getVertexFormat(), boundVertexFormat);
+            source.model->bindSubmesh(commandBuffer, shaderEffect.getPipelineLayout(), source.submesh, boundGeometry);
+
+            const VkDeviceSize commandOffset = batches[b].commandOffset * static_cast<VkDeviceSize>(stride);
+            if(lveDevice.hasDrawIndirectCount())
+            {
+                lveDevice.cmdDrawIndexedIndirectCount(
+                    commandBuffer,
+                    indirectCommandBuffer->getBuffer(),
+                    commandOffset,
+                    drawCountBuffer->getBuffer(),
+                    b * sizeof(uint32_t),
+                    source.instanceCount,
+                    stride);
+            }
+            else
+            {
+                vkCmdDrawIndexedIndirect(commandBuffer, indirectCommandBuffer->getBuffer(), commandOffset, source.instanceCount, stride);
+            }
+        }
+    }
+
+    void SimpleRenderSystem::cullGameObjects(EngineCore::FrameInfo& frameInfo)
     {
-        lvePipeline->bind(frameInfo.commandBuffer);
+        CPU_ZONE("SimpleRenderSystem::cullGameObjects");
+
+        cullCandidates.clear();
+        cullBoxes.clear();
+        // walks the packed model components, the transform is a sparse set lookup
+        auto& models = frameInfo.registry.getPool<EngineCore::ModelComponent>();
+        auto& transforms = frameInfo.registry.getPool<EngineCore::TransformComponent>();
+        for(size_t i = 0; i < models.size(); i++)
+        {
+            EngineCore::Model* model = models.at(i).model.get();
+            const uint32_t objectIndex = models.entityAt(i).index;
+            const EngineCore::TransformComponent* transform = transforms.tryGet(objectIndex);
+            if(model == nullptr || model->empty() || transform == nullptr) continue;
+
+            // the object's slot in the persistent buffer is its entity index
+            if(objectIndex >= maxObjects)
+            {
+                throw std::runtime_error("object buffer overflow, raise maxObjects!");
+            }
+
+            const auto& box = model->getBoundingBox();
+            cullCandidates.push_back({model, transform, objectIndex});
+            cullBoxes.pushTransformed(box.min, box.max, transform->getWorldMatrix());
+        }
+
+        const EngineCore::Frustum frustum = EngineCore::Frustum::fromViewProjection(
+            frameInfo.camera.getProjection() * frameInfo.camera.getView());
+        cullVisible.resize(cullCandidates.size());
+        cullingStats.visible = frustum.cullBoxes(cullBoxes, cullVisible.data());
+        cullingStats.culled = static_cast<uint32_t>(cullCandidates.size()) - cullingStats.visible;
 
-        bindDescriptorSetsPerFrame(frameInfo.commandBuffer);
+        uploadChangedObjects(frameInfo.frameIndex);
+
+        // group by model, materials belong to the model's submeshes so every group shares them as well
+        for(auto& kv : instanceGroups)
+        {
+            kv.second.clear();
+        }
+        for(size_t i = 0; i < cullCandidates.size(); i++)
+        {
+            if(cullVisible[i] == 0) continue;
+
+            instanceGroups[cullCandidates[i].model].push_back(cullCandidates[i].objectIndex);
+        }
+    }
+
+    void SimpleRenderSystem::prepareDrawChunks(EngineCore::FrameInfo& frameInfo, uint32_t maxInstancesPerChunk)
+    {
+        // descriptor sets are rebuilt here on the calling thread, recording threads only read them
+        for(auto& kv : instanceGroups)
+        {
+            if(kv.second.empty()) continue;
+            kv.first->updateMaterialDescriptors(textureManager, descriptorAllocator, descriptorLayoutCache);
+        }
 
-        for(auto& kv : frameInfo.gameObjects)
+        // ring allocation happens here on the calling thread, chunks only write into their own part of it
+        drawChunks.clear();
+        for(auto& kv : instanceGroups)
         {
-            auto& obj = kv.second;
-            if(obj.model == nullptr) continue;
+            auto& instances = kv.second;
+            if(instances.empty()) continue;
+
+            // one contiguous run of object indices in this frame's ring region, indexed by gl_InstanceIndex
+            const uint32_t instanceCount = static_cast<uint32_t>(instances.size());
+            uint32_t dynamicOffset = 0;
+            auto* instanceData = static_cast<uint32_t*>(
+                frameInfo.frameRing.allocate(instanceCount * sizeof(uint32_t), dynamicOffset));
+
+            for(uint32_t first = 0; first < instanceCount; first += maxInstancesPerChunk)
+            {
+                drawChunks.push_back(DrawChunk{
+                    kv.first,
+                    instances.data(),
+                    instanceData,
+                    dynamicOffset,
+                    static_cast<uint32_t>(frameInfo.frameIndex * objectRegionSize),
+                    first,
+                    std::min(maxInstancesPerChunk, instanceCount - first)
+                });
+            }
+        }
+    }
 
-            obj.updateSimpleObject();
+    void SimpleRenderSystem::recordDrawChunks(VkCommandBuffer commandBuffer, size_t beginChunk, size_t endChunk)
+    {
+        // the pipelines are bound per vertex format below, their layouts all match shaderEffect's
+        bindDescriptorSetsPerFrame(commandBuffer);
+
+        Vk::LveModel::BoundGeometry boundGeometry{};
+        uint32_t boundVertexFormat = Vk::LveModel::VERTEX_FORMAT_COUNT;
+        for(size_t c = beginChunk; c < endChunk; c++)
+        {
+            const DrawChunk& chunk = drawChunks[c];
+            std::copy(
+                chunk.instances + chunk.firstInstance,
+                chunk.instances + chunk.firstInstance + chunk.instanceCount,
+                chunk.instanceData + chunk.firstInstance);
 
-            auto descriptorSet = obj.getSimpleDescriptor();
+            // binding order: instanceSsbo, objectSsbo
+            const uint32_t dynamicOffsets[] = {chunk.dynamicOffset, chunk.objectOffset};
             vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
+                commandBuffer,
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                 shaderEffect.getPipelineLayout(),
                 1,
                 1,
-                &descriptorSet,
-                0,
-                nullptr
+                &descriptorSetPerObject,
+                2,
+                dynamicOffsets
             );
 
-            obj.model->bindAndDraw(frameInfo.commandBuffer, descriptorAllocator, descriptorLayoutCache, shaderEffect.getPipelineLayout(), textureManager);
+            for(uint32_t s = 0; s < chunk.model->getSubmeshCount(); s++)
+            {
+                const Vk::LveModel& submesh = chunk.model->getSubmesh(s);
+                bindPipeline(commandBuffer, submesh.getVertexFormat(), boundVertexFormat);
+                chunk.model->bindSubmesh(commandBuffer, shaderEffect.getPipelineLayout(), s, boundGeometry);
+                submesh.draw(commandBuffer, chunk.instanceCount, chunk.firstInstance);
+            }
+        }
+    }
+
+    void SimpleRenderSystem::renderGameObjects(EngineCore::FrameInfo& frameInfo)
+    {
+        std::copy(std::begin(frameInfo.lightClusterOffsets), std::end(frameInfo.lightClusterOffsets), lightClusterOffsets);
+        if(gpuDriven)
+        {
+            recordIndirectDraws(frameInfo.commandBuffer);
+            return;
+        }
+        cullGameObjects(frameInfo);
+        prepareDrawChunks(frameInfo, UINT32_MAX);
+        recordDrawChunks(frameInfo.commandBuffer, 0, drawChunks.size());
+    }
+
+    void SimpleRenderSystem::renderGameObjectsParallel(
+        EngineCore::FrameInfo& frameInfo, 
+        Vk::LveRenderer& renderer, 
+        EngineCore::JobSystem& jobSystem, 
+        std::vector<VkCommandBuffer>& secondaryCommandBuffers)
+    {
+        assert(jobSystem.getThreadCount() <= renderer.getRecordingThreadCount() && "renderer has fewer thread command pools than the job system has threads");
+
+        // a couple of tasks per thread so uneven chunks still balance, but not so small that binds dominate
+        constexpr uint32_t TASKS_PER_THREAD = 2;
+        constexpr uint32_t MIN_INSTANCES_PER_CHUNK = 64;
+        const uint32_t maxTasks = jobSystem.getThreadCount() * TASKS_PER_THREAD;
+
+        std::copy(std::begin(frameInfo.lightClusterOffsets), std::end(frameInfo.lightClusterOffsets), lightClusterOffsets);
+        if(gpuDriven)
+        {
+            // a handful of draws, not worth spreading over threads
+            VkCommandBuffer commandBuffer = renderer.beginSecondaryCommandBuffer(0);
+            recordIndirectDraws(commandBuffer);
+            renderer.endSecondaryCommandBuffer(commandBuffer);
+            secondaryCommandBuffers.push_back(commandBuffer);
+            return;
         }
+
+        cullGameObjects(frameInfo);
+        const size_t objectCount = cullingStats.visible;
+        const uint32_t maxInstancesPerChunk = std::max(MIN_INSTANCES_PER_CHUNK, static_cast<uint32_t>((objectCount + maxTasks - 1) / maxTasks));
+        prepareDrawChunks(frameInfo, maxInstancesPerChunk);
+
+        const uint32_t taskCount = static_cast<uint32_t>(std::min<size_t>(drawChunks.size(), maxTasks));
+        const size_t firstOutput = secondaryCommandBuffers.size();
+        secondaryCommandBuffers.resize(firstOutput + taskCount);
+
+        jobSystem.parallelFor(taskCount, [&](uint32_t taskIndex, uint32_t threadIndex)
+        {
+            const size_t beginChunk = drawChunks.size() * taskIndex / taskCount;
+            const size_t endChunk = drawChunks.size() * (taskIndex + 1) / taskCount;
+
+            CPU_ZONE("SimpleRenderSystem::recordDrawChunks");
+            VkCommandBuffer commandBuffer = renderer.beginSecondaryCommandBuffer(threadIndex);
+            recordDrawChunks(commandBuffer, beginChunk, endChunk);
+            renderer.endSecondaryCommandBuffer(commandBuffer);
+
+            secondaryCommandBuffers[firstOutput + taskIndex] = commandBuffer;
+        });
     }
 
     void SimpleRenderSystem::createDescriptorSetPerFrame(const std::string& name, VkDescriptorBufferInfo bufferInfo, VkShaderStageFlags stageFlags)
@@ -101,8 +627,79 @@ namespace EngineSystem
         descriptorBuilderPerFrame.build(descriptorSetsPerFrame);
     }
 
+    void SimpleRenderSystem::createDescriptorSetPerObject(const std::string& name, VkDescriptorBufferInfo bufferInfo)
+    {
+        const auto instanceBinding = shaderEffect.getSetAndBinding(name);
+        const auto objectBinding = shaderEffect.getSetAndBinding("objectSsbo");
+        assert(instanceBinding.setId == 1 && objectBinding.setId == 1); // per object set can only be set1
+        assert(instanceBinding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC && "per object instance data must be dynamic");
+        assert(objectBinding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC && "object data must be dynamic");
+        assert(instanceBinding.bindingId < objectBinding.bindingId && "dynamic offsets are passed in binding order");
+
+        // a window of one region, the dynamic offset picks the frame's region
+        VkDescriptorBufferInfo objectBufferInfo = objectBuffer->descriptorInfo(objectRegionSize, 0);
+
+        // reuse the reflected stage flags so the set layout matches the pipeline layout exactly
+        Vk::DescriptorBuilder builder(descriptorLayoutCache, descriptorAllocator);
+        builder.bind_buffer(
+            instanceBinding.bindingId,
+            &bufferInfo,
+            instanceBinding.type,
+            instanceBinding.stageFlags)
+        .bind_buffer(
+            objectBinding.bindingId,
+            &objectBufferInfo,
+            objectBinding.type,
+            objectBinding.stageFlags).build(descriptorSetPerObject);
+
+        if(gpuDriven == false)
+        {
+            return;
+        }
+
+        // the indirect draws index the draw table's instance objects with gl_InstanceIndex instead of the ring
+        VkDescriptorBufferInfo tableObjectsInfo = tableBuffer->descriptorInfo(maxDrawInstances * sizeof(uint32_t), tableObjectsOffset);
+        Vk::DescriptorBuilder(descriptorLayoutCache, descriptorAllocator)
+        .bind_buffer(
+            instanceBinding.bindingId,
+            &tableObjectsInfo,
+            instanceBinding.type,
+            instanceBinding.stageFlags)
+        .bind_buffer(
+            objectBinding.bindingId,
+            &objectBufferInfo,
+            objectBinding.type,
+            objectBinding.stageFlags).build(descriptorSetPerDrawTable);
+
+        // cull.comp set0: its ubo is a small window over the same ring, the rest are this system's buffers
+        VkDescriptorBufferInfo cullUboInfo = bufferInfo;
+        cullUboInfo.range = sizeof(CullUbo);
+        VkDescriptorBufferInfo batchesInfo = tableBuffer->descriptorInfo(MAX_DRAW_BATCHES * sizeof(EngineCore::DrawBatch), 0);
+        VkDescriptorBufferInfo instanceBatchesInfo = tableBuffer->descriptorInfo(maxDrawInstances * sizeof(uint32_t), tableInstanceBatchesOffset);
+        VkDescriptorBufferInfo commandsInfo = indirectCommandBuffer->descriptorInfo();
+        VkDescriptorBufferInfo drawCountsInfo = drawCountBuffer->descriptorInfo();
+        const std::pair<const char*, VkDescriptorBufferInfo*> cullBindings[] = {
+            {"cullUbo", &cullUboInfo},
+            {"batchSsbo", &batchesInfo},
+            {"instanceObjectSsbo", &tableObjectsInfo},
+            {"instanceBatchSsbo", &instanceBatchesInfo},
+            {"objectSsbo", &objectBufferInfo},
+            {"commandSsbo", &commandsInfo},
+            {"drawCountSsbo", &drawCountsInfo}
+        };
+        Vk::DescriptorBuilder cullBuilder(descriptorLayoutCache, descriptorAllocator);
+        for(const auto& binding : cullBindings)
+        {
+            const auto setAndBinding = cullShaderEffect->getSetAndBinding(binding.first);
+            assert(setAndBinding.setId == 0 && "cull.comp only has set0");
+            cullBuilder.bind_buffer(setAndBinding.bindingId, binding.second, setAndBinding.type, setAndBinding.stageFlags);
+        }
+        cullBuilder.build(cullDescriptorSet);
+    }
+
     void SimpleRenderSystem::bindDescriptorSetsPerFrame(VkCommandBuffer commandBuffer)
     {
+        // set0: global ubo + the frame's clustered light lists (dynamic, in binding order)
         vkCmdBindDescriptorSets(
             commandBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -110,8 +707,8 @@ namespace EngineSystem
             0,
             1,
             &descriptorSetsPerFrame,
-            0,
-            nullptr
+            EngineCore::LIGHT_CLUSTER_BUFFER_COUNT,
+            lightClusterOffsets
         );
     }
 
@@ -13,13 +13,22 @@ It is application's resbonsibility to check whether an object is compatible to a
 #pragma once
 
 #include "Vk/lve_pipeline.hpp"
+#include "Vk/lve_compute_pipeline.hpp"
 #include "Vk/lve_device.hpp"
+#include "Vk/lve_renderer.hpp"
+#include "Vk/lve_buffer.hpp"
+#include "Vk/lve_swap_chain.hpp"
 #include "Vk/vk_shader_effect.hpp"
+#include "EngineCore/draw_table.hpp"
 #include "EngineCore/frame_info.hpp"
+#include "EngineCore/frustum.hpp"
 #include "EngineCore/texture_manager.hpp"
+#include "EngineCore/job_system.hpp"
 
 // std
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace EngineSystem
 {
@@ -27,24 +36,92 @@ namespace EngineSystem
     class SimpleRenderSystem
     {
     public:
-        SimpleRenderSystem(Vk::LveDevice& device, Vk::DescriptorLayoutCache& descriptorLayoutCache, VkRenderPass renderPass, EngineCore::TextureManager& textureManager, Vk::DescriptorAllocator& descriptorAllocator);
+        // draw table capacity of the gpu driven path
+        static constexpr uint32_t MAX_DRAW_BATCHES = 1024;
+        static constexpr uint32_t MAX_DRAW_INSTANCES_PER_OBJECT = 4;
+
+        // maxObjects: entity indices of drawn objects must stay below it, they address the persistent object buffer.
+        // allowGpuDriven: cull and build the draws on the gpu when the device supports multi draw indirect
+        SimpleRenderSystem(Vk::LveDevice& device, Vk::DescriptorLayoutCache& descriptorLayoutCache, VkRenderPass renderPass, EngineCore::TextureManager& textureManager, Vk::DescriptorAllocator& descriptorAllocator, uint32_t maxObjects, bool allowGpuDriven = true);
         ~SimpleRenderSystem();
 
         SimpleRenderSystem(const SimpleRenderSystem&) = delete;
         SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
+        // gpu driven path only (a no-op otherwise): updates the draw table and records the cull dispatch that writes
+        // this frame's indirect draws. Has to be recorded before the render pass begins and before renderGameObjects*
+        void recordGpuCulling(EngineCore::FrameInfo& frameInfo);
+
         void renderGameObjects(EngineCore::FrameInfo& frameInfo);
+        // splits the instanced draws into chunks recorded in parallel, one secondary cmd buffer per task.
+        // The render pass must have been begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+        void renderGameObjectsParallel(
+            EngineCore::FrameInfo& frameInfo, 
+            Vk::LveRenderer& renderer, 
+            EngineCore::JobSystem& jobSystem, 
+            std::vector<VkCommandBuffer>& secondaryCommandBuffers);
+
+        struct CullingStats
+        {
+            uint32_t visible = 0;
+            uint32_t culled = 0;
+        };
+        // objects of the last rendered frame, tested against the camera frustum before anything was recorded.
+        // Not known on the cpu when gpu driven, see getDrawTable() for what was submitted to the cull pass
+        const CullingStats& getCullingStats() const { return cullingStats; }
+        bool isGpuDriven() const { return gpuDriven; }
+        const EngineCore::DrawTable& getDrawTable() const { return drawTable; }
+        // visible objects of the last frame whose matrices had to be written, the rest were still current
+        uint32_t getUploadedCount() const { return uploadedCount; }
 
+        // set0: the ubo plus clusterLightSsbo, clusterSsbo, clusterLightIndexSsbo as dynamic windows over the
+        // frame ring, bound with the frame's FrameInfo::lightClusterOffsets
         void createDescriptorSetPerFrame(const std::string& name, VkDescriptorBufferInfo bufferInfo, VkShaderStageFlags stageFlags);
         void createDescriptorSetPerFrame(const std::string& name, VkDescriptorImageInfo imageInfo, VkShaderStageFlags stageFlags);
         void finishCreateDescriptorSetPerFrame();
 
+        // set1: name is a dynamic storage buffer over the frame ring holding each instanced draw's object indices
+        // (its own dynamic offset per draw), objectSsbo the persistent per object matrices owned by this system.
+        // The gpu driven path binds its draw table there instead and puts its cull parameters into the same ring
+        void createDescriptorSetPerObject(const std::string& name, VkDescriptorBufferInfo bufferInfo);
+
 
     private:
-        void createPipeline(VkRenderPass renderPass);
+        // one pipeline per vertex format, all on shaderEffect's pipeline layout
+        void createPipelines(VkRenderPass renderPass);
+        // binds the pipeline of format unless boundFormat already is it (updated, start with VERTEX_FORMAT_COUNT)
+        void bindPipeline(VkCommandBuffer commandBuffer, Vk::LveModel::VertexFormat format, uint32_t& boundFormat);
+        void createObjectBuffer();
+        // writes the matrices of visible objects whose transform changed since this frame slot last saw them
+        void uploadChangedObjects(int frameIndex);
+        // writes one object's matrices if its transform changed since this frame slot last saw it, returns true if it did
+        bool uploadObject(EngineCore::PerObjectUboData* objects, std::vector<uint64_t>& versions, uint32_t objectIndex, const EngineCore::TransformComponent& transform);
+
+        void createGpuDrivenResources();
+        // copies the draw table into the frame's region when that region holds an older version
+        void uploadDrawTable(int frameIndex);
+        // one indirect draw per draw table batch, reads what recordGpuCulling's dispatch wrote
+        void recordIndirectDraws(VkCommandBuffer commandBuffer);
 
         void bindDescriptorSetsPerFrame(VkCommandBuffer commandBuffer);
 
+        // part of one model's instances, drawn with firstInstance so chunks of a group share its dynamic offset
+        struct DrawChunk
+        {
+            EngineCore::Model* model;
+            const uint32_t* instances;  // the group's object indices
+            uint32_t* instanceData;     // the group's run in the frame ring
+            uint32_t dynamicOffset;
+            uint32_t objectOffset;      // this frame's region of the object buffer
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+        };
+        // fills instanceGroups with the objects whose world space box intersects the camera frustum
+        void cullGameObjects(EngineCore::FrameInfo& frameInfo);
+        // chunks the culled instanceGroups
+        void prepareDrawChunks(EngineCore::FrameInfo& frameInfo, uint32_t maxInstancesPerChunk);
+        void recordDrawChunks(VkCommandBuffer commandBuffer, size_t beginChunk, size_t endChunk);
+
         Vk::LveDevice& lveDevice;
         
         Vk::DescriptorAllocator& descriptorAllocator;
@@ -52,11 +129,60 @@ namespace EngineSystem
 
         Vk::DescriptorBuilder descriptorBuilderPerFrame;
         VkDescriptorSet descriptorSetsPerFrame;
+        VkDescriptorSet descriptorSetPerObject;
+        uint32_t lightClusterOffsets[EngineCore::LIGHT_CLUSTER_BUFFER_COUNT] = {};  // of the frame being recorded
         
-        Vk::ShaderEffect shaderEffect;
-        std::unique_ptr<Vk::LvePipeline> lvePipeline;
+        Vk::ShaderEffect shaderEffect;  // full vertices, its layout is the one everything binds with
+        // vertex shader variants of the compact formats, identically defined layouts (Full's slot stays empty)
+        std::unique_ptr<Vk::ShaderEffect> variantShaderEffects[Vk::LveModel::VERTEX_FORMAT_COUNT];
+        std::unique_ptr<Vk::LvePipeline> lvePipelines[Vk::LveModel::VERTEX_FORMAT_COUNT];
 
         EngineCore::TextureManager& textureManager;
+
+        // object indices of the entities sharing a model, rebuilt every frame (vectors keep their capacity)
+        std::unordered_map<EngineCore::Model*, std::vector<uint32_t>> instanceGroups;
+        std::vector<DrawChunk> drawChunks;
+
+        // culling scratch, kept across frames for the capacity
+        struct CullCandidate
+        {
+            EngineCore::Model* model;
+            const EngineCore::TransformComponent* transform;
+            uint32_t objectIndex;
+        };
+        std::vector<CullCandidate> cullCandidates;
+        EngineCore::BoxList cullBoxes;
+        std::vector<uint8_t> cullVisible;
+        CullingStats cullingStats;
+
+        // persistent per object data, one region per frame in flight, indexed by entity index
+        uint32_t maxObjects;
+        VkDeviceSize objectRegionSize = 0;
+        std::unique_ptr<Vk::LveBuffer> objectBuffer;
+        std::vector<uint64_t> uploadedVersions[Vk::LveSwapChain::MAX_FRAMES_IN_FLIGHT];  // transform version per slot and region
+        uint32_t uploadedCount = 0;
+
+        // gpu driven path: cull.comp culls every draw table instance and writes the indirect commands
+        bool gpuDriven = false;
+        int culledFrameIndex = 0;      // of the frame recordGpuCulling ran for
+        EngineCore::DrawTable drawTable;
+        std::unique_ptr<Vk::ShaderEffect> cullShaderEffect;
+        std::unique_ptr<Vk::LveComputePipeline> cullPipeline;
+        VkDescriptorSet cullDescriptorSet;
+        VkDescriptorSet descriptorSetPerDrawTable;  // set1 with instanceSsbo over the draw table's instance objects
+
+        // draw table copy per frame in flight: batches | instance objects | instance batches
+        uint32_t maxDrawInstances = 0;
+        VkDeviceSize tableObjectsOffset = 0;
+        VkDeviceSize tableInstanceBatchesOffset = 0;
+        VkDeviceSize tableRegionSize = 0;
+        std::unique_ptr<Vk::LveBuffer> tableBuffer;
+        uint64_t uploadedTableVersions[Vk::LveSwapChain::MAX_FRAMES_IN_FLIGHT] = {};
+
+        // written by the cull dispatch, read by the same frame's indirect draws. One copy is enough, frames on the
+        // queue are ordered by the barrier in front of the next dispatch
+        std::unique_ptr<Vk::LveBuffer> indirectCommandBuffer;
+        std::unique_ptr<Vk::LveBuffer> drawCountBuffer;    // per batch, only with VK_KHR_draw_indirect_count
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "transform_system.hpp"
+
+#include "Platform/cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace EngineSystem
+{
+    void TransformSystem::update(EngineCore::Registry& registry)
+    {
+        CPU_ZONE("TransformSystem::update");
+
+        if(orderedStructureVersion != registry.getStructureVersion())
+        {
+            rebuildOrder(registry);
+        }
+
+        auto& transforms = registry.getPool<EngineCore::TransformComponent>();
+        // versions handed out during this update are >= firstVersion, a parent rebuilt this frame forces its children
+        const uint64_t firstVersion = nextVersion;
+        updatedCount = 0;
+
+        updateRoots(transforms);
+
+        for(size_t i = rootCount; i < order.size(); i++)
+        {
+            const Node& node = order[i];
+            auto& transform = transforms.at(node.transform);
+            const EngineCore::TransformComponent& parent = transforms.at(node.parent);
+            if(transform.isDirty() == false && parent.getVersion() < firstVersion)
+            {
+                continue;
+            }
+
+            // the inverse transpose distributes over the product, so the normal matrices chain like the model matrices
+            transform.setWorld(
+                parent.getWorldMatrix() * transform.mat4(),
+                parent.getWorldNormalMatrix() * transform.normalMatrix(),
+                nextVersion++);
+            updatedCount++;
+        }
+    }
+
+    void TransformSystem::updateRoots(EngineCore::ComponentPool<EngineCore::TransformComponent>& transforms)
+    {
+        // roots lead the order, their world matrices are their local ones: gather the dirty ones as SoA
+        // and build them in one batch
+        batchTransforms.clear();
+        for(size_t i = 0; i < rootCount; i++)
+        {
+            if(transforms.at(order[i].transform).isDirty())
+            {
+                batchTransforms.push_back(order[i].transform);
+            }
+        }
+        if(batchTransforms.empty())
+        {
+            return;
+        }
+
+        const size_t count = batchTransforms.size();
+        if(batchSoA.size() < 9 * count)
+        {
+            batchSoA.resize(9 * count);
+            batchMatrices.resize(count);
+        }
+        for(size_t i = 0; i < count; i++)
+        {
+            const auto& transform = transforms.at(batchTransforms[i]);
+            for(int c = 0; c < 3; c++)
+            {
+                batchSoA[(0 + c) * count + i] = transform.getTranslation()[c];
+                batchSoA[(3 + c) * count + i] = transform.getRotation()[c];
+                batchSoA[(6 + c) * count + i] = transform.getScale()[c];
+            }
+        }
+        const EngineCore::TransformSoA input{
+            &batchSoA[0 * count], &batchSoA[1 * count], &batchSoA[2 * count],
+            &batchSoA[3 * count], &batchSoA[4 * count], &batchSoA[5 * count],
+            &batchSoA[6 * count], &batchSoA[7 * count], &batchSoA[8 * count]};
+        EngineCore::TransformKernel::build(input, count, batchMatrices.data());
+
+        for(size_t i = 0; i < count; i++)
+        {
+            transforms.at(batchTransforms[i]).setWorld(
+                batchMatrices[i].modelMatrix,
+                glm::mat3(batchMatrices[i].normalMatrix),
+                nextVersion++);
+        }
+        updatedCount += static_cast<uint32_t>(count);
+    }
+
+    void TransformSystem::rebuildOrder(EngineCore::Registry& registry)
+    {
+        auto& transforms = registry.getPool<EngineCore::TransformComponent>();
+        const uint32_t count = static_cast<uint32_t>(transforms.size());
+
+        order.resize(count);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            auto& transform = transforms.at(i);
+            uint32_t parent = NO_PARENT;
+            if(registry.has<EngineCore::TransformComponent>(transform.getParent()))
+            {
+                // dense index of the parent: its address relative to the packed array
+                parent = static_cast<uint32_t>(&registry.get<EngineCore::TransformComponent>(transform.getParent()) - transforms.data());
+            }
+            else if(transform.getParent() != EngineCore::Entity{})
+            {
+                // the parent was destroyed, the transform is a root from now on
+                transform.markDirty();
+            }
+            order[i] = {i, parent};
+        }
+
+        // depth of every transform, memoized walks up the parent chain
+        constexpr uint32_t UNKNOWN = UINT32_MAX;
+        depths.assign(count, UNKNOWN);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            uint32_t node = i;
+            uint32_t steps = 0;
+            while(depths[node] == UNKNOWN && order[node].parent != NO_PARENT)
+            {
+                node = order[node].parent;
+                if(++steps > count)
+                {
+                    throw std::runtime_error("transform hierarchy contains a cycle!");
+                }
+            }
+            uint32_t depth = depths[node] == UNKNOWN ? 0 : depths[node];
+            depths[node] = depth;
+
+            // second walk writes the depths along the chain, deepest first
+            const uint32_t chainLength = steps;
+            node = i;
+            for(uint32_t s = 0; s < chainLength; s++)
+            {
+                depths[node] = depth + chainLength - s;
+                node = order[node].parent;
+            }
+        }
+
+        // parents before children, siblings stay in pool order
+        std::stable_sort(order.begin(), order.end(), [this](const Node& a, const Node& b)
+        {
+            return depths[a.transform] < depths[b.transform];
+        });
+        rootCount = static_cast<size_t>(std::count_if(order.begin(), order.end(), [](const Node& node)
+        {
+            return node.parent == NO_PARENT;
+        }));
+
+        orderedStructureVersion = registry.getStructureVersion();
+    }
+}
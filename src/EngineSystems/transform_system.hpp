@@ -0,0 +1,60 @@
+/*************************************************
+Transform System Class:
+1. keeps the transforms in topological order (parents before children), rebuilt only when the
+   registry's structure changed
+2. rebuilds the world matrices of dirty transforms and of everything below them, the rest keeps
+   its cached matrices, so a static scene costs one flag check per transform
+3. every rebuilt transform gets a new version, consumers (gpu upload) compare versions to skip
+   unchanged objects
+4. dirty roots are built in one batch by TransformKernel (SIMD), children chain onto their parent
+
+Run once per frame after gameplay changed the transforms and before anything reads world matrices.
+*************************************************/
+#pragma once
+
+#include "EngineCore/registry.hpp"
+#include "EngineCore/transform_kernel.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace EngineSystem
+{
+    class TransformSystem
+    {
+    public:
+        TransformSystem() = default;
+        TransformSystem(const TransformSystem&) = delete;
+        TransformSystem& operator=(const TransformSystem&) = delete;
+
+        void update(EngineCore::Registry& registry);
+
+        // transforms whose world matrices were rebuilt by the last update
+        uint32_t getUpdatedCount() const { return updatedCount; }
+
+    private:
+        static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+        struct Node
+        {
+            uint32_t transform;     // dense index into the transform pool
+            uint32_t parent;        // dense index or NO_PARENT
+        };
+
+        void rebuildOrder(EngineCore::Registry& registry);
+        void updateRoots(EngineCore::ComponentPool<EngineCore::TransformComponent>& transforms);
+
+        std::vector<Node> order;
+        size_t rootCount = 0;               // order[0, rootCount) are the roots
+        std::vector<uint32_t> depths;       // scratch, [dense index]
+
+        // batch scratch of updateRoots, grows to the largest batch
+        std::vector<uint32_t> batchTransforms;              // dense indices of the dirty roots
+        std::vector<float> batchSoA;                        // 9 arrays of count floats: translation, rotation, scale xyz
+        std::vector<EngineCore::PerObjectUboData> batchMatrices;
+        uint64_t orderedStructureVersion = UINT64_MAX;
+        uint64_t nextVersion = 1;
+        uint32_t updatedCount = 0;
+    };
+}
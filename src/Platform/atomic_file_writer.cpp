@@ -0,0 +1,61 @@
+#include "atomic_file_writer.hpp"
+
+// std
+#include <cassert>
+#include <filesystem>
+#include <stdexcept>
+
+namespace Platform
+{
+    AtomicFileWriter::AtomicFileWriter(const std::string& filePath):
+        m_filePath{filePath},
+        m_tempPath{filePath + ".tmp"}
+    {
+        std::filesystem::create_directories(std::filesystem::path(m_filePath).parent_path());
+        m_out.open(m_tempPath, std::ios::binary | std::ios::trunc);
+        if(m_out.is_open() == false)
+        {
+            throw std::runtime_error("failed to open file for writing: " + m_tempPath);
+        }
+    }
+
+    AtomicFileWriter::~AtomicFileWriter()
+    {
+        if(m_committed == false)
+        {
+            m_out.close();
+            std::error_code error;
+            std::filesystem::remove(m_tempPath, error);
+        }
+    }
+
+    void AtomicFileWriter::write(const void* data, size_t size)
+    {
+        m_out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+
+    void AtomicFileWriter::padTo(uint64_t offset)
+    {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        const uint64_t pos = position();
+        assert(offset >= pos && offset - pos < SECTION_ALIGNMENT);
+        write(zeros, offset - pos);
+    }
+
+    void AtomicFileWriter::commit()
+    {
+        m_out.close();
+        if(m_out.good() == false)
+        {
+            throw std::runtime_error("failed to write file: " + m_tempPath);
+        }
+        m_committed = true;
+
+        std::error_code error;
+        std::filesystem::rename(m_tempPath, m_filePath, error);
+        if(error)
+        {
+            std::filesystem::remove(m_tempPath, error);
+        }
+    }
+}
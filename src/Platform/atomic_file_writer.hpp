@@ -0,0 +1,46 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace Platform
+{
+    // the cooked cache files start every section on this alignment so mapped sections can be read in place
+    inline constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+    inline uint64_t alignSection(uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    // writes a file next to its target and renames it into place on commit(),
+    // a crash mid-write never leaves a truncated file behind for the next run to map
+    class AtomicFileWriter
+    {
+    public:
+        // creates the parent directories, throws when the temporary file can't be opened
+        explicit AtomicFileWriter(const std::string& filePath);
+        // an uncommitted temporary file is removed
+        ~AtomicFileWriter();
+
+        AtomicFileWriter(const AtomicFileWriter&) = delete;
+        AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+        void write(const void* data, size_t size);
+        // zero fills up to offset, an alignSection() result at or past the current position
+        void padTo(uint64_t offset);
+        uint64_t position() { return static_cast<uint64_t>(m_out.tellp()); }
+
+        // throws when any write failed, a failed rename keeps whatever file was there before
+        void commit();
+
+    private:
+        std::string m_filePath;
+        std::string m_tempPath;
+        std::ofstream m_out;
+        bool m_committed = false;
+    };
+}
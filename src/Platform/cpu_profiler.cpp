@@ -0,0 +1,249 @@
+#include "cpu_profiler.hpp"
+
+// std
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Platform
+{
+    namespace
+    {
+        struct ZoneEvent
+        {
+            const char* name;
+            uint64_t startNs;
+            uint64_t endNs;
+        };
+
+        // written by its thread only, read by the trace writer once the capture stopped
+        struct ThreadBuffer
+        {
+            static constexpr uint32_t BLOCK_SIZE = 4096;
+            static constexpr uint32_t MAX_BLOCKS = 256;     // ~1M zones per thread and capture, the rest is dropped
+
+            ~ThreadBuffer()
+            {
+                for(auto& block : blocks)
+                {
+                    delete[] block.load();
+                }
+            }
+
+            uint32_t threadId = 0;
+            std::atomic<const char*> name{nullptr};
+            // blocks are never moved, so the writer can read them while the thread keeps appending
+            std::atomic<ZoneEvent*> blocks[MAX_BLOCKS] = {};
+            std::atomic<uint32_t> count{0};
+            std::atomic<uint32_t> captureGeneration{0};
+        };
+
+        struct CaptureState
+        {
+            std::mutex mutex;       // buffer registration and capture control
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+            std::string tracePath;
+            uint32_t framesLeft = 0;
+            std::atomic<uint64_t> droppedZones{0};
+            const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        };
+
+        CaptureState& getState()
+        {
+            static CaptureState state;
+            return state;
+        }
+
+        ThreadBuffer& getThreadBuffer()
+        {
+            // registered once per thread, buffers outlive their threads so late traces still see them
+            thread_local ThreadBuffer* buffer = nullptr;
+            if(buffer == nullptr)
+            {
+                CaptureState& state = getState();
+                std::lock_guard<std::mutex> lock{state.mutex};
+                state.buffers.push_back(std::make_unique<ThreadBuffer>());
+                buffer = state.buffers.back().get();
+                buffer->threadId = static_cast<uint32_t>(state.buffers.size());
+            }
+            return *buffer;
+        }
+
+        void writeJsonString(FILE* file, const char* text)
+        {
+            fputc('"', file);
+            for(const char* c = text; *c != '\0'; c++)
+            {
+                if(*c == '"' || *c == '\\')
+                {
+                    fputc('\\', file);
+                }
+                fputc(*c, file);
+            }
+            fputc('"', file);
+        }
+    }
+
+    std::atomic<bool> CpuProfiler::capturing{false};
+    std::atomic<uint32_t> CpuProfiler::generation{0};
+
+    void CpuProfiler::beginCapture(const std::string& tracePath, uint32_t frameCount)
+    {
+        CaptureState& state = getState();
+        std::lock_guard<std::mutex> lock{state.mutex};
+        if(capturing.load())
+        {
+            printf("cpu profiler: capture already running\n");
+            return;
+        }
+
+        state.tracePath = tracePath;
+        state.framesLeft = frameCount;
+        state.droppedZones = 0;
+        // zones of older captures that end late compare against this and are dropped
+        generation.fetch_add(1, std::memory_order_release);
+        capturing.store(true, std::memory_order_release);
+    }
+
+    void CpuProfiler::endCapture()
+    {
+        {
+            std::lock_guard<std::mutex> lock{getState().mutex};
+            if(capturing.exchange(false) == false)
+            {
+                return;
+            }
+        }
+        writeTrace();
+    }
+
+    void CpuProfiler::markFrame()
+    {
+        if(isCapturing() == false)
+        {
+            return;
+        }
+
+        bool finished = false;
+        {
+            CaptureState& state = getState();
+            std::lock_guard<std::mutex> lock{state.mutex};
+            finished = state.framesLeft > 0 && --state.framesLeft == 0;
+        }
+        if(finished)
+        {
+            endCapture();
+        }
+    }
+
+    void CpuProfiler::setThreadName(const char* name)
+    {
+        getThreadBuffer().name.store(name, std::memory_order_release);
+    }
+
+    uint64_t CpuProfiler::now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - getState().epoch).count());
+    }
+
+    void CpuProfiler::recordZone(const char* name, uint64_t startNs, uint64_t endNs, uint32_t captureGeneration)
+    {
+        if(isCapturing() == false || captureGeneration != generation.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        ThreadBuffer& buffer = getThreadBuffer();
+        if(buffer.captureGeneration.load(std::memory_order_relaxed) != captureGeneration)
+        {
+            // first zone of this thread in the capture, the writer ignores the buffer until the generation matches
+            buffer.count.store(0, std::memory_order_relaxed);
+            buffer.captureGeneration.store(captureGeneration, std::memory_order_release);
+        }
+
+        const uint32_t index = buffer.count.load(std::memory_order_relaxed);
+        if(index >= ThreadBuffer::BLOCK_SIZE * ThreadBuffer::MAX_BLOCKS)
+        {
+            getState().droppedZones.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        std::atomic<ZoneEvent*>& block = buffer.blocks[index / ThreadBuffer::BLOCK_SIZE];
+        ZoneEvent* events = block.load(std::memory_order_relaxed);
+        if(events == nullptr)
+        {
+            events = new ZoneEvent[ThreadBuffer::BLOCK_SIZE];
+            block.store(events, std::memory_order_relaxed);
+        }
+        events[index % ThreadBuffer::BLOCK_SIZE] = {name, startNs, endNs};
+
+        // publishes the event (and a new block) to the writer
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    void CpuProfiler::writeTrace()
+    {
+        CaptureState& state = getState();
+        std::lock_guard<std::mutex> lock{state.mutex};
+        const uint32_t captureGeneration = generation.load();
+
+        std::error_code error;
+        const std::filesystem::path parent = std::filesystem::path(state.tracePath).parent_path();
+        if(parent.empty() == false)
+        {
+            std::filesystem::create_directories(parent, error);
+        }
+
+        FILE* file = fopen(state.tracePath.c_str(), "w");
+        if(file == nullptr)
+        {
+            printf("cpu profiler: failed to write trace %s\n", state.tracePath.c_str());
+            return;
+        }
+
+        // chrome trace event format: complete events ("X") in microseconds, metadata ("M") for thread names
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        size_t zoneCount = 0;
+        for(const auto& buffer : state.buffers)
+        {
+            if(const char* name = buffer->name.load(std::memory_order_acquire))
+            {
+                fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer->threadId);
+                writeJsonString(file, name);
+                fprintf(file, "}}");
+                first = false;
+            }
+
+            if(buffer->captureGeneration.load(std::memory_order_acquire) != captureGeneration)
+            {
+                continue;
+            }
+
+            const uint32_t count = buffer->count.load(std::memory_order_acquire);
+            for(uint32_t i = 0; i < count; i++)
+            {
+                const ZoneEvent& event = buffer->blocks[i / ThreadBuffer::BLOCK_SIZE].load(std::memory_order_relaxed)[i % ThreadBuffer::BLOCK_SIZE];
+                fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+                writeJsonString(file, event.name);
+                fprintf(file, ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    buffer->threadId, event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0);
+                first = false;
+            }
+            zoneCount += count;
+        }
+        fprintf(file, "\n]}\n");
+        fclose(file);
+
+        printf("cpu profiler: %zu zones written to %s", zoneCount, state.tracePath.c_str());
+        if(const uint64_t dropped = state.droppedZones.load())
+        {
+            printf(" (%llu dropped, buffers full)", static_cast<unsigned long long>(dropped));
+        }
+        printf("\n");
+    }
+}
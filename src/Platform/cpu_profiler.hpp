@@ -0,0 +1,84 @@
+/*************************************************
+CPU Profiler:
+1. scoped zones (CPU_ZONE("name")) on any thread, each thread appends to its own buffer without locks
+2. a capture records every zone for N frames and writes a Chrome trace JSON
+   (chrome://tracing, https://ui.perfetto.dev)
+3. while no capture runs a zone costs one relaxed atomic load, LVE_DISABLE_CPU_PROFILER compiles them out
+
+Zone and thread names must outlive the capture (string literals).
+*************************************************/
+#pragma once
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Platform
+{
+    class CpuProfiler
+    {
+    public:
+        static bool isCapturing() { return capturing.load(std::memory_order_relaxed); }
+
+        // starts recording, the trace is written once frameCount frames were marked (0: only on endCapture)
+        static void beginCapture(const std::string& tracePath, uint32_t frameCount);
+        // stops recording and writes the trace, nothing happens when no capture runs
+        static void endCapture();
+        // call once per frame on the main thread
+        static void markFrame();
+
+        // shows up as the thread's track name in the trace
+        static void setThreadName(const char* name);
+
+        // nanoseconds since the profiler's epoch
+        static uint64_t now();
+        static void recordZone(const char* name, uint64_t startNs, uint64_t endNs, uint32_t captureGeneration);
+        static uint32_t getCaptureGeneration() { return generation.load(std::memory_order_acquire); }
+
+    private:
+        static void writeTrace();
+
+        static std::atomic<bool> capturing;
+        static std::atomic<uint32_t> generation;
+    };
+
+    class CpuZone
+    {
+    public:
+        explicit CpuZone(const char* name)
+        {
+            if(CpuProfiler::isCapturing())
+            {
+                this->name = name;
+                captureGeneration = CpuProfiler::getCaptureGeneration();
+                startNs = CpuProfiler::now();
+            }
+        }
+
+        ~CpuZone()
+        {
+            if(name != nullptr)
+            {
+                CpuProfiler::recordZone(name, startNs, CpuProfiler::now(), captureGeneration);
+            }
+        }
+
+        CpuZone(const CpuZone&) = delete;
+        CpuZone& operator=(const CpuZone&) = delete;
+
+    private:
+        const char* name = nullptr;
+        uint64_t startNs = 0;
+        uint32_t captureGeneration = 0;
+    };
+}
+
+#define LVE_CPU_ZONE_CONCAT_INNER(a, b) a##b
+#define LVE_CPU_ZONE_CONCAT(a, b) LVE_CPU_ZONE_CONCAT_INNER(a, b)
+
+#ifdef LVE_DISABLE_CPU_PROFILER
+#define CPU_ZONE(name)
+#else
+#define CPU_ZONE(name) Platform::CpuZone LVE_CPU_ZONE_CONCAT(cpuZone, __LINE__){name}
+#endif
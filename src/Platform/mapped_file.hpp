@@ -0,0 +1,38 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Platform
+{
+    // read only memory mapping of a whole file, closed on destruction
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        // a missing or empty file leaves the mapping closed, check isOpen()
+        explicit MappedFile(const std::string& filePath);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        bool isOpen() const { return m_data != nullptr; }
+        const uint8_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+        void close();
+
+    private:
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#endif
+    };
+}
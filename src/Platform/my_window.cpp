@@ -6,16 +6,22 @@
 namespace Platform
 {
 
-    MyWindow::MyWindow(int width, int height, std::string name):
-        m_width(width), m_height(height), m_window_name(name)
+    MyWindow::MyWindow(int width, int height, std::string name, bool headless):
+        m_width(width), m_height(height), m_headless(headless), m_window_name(name)
     {
-        initWindow();
+        if(m_headless == false)
+        {
+            initWindow();
+        }
     }
 
     MyWindow::~MyWindow()
     {
-        glfwDestroyWindow(m_window);
-        glfwTerminate();
+        if(m_headless == false)
+        {
+            glfwDestroyWindow(m_window);
+            glfwTerminate();
+        }
     }
 
     void MyWindow::initWindow()
@@ -31,6 +37,10 @@ namespace Platform
 
     void MyWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface)
     {
+        if(m_headless)
+        {
+            throw std::runtime_error("headless window has no surface");
+        }
         if(glfwCreateWindowSurface(instance, m_window, nullptr, surface) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create window surface");
@@ -8,17 +8,19 @@ namespace Platform
     class MyWindow
     {
     public:
-        MyWindow(int width, int height, std::string name);
+        // headless windows never touch glfw, they only carry the render extent
+        MyWindow(int width, int height, std::string name, bool headless = false);
         ~MyWindow();
 
         MyWindow(const MyWindow &) = delete;
         MyWindow& operator=(const MyWindow &) = delete;
 
-        bool shouldClose() { return glfwWindowShouldClose(m_window); }
-        VkExtent2D getExtent() { return VkExtent2D{static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_width)}; }
+        bool shouldClose() { return m_headless ? false : glfwWindowShouldClose(m_window); }
+        VkExtent2D getExtent() { return VkExtent2D{static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height)}; }
         bool wasWindowResized() { return frameBufferResized; }
         void resetWindowResizedFlag() { frameBufferResized = false; }
         GLFWwindow* getGLFWwindow() const { return m_window; }
+        bool isHeadless() const { return m_headless; }
 
         void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface);
 
@@ -29,8 +31,9 @@ namespace Platform
         int m_width;
         int m_height;
         bool frameBufferResized = false;
+        bool m_headless = false;
 
         std::string m_window_name;
-        GLFWwindow *m_window;
+        GLFWwindow *m_window = nullptr;
     };
-}
\ No newline at end of file
+}
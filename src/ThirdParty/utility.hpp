@@ -1,6 +1,7 @@
 #pragma once
 
 // std
+#include <cstdint>
 #include <functional>
 #include <fstream>
 
@@ -14,5 +15,18 @@ namespace Util
         (hashCombine(seed, rest), ...);
     };
 
+    // 64 bit FNV-1a, stable across runs and platforms (std::hash is not), used to key cooked asset caches
+    inline uint64_t fnv1a64(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
     std::vector<char> readFile(const std::string& filepath);
 }
\ No newline at end of file
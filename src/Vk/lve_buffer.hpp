@@ -12,7 +12,8 @@ namespace Vk {
             uint32_t instanceCount,
             VkBufferUsageFlags usageFlags,
             VkMemoryPropertyFlags memoryPropertyFlags,
-            VkDeviceSize minOffsetAlignment = 1);
+            VkDeviceSize minOffsetAlignment = 1,
+            AllocationStrategy allocationStrategy = AllocationStrategy::FreeList);
         ~LveBuffer();
         
         LveBuffer(const LveBuffer&) = delete;
@@ -46,7 +47,7 @@ namespace Vk {
         LveDevice& lveDevice;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        Allocation allocation;
         
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
@@ -0,0 +1,43 @@
+#include "lve_compute_pipeline.hpp"
+#include "lve_pipeline_cache.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace Vk
+{
+    LveComputePipeline::LveComputePipeline(
+            LveDevice& device, 
+            VkShaderModule compShader, 
+            VkPipelineLayout pipelineLayout): lveDevice(device)
+    {
+        assert(compShader != VK_NULL_HANDLE && "cannot create compute pipeline:: no compute shader module");
+        assert(pipelineLayout != VK_NULL_HANDLE && "cannot create compute pipeline:: no pipelineLayout");
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = compShader;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineIndex = -1;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        if(lveDevice.getPipelineCache().createComputePipeline(pipelineInfo, &computePipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create compute pipeline");
+        }
+    }
+
+    LveComputePipeline::~LveComputePipeline()
+    {
+        vkDestroyPipeline(lveDevice.device(), computePipeline, nullptr);
+    }
+
+    void LveComputePipeline::bind(VkCommandBuffer commandBuffer)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    }
+}
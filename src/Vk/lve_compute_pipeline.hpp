@@ -0,0 +1,32 @@
+/*************************************************
+Compute Pipeline Class:
+1. one compute shader module + pipeline layout (see the compute only ShaderEffect)
+2. created through the device's pipeline cache like the graphics pipelines
+*************************************************/
+#pragma once 
+
+#include "lve_device.hpp"
+
+namespace Vk
+{
+    class LveComputePipeline
+    {
+    public:
+        LveComputePipeline(
+            LveDevice& device, 
+            VkShaderModule compShader, 
+            VkPipelineLayout pipelineLayout);
+
+        ~LveComputePipeline();
+
+        LveComputePipeline(const LveComputePipeline&) = delete;
+        LveComputePipeline& operator=(const LveComputePipeline&) = delete;
+
+        void bind(VkCommandBuffer commandBuffer);
+
+    private:
+        LveDevice& lveDevice;
+        VkPipeline computePipeline;
+    };
+
+}
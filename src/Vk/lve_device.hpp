@@ -2,13 +2,20 @@
 
 #include <vulkan/vulkan.h>
 #include "Platform/my_window.hpp"
+#include "vk_memory_allocator.hpp"
 
 // std lib headers
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace Vk {
 
+class LveUploadContext;
+class LvePipelineCache;
+class LveGeometryPool;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -18,9 +25,11 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  uint32_t transferFamily;  // dedicated transfer family when the device has one, graphicsFamily otherwise
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
+  bool hasDedicatedTransfer() const { return transferFamily != graphicsFamily; }
 };
 
 class LveDevice {
@@ -45,31 +54,73 @@ class LveDevice {
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // same as graphicsQueue() when there is no dedicated transfer family
+  VkQueue transferQueue() { return transferQueue_; }
+  bool isHeadless() const { return window.isHeadless(); }
+  MemoryAllocator &getAllocator() { return *allocator; }
+  LveUploadContext &getUploadContext() { return *uploadContext; }
+  LvePipelineCache &getPipelineCache() { return *pipelineCache; }
+  LveGeometryPool &getGeometryPool() { return *geometryPool; }
+  // VK_EXT_pipeline_creation_feedback is enabled, only used for the pipeline cache statistics
+  bool hasPipelineCreationFeedback() const { return pipelineCreationFeedback_; }
+  // optional features (pipeline statistics, inherited queries) are only on when the gpu supports them
+  const VkPhysicalDeviceFeatures &getEnabledFeatures() const { return enabledFeatures_; }
+  // multiDrawIndirect + drawIndirectFirstInstance, what the gpu driven draw path needs at least
+  bool hasMultiDrawIndirect() const {
+    return enabledFeatures_.multiDrawIndirect && enabledFeatures_.drawIndirectFirstInstance;
+  }
+  // VK_KHR_draw_indirect_count is enabled, the draw count can come from a buffer
+  bool hasDrawIndirectCount() const { return cmdDrawIndexedIndirectCount_ != nullptr; }
+  // vkCmdDrawIndexedIndirectCountKHR, only valid when hasDrawIndirectCount()
+  void cmdDrawIndexedIndirectCount(
+      VkCommandBuffer commandBuffer,
+      VkBuffer buffer,
+      VkDeviceSize offset,
+      VkBuffer countBuffer,
+      VkDeviceSize countBufferOffset,
+      uint32_t maxDrawCount,
+      uint32_t stride) {
+    cmdDrawIndexedIndirectCount_(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+  }
+  // 0 when the graphics queue can not write timestamps
+  uint32_t getTimestampValidBits() const { return timestampValidBits_; }
+  // vkQueueSubmit / vkQueuePresentKHR need external synchronization, loader threads submit too
+  std::mutex &queueMutex() { return queueMutex_; }
+  // shares queueMutex() when the transfer queue is the graphics (or present) queue
+  std::mutex &transferQueueMutex() {
+    return transferQueue_ == graphicsQueue_ || transferQueue_ == presentQueue_ ? queueMutex_ : transferQueueMutex_;
+  }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+  bool isFormatSupported(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
+  // sharedWithTransfer: concurrent sharing between the graphics and the transfer family, for buffers the transfer
+  // queue writes ranges of while the graphics queue keeps using the rest (no ownership transfers)
   void createBuffer(
       VkDeviceSize size,
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      Allocation &bufferAllocation,
+      AllocationStrategy strategy = AllocationStrategy::FreeList,
+      bool sharedWithTransfer = false);
+  void destroyBuffer(VkBuffer buffer, Allocation &bufferAllocation);
+  // one off commands, waits for its own fence only. Prefer an LveUploadBatch for anything repeated
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-  void copyBufferToImage(
-      VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
   void createImageWithInfo(
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      Allocation &imageAllocation);
+  void destroyImage(VkImage image, Allocation &imageAllocation);
 
   void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 
@@ -88,9 +139,11 @@ class LveDevice {
   std::vector<const char *> getRequiredExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
+  uint32_t findTransferQueueFamily(const std::vector<VkQueueFamilyProperties> &queueFamilies, uint32_t graphicsFamily);
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char *extensionName);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
   VkInstance instance;
@@ -100,12 +153,30 @@ class LveDevice {
   VkCommandPool commandPool;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+
+  std::mutex queueMutex_;
+  std::mutex transferQueueMutex_;
+  bool pipelineCreationFeedback_ = false;
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount_ = nullptr;
+  VkPhysicalDeviceFeatures enabledFeatures_{};
+  uint32_t timestampValidBits_ = 0;
+
+  // every buffer / image memory is sub allocated from here
+  std::unique_ptr<MemoryAllocator> allocator;
+  // batched staging uploads, destroyed before the allocator
+  std::unique_ptr<LveUploadContext> uploadContext;
+  // loaded after device creation, saved before the device is destroyed
+  std::unique_ptr<LvePipelineCache> pipelineCache;
+  // vertex / index ranges of every mesh, destroyed after the upload context finished writing them
+  std::unique_ptr<LveGeometryPool> geometryPool;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  // headless devices drop the swap chain extension, see LveDevice constructor
+  std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
 
 }  // namespace Vk
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "lve_geometry_pool.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+
+namespace Vk
+{
+    LveGeometryPool::LveGeometryPool(LveDevice& device): lveDevice{device}
+    {}
+
+    LveGeometryPool::~LveGeometryPool()
+    {
+        // the device is idle by now, nothing draws the retired ranges anymore
+        for(auto& frameRetired : retired)
+        {
+            for(const Range& range : frameRetired)
+            {
+                releaseLocked(range);
+            }
+        }
+
+        for(auto& block : blocks)
+        {
+            if(block->vertexRanges.isEmpty() == false || block->indexRanges.isEmpty() == false)
+            {
+                printf("geometry pool: %u vertex / %u index ranges still allocated at shutdown\n",
+                    block->vertexRanges.getAllocationCount(), block->indexRanges.getAllocationCount());
+            }
+            lveDevice.destroyBuffer(block->vertexBuffer, block->vertexAllocation);
+            lveDevice.destroyBuffer(block->indexBuffer, block->indexAllocation);
+        }
+    }
+
+    LveGeometryPool::Range LveGeometryPool::allocate(VkDeviceSize vertexSize, uint32_t vertexStride, VkDeviceSize indexSize, uint32_t indexStride)
+    {
+        assert(vertexSize > 0 && vertexStride > 0 && "a mesh needs vertices");
+        assert((indexSize == 0 || indexStride > 0) && "indices need an index size");
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Range range{};
+        for(uint32_t b = 0; b < blocks.size(); b++)
+        {
+            if(allocateInBlock(b, vertexSize, vertexStride, indexSize, indexStride, range))
+            {
+                return range;
+            }
+        }
+
+        // oversized meshes get a block of their own size (plus alignment slack)
+        createBlock(std::max(BLOCK_VERTEX_SIZE, vertexSize + vertexStride), std::max(BLOCK_INDEX_SIZE, indexSize + indexStride));
+        if(allocateInBlock(static_cast<uint32_t>(blocks.size() - 1), vertexSize, vertexStride, indexSize, indexStride, range) == false)
+        {
+            throw std::runtime_error("failed to allocate mesh from a new geometry block!");
+        }
+        return range;
+    }
+
+    bool LveGeometryPool::allocateInBlock(uint32_t block, VkDeviceSize vertexSize, uint32_t vertexStride, VkDeviceSize indexSize, uint32_t indexStride, Range& range)
+    {
+        Block& b = *blocks[block];
+        const auto vertexOffset = b.vertexRanges.allocate(vertexSize, vertexStride);
+        if(vertexOffset.has_value() == false)
+        {
+            return false;
+        }
+
+        range.block = block;
+        range.vertexOffset = *vertexOffset;
+        range.indexOffset = 0;
+        range.hasIndices = indexSize > 0;
+        if(range.hasIndices == false)
+        {
+            return true;
+        }
+
+        const auto indexOffset = b.indexRanges.allocate(indexSize, indexStride);
+        if(indexOffset.has_value() == false)
+        {
+            b.vertexRanges.free(*vertexOffset);
+            return false;
+        }
+        range.indexOffset = *indexOffset;
+        return true;
+    }
+
+    void LveGeometryPool::createBlock(VkDeviceSize vertexSize, VkDeviceSize indexSize)
+    {
+        auto block = std::make_unique<Block>();
+        lveDevice.createBuffer(
+            vertexSize,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            block->vertexBuffer,
+            block->vertexAllocation,
+            AllocationStrategy::FreeList,
+            true);
+        lveDevice.createBuffer(
+            indexSize,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            block->indexBuffer,
+            block->indexAllocation,
+            AllocationStrategy::FreeList,
+            true);
+        block->vertexRanges.reset(vertexSize);
+        block->indexRanges.reset(indexSize);
+        blocks.push_back(std::move(block));
+
+        printf("geometry pool: block %zu, %llu KB vertices, %llu KB indices\n", blocks.size() - 1,
+            static_cast<unsigned long long>(vertexSize / 1024), static_cast<unsigned long long>(indexSize / 1024));
+    }
+
+    void LveGeometryPool::free(const Range& range)
+    {
+        if(range.block == INVALID_BLOCK)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        retired[currentFrame].push_back(range);
+    }
+
+    void LveGeometryPool::beginFrame(int frameIndex)
+    {
+        assert(frameIndex >= 0 && frameIndex < LveSwapChain::MAX_FRAMES_IN_FLIGHT && "frame index out of range");
+
+        std::lock_guard<std::mutex> lock(mutex);
+        currentFrame = frameIndex;
+        for(const Range& range : retired[frameIndex])
+        {
+            releaseLocked(range);
+        }
+        retired[frameIndex].clear();
+    }
+
+    void LveGeometryPool::releaseLocked(const Range& range)
+    {
+        Block& block = *blocks[range.block];
+        block.vertexRanges.free(range.vertexOffset);
+        if(range.hasIndices)
+        {
+            block.indexRanges.free(range.indexOffset);
+        }
+    }
+
+    VkBuffer LveGeometryPool::getVertexBuffer(uint32_t block)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return blocks[block]->vertexBuffer;
+    }
+
+    VkBuffer LveGeometryPool::getIndexBuffer(uint32_t block)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return blocks[block]->indexBuffer;
+    }
+
+    uint32_t LveGeometryPool::getBlockCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<uint32_t>(blocks.size());
+    }
+}
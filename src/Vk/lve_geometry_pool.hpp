@@ -0,0 +1,83 @@
+/*************************************************
+Geometry Pool Class:
+1. device owned, the vertices and indices of every mesh are sub allocated from a few large device local
+   buffers: one vertex + one index buffer per block, each with a RangeAllocator free list so the ranges of
+   unloaded meshes are reused
+2. meshes are drawn with vertexOffset / firstIndex into their block, draws of one block share a single
+   vertex + index buffer bind (the index buffer is rebound when 16 and 32 bit meshes alternate)
+3. a mesh that fits no block gets a new one, at least BLOCK_VERTEX_SIZE / BLOCK_INDEX_SIZE large
+4. the buffers are shared by the graphics and transfer family, uploads write new ranges while frames
+   keep drawing from the rest (see LveUploadBatch::releaseSharedBufferRange)
+5. freed ranges wait in a per frame slot retire list until that slot's fence signalled (beginFrame),
+   frames still in flight keep drawing an unloaded mesh until then
+*************************************************/
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+#include "vk_range_allocator.hpp"
+
+// std
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Vk
+{
+    class LveGeometryPool
+    {
+    public:
+        static constexpr VkDeviceSize BLOCK_VERTEX_SIZE = 32 * 1024 * 1024;
+        static constexpr VkDeviceSize BLOCK_INDEX_SIZE = 16 * 1024 * 1024;
+        static constexpr uint32_t INVALID_BLOCK = UINT32_MAX;
+
+        // a mesh's place in the pool, offsets in bytes. Ranges are aligned to their element size, so
+        // vertexOffset / stride and indexOffset / index size are the draw's vertexOffset and firstIndex
+        struct Range
+        {
+            uint32_t block = INVALID_BLOCK;
+            VkDeviceSize vertexOffset = 0;
+            VkDeviceSize indexOffset = 0;
+            bool hasIndices = false;
+        };
+
+        LveGeometryPool(LveDevice& device);
+        ~LveGeometryPool();
+
+        LveGeometryPool(const LveGeometryPool&) = delete;
+        LveGeometryPool& operator=(const LveGeometryPool&) = delete;
+
+        // indexSize 0 for meshes without indices, thread safe
+        Range allocate(VkDeviceSize vertexSize, uint32_t vertexStride, VkDeviceSize indexSize, uint32_t indexStride);
+        // deferred until the frame slot recording now comes around again, thread safe
+        void free(const Range& range);
+        // after frameIndex's fence signalled, the ranges freed while that slot last recorded are reused
+        void beginFrame(int frameIndex);
+
+        VkBuffer getVertexBuffer(uint32_t block);
+        VkBuffer getIndexBuffer(uint32_t block);
+        uint32_t getBlockCount();
+
+    private:
+        struct Block
+        {
+            VkBuffer vertexBuffer = VK_NULL_HANDLE;
+            VkBuffer indexBuffer = VK_NULL_HANDLE;
+            Allocation vertexAllocation;
+            Allocation indexAllocation;
+            RangeAllocator vertexRanges;
+            RangeAllocator indexRanges;
+        };
+
+        // tries the vertex and the index range in one block, both or neither
+        bool allocateInBlock(uint32_t block, VkDeviceSize vertexSize, uint32_t vertexStride, VkDeviceSize indexSize, uint32_t indexStride, Range& range);
+        void createBlock(VkDeviceSize vertexSize, VkDeviceSize indexSize);
+        void releaseLocked(const Range& range);
+
+        LveDevice& lveDevice;
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Block>> blocks;
+        int currentFrame = 0;
+        std::vector<Range> retired[LveSwapChain::MAX_FRAMES_IN_FLIGHT];
+    };
+}
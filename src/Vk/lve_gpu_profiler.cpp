@@ -0,0 +1,276 @@
+#include "lve_gpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace Vk
+{
+    LveGpuProfiler::LveGpuProfiler(LveDevice& device, uint32_t framesInFlight, bool pipelineStatistics):
+        lveDevice{device}
+    {
+        const uint32_t validBits = lveDevice.getTimestampValidBits();
+        timestampPeriod = lveDevice.properties.limits.timestampPeriod;
+        timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t{1} << validBits) - 1;
+        if(validBits == 0 || timestampPeriod <= 0.0)
+        {
+            printf("gpu profiler disabled: the graphics queue does not support timestamps\n");
+            return;
+        }
+
+        frameSlots.resize(framesInFlight);
+        timestampPools.resize(framesInFlight, VK_NULL_HANDLE);
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = MAX_SCOPES * 2;
+        for(auto& pool : timestampPools)
+        {
+            if(vkCreateQueryPool(lveDevice.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create timestamp query pool!");
+            }
+        }
+
+        if(pipelineStatistics == false)
+        {
+            return;
+        }
+        if(lveDevice.getEnabledFeatures().pipelineStatisticsQuery == VK_FALSE)
+        {
+            printf("gpu profiler: pipeline statistics are not supported\n");
+            return;
+        }
+
+        statisticsPools.resize(framesInFlight, VK_NULL_HANDLE);
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = 1;
+        poolInfo.pipelineStatistics = STATISTICS_FLAGS;
+        for(auto& pool : statisticsPools)
+        {
+            if(vkCreateQueryPool(lveDevice.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create pipeline statistics query pool!");
+            }
+        }
+    }
+
+    LveGpuProfiler::~LveGpuProfiler()
+    {
+        for(VkQueryPool pool : timestampPools)
+        {
+            vkDestroyQueryPool(lveDevice.device(), pool, nullptr);
+        }
+        for(VkQueryPool pool : statisticsPools)
+        {
+            vkDestroyQueryPool(lveDevice.device(), pool, nullptr);
+        }
+    }
+
+    void LveGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, int frameIndex)
+    {
+        if(isEnabled() == false)
+        {
+            return;
+        }
+        assert(openScopes == 0 && statisticsActive == false && "previous frame left a scope open");
+
+        collect(frameIndex);
+
+        currentFrameIndex = frameIndex;
+        FrameSlot& slot = frameSlots[frameIndex];
+        slot.scopes.clear();
+        slot.frameNumber = frameCounter++;
+        slot.recorded = true;
+        slot.statisticsRecorded = false;
+
+        vkCmdResetQueryPool(commandBuffer, timestampPools[frameIndex], 0, MAX_SCOPES * 2);
+        if(hasPipelineStatistics())
+        {
+            vkCmdResetQueryPool(commandBuffer, statisticsPools[frameIndex], 0, 1);
+        }
+    }
+
+    LveGpuProfiler::ScopeId LveGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+    {
+        if(isEnabled() == false)
+        {
+            return INVALID_SCOPE;
+        }
+        assert(currentFrameIndex >= 0 && "beginScope() outside of a frame");
+
+        FrameSlot& slot = frameSlots[currentFrameIndex];
+        if(slot.scopes.size() == MAX_SCOPES)
+        {
+            return INVALID_SCOPE;
+        }
+
+        const ScopeId scope = static_cast<ScopeId>(slot.scopes.size());
+        slot.scopes.push_back({name, openScopes, false});
+        openScopes++;
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPools[currentFrameIndex], scope * 2);
+        return scope;
+    }
+
+    void LveGpuProfiler::endScope(VkCommandBuffer commandBuffer, ScopeId scope)
+    {
+        if(scope == INVALID_SCOPE)
+        {
+            return;
+        }
+
+        FrameSlot& slot = frameSlots[currentFrameIndex];
+        assert(scope < slot.scopes.size() && slot.scopes[scope].ended == false && "scope ended twice or from another frame");
+        slot.scopes[scope].ended = true;
+        openScopes--;
+
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPools[currentFrameIndex], scope * 2 + 1);
+    }
+
+    void LveGpuProfiler::beginStatistics(VkCommandBuffer commandBuffer)
+    {
+        if(hasPipelineStatistics() == false)
+        {
+            return;
+        }
+        assert(statisticsActive == false && "statistics query already active");
+
+        vkCmdBeginQuery(commandBuffer, statisticsPools[currentFrameIndex], 0, 0);
+        statisticsActive = true;
+    }
+
+    void LveGpuProfiler::endStatistics(VkCommandBuffer commandBuffer)
+    {
+        if(statisticsActive == false)
+        {
+            return;
+        }
+
+        vkCmdEndQuery(commandBuffer, statisticsPools[currentFrameIndex], 0);
+        statisticsActive = false;
+        frameSlots[currentFrameIndex].statisticsRecorded = true;
+    }
+
+    void LveGpuProfiler::collect(int frameIndex)
+    {
+        FrameSlot& slot = frameSlots[frameIndex];
+        if(slot.recorded == false)
+        {
+            return;
+        }
+        slot.recorded = false;
+
+        lastResult.frameNumber = slot.frameNumber;
+        lastResult.scopes.clear();
+
+        // value + availability per query, the fence already signaled so this never waits
+        const uint32_t queryCount = static_cast<uint32_t>(slot.scopes.size()) * 2;
+        std::vector<uint64_t> timestamps(queryCount * 2);
+        if(queryCount > 0)
+        {
+            const VkResult result = vkGetQueryPoolResults(
+                lveDevice.device(), timestampPools[frameIndex],
+                0, queryCount,
+                timestamps.size() * sizeof(uint64_t), timestamps.data(), 2 * sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+            if(result != VK_SUCCESS && result != VK_NOT_READY)
+            {
+                slot.scopes.clear();
+            }
+        }
+
+        for(size_t i = 0; i < slot.scopes.size(); i++)
+        {
+            const uint64_t* begin = &timestamps[i * 4];
+            const uint64_t* end = &timestamps[i * 4 + 2];
+            if(slot.scopes[i].ended == false || begin[1] == 0 || end[1] == 0)
+            {
+                continue;
+            }
+
+            const uint64_t ticks = (end[0] - begin[0]) & timestampMask;
+            ScopeResult scope{slot.scopes[i].name, slot.scopes[i].depth, static_cast<double>(ticks) * timestampPeriod * 1e-6};
+            lastResult.scopes.push_back(scope);
+            accumulate(scope);
+        }
+
+        lastResult.hasStatistics = false;
+        if(slot.statisticsRecorded)
+        {
+            // results come in flag bit order, availability last
+            uint64_t statistics[7] = {};
+            if(vkGetQueryPoolResults(
+                lveDevice.device(), statisticsPools[frameIndex],
+                0, 1,
+                sizeof(statistics), statistics, sizeof(statistics),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) == VK_SUCCESS && statistics[6] != 0)
+            {
+                PipelineStatistics& s = lastResult.statistics;
+                s.inputAssemblyVertices = statistics[0];
+                s.inputAssemblyPrimitives = statistics[1];
+                s.vertexShaderInvocations = statistics[2];
+                s.clippingInvocations = statistics[3];
+                s.clippingPrimitives = statistics[4];
+                s.fragmentShaderInvocations = statistics[5];
+                lastResult.hasStatistics = true;
+
+                statisticsTotal.inputAssemblyVertices += s.inputAssemblyVertices;
+                statisticsTotal.inputAssemblyPrimitives += s.inputAssemblyPrimitives;
+                statisticsTotal.vertexShaderInvocations += s.vertexShaderInvocations;
+                statisticsTotal.clippingInvocations += s.clippingInvocations;
+                statisticsTotal.clippingPrimitives += s.clippingPrimitives;
+                statisticsTotal.fragmentShaderInvocations += s.fragmentShaderInvocations;
+                statisticsSamples++;
+            }
+        }
+    }
+
+    void LveGpuProfiler::accumulate(const ScopeResult& scope)
+    {
+        // names are literals, but the same literal may live at different addresses across translation units
+        auto it = std::find_if(averages.begin(), averages.end(),
+            [&scope](const Average& average){ return strcmp(average.name, scope.name) == 0; });
+        if(it == averages.end())
+        {
+            averages.push_back({scope.name});
+            it = averages.end() - 1;
+        }
+        it->totalMilliseconds += scope.milliseconds;
+        it->samples++;
+    }
+
+    void LveGpuProfiler::printAverages()
+    {
+        if(averages.empty())
+        {
+            return;
+        }
+
+        printf("gpu:");
+        for(const Average& average : averages)
+        {
+            printf(" %s %.3f ms |", average.name, average.totalMilliseconds / average.samples);
+        }
+        printf("\n");
+
+        if(statisticsSamples > 0)
+        {
+            const double n = static_cast<double>(statisticsSamples);
+            printf("gpu per frame: %.0f vertices, %.0f primitives, %.0f vs invocations, %.0f clipped primitives, %.0f fs invocations\n",
+                statisticsTotal.inputAssemblyVertices / n,
+                statisticsTotal.inputAssemblyPrimitives / n,
+                statisticsTotal.vertexShaderInvocations / n,
+                statisticsTotal.clippingPrimitives / n,
+                statisticsTotal.fragmentShaderInvocations / n);
+        }
+
+        averages.clear();
+        statisticsTotal = PipelineStatistics{};
+        statisticsSamples = 0;
+    }
+}
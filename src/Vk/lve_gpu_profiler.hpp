@@ -0,0 +1,135 @@
+/*************************************************
+GPU Profiler Class:
+1. one timestamp query pool (and optionally one pipeline statistics pool) per frame in flight
+2. scoped timers: beginScope / endScope write timestamps into any cmd buffer of the frame
+   (primary or secondary, they only have to execute in recording order)
+3. results are read back when the frame slot comes around again (MAX_FRAMES_IN_FLIGHT frames late),
+   its fence already signaled so nothing stalls
+4. per scope averages over an interval, for the periodic log
+
+Main thread only, scope names must outlive the profiler (string literals).
+*************************************************/
+#pragma once
+
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Vk
+{
+    class LveGpuProfiler
+    {
+    public:
+        static constexpr uint32_t MAX_SCOPES = 32;  // per frame, further scopes are not timed
+
+        using ScopeId = uint32_t;
+        static constexpr ScopeId INVALID_SCOPE = UINT32_MAX;
+
+        struct ScopeResult
+        {
+            const char* name;
+            uint32_t depth;         // nesting level, 0 for outermost scopes
+            double milliseconds;
+        };
+
+        struct PipelineStatistics
+        {
+            uint64_t inputAssemblyVertices = 0;
+            uint64_t inputAssemblyPrimitives = 0;
+            uint64_t vertexShaderInvocations = 0;
+            uint64_t clippingInvocations = 0;
+            uint64_t clippingPrimitives = 0;
+            uint64_t fragmentShaderInvocations = 0;
+        };
+
+        struct FrameResult
+        {
+            uint64_t frameNumber = 0;
+            std::vector<ScopeResult> scopes;
+            bool hasStatistics = false;
+            PipelineStatistics statistics;
+        };
+
+        // pipelineStatistics: also count primitives / shader invocations, ignored when the device lacks the feature
+        LveGpuProfiler(LveDevice& device, uint32_t framesInFlight, bool pipelineStatistics = false);
+        ~LveGpuProfiler();
+
+        LveGpuProfiler(const LveGpuProfiler&) = delete;
+        LveGpuProfiler& operator=(const LveGpuProfiler&) = delete;
+
+        bool isEnabled() const { return timestampPools.empty() == false; }
+        bool hasPipelineStatistics() const { return statisticsPools.empty() == false; }
+
+        // after the frame's fence signaled, outside any render pass: collects the slot's old results, resets its pools
+        void beginFrame(VkCommandBuffer commandBuffer, int frameIndex);
+
+        ScopeId beginScope(VkCommandBuffer commandBuffer, const char* name);
+        void endScope(VkCommandBuffer commandBuffer, ScopeId scope);
+
+        // one statistics query per frame, begin and end in the same primary cmd buffer. While it is active the
+        // secondaries executed in between have to inherit getActiveStatisticsFlags() (needs inheritedQueries)
+        void beginStatistics(VkCommandBuffer commandBuffer);
+        void endStatistics(VkCommandBuffer commandBuffer);
+        VkQueryPipelineStatisticFlags getActiveStatisticsFlags() const { return statisticsActive ? STATISTICS_FLAGS : 0; }
+
+        // most recent frame whose results came back
+        const FrameResult& getLastResult() const { return lastResult; }
+
+        // average ms per scope name since the last call, then starts a new interval
+        void printAverages();
+
+    private:
+        static constexpr VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+        struct RecordedScope
+        {
+            const char* name;
+            uint32_t depth;
+            bool ended;
+        };
+
+        struct FrameSlot
+        {
+            std::vector<RecordedScope> scopes;
+            uint64_t frameNumber = 0;
+            bool recorded = false;
+            bool statisticsRecorded = false;
+        };
+
+        struct Average
+        {
+            const char* name;
+            double totalMilliseconds = 0.0;
+            uint32_t samples = 0;
+        };
+
+        void collect(int frameIndex);
+        void accumulate(const ScopeResult& scope);
+
+        LveDevice& lveDevice;
+        double timestampPeriod;         // ns per tick
+        uint64_t timestampMask;
+
+        std::vector<VkQueryPool> timestampPools;    // [frameIndex], MAX_SCOPES * 2 queries
+        std::vector<VkQueryPool> statisticsPools;   // [frameIndex], 1 query
+        std::vector<FrameSlot> frameSlots;
+        int currentFrameIndex = -1;
+        uint32_t openScopes = 0;
+        bool statisticsActive = false;
+        uint64_t frameCounter = 0;
+
+        FrameResult lastResult;
+        std::vector<Average> averages;
+        PipelineStatistics statisticsTotal;
+        uint32_t statisticsSamples = 0;
+    };
+}
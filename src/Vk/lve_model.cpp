@@ -9,9 +9,12 @@
 
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <unordered_map>
 
 namespace std
@@ -30,103 +33,275 @@ namespace std
 
 namespace Vk
 {
-
-    LveModel::LveModel(LveDevice& device, const LveModel::Builder& builder):
-        lveDevice(device)
+    namespace
     {
-        createVertexBuffers(builder.vertices);
-        createIndexBuffers(builder.indices);
+        // unit vector -> [-1, 1]^2: project onto the octahedron |x| + |y| + |z| = 1, fold the lower half over the diagonals.
+        // Decoded in simple_shader_vertex.glsl
+        glm::vec2 encodeOctahedral(const glm::vec3& normal)
+        {
+            const float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            if(sum == 0.0f)
+            {
+                return glm::vec2{0.0f};
+            }
+
+            const glm::vec3 n = normal / sum;
+            if(n.z >= 0.0f)
+            {
+                return glm::vec2{n.x, n.y};
+            }
+            return glm::vec2{
+                (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)};
+        }
     }
 
-    LveModel::~LveModel()
+    LveModel::LveModel(LveDevice& device, const LveModel::Builder& builder, VertexFormat format, LveUploadBatch* uploadBatch):
+        LveModel(device, builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()), builder.indices.data(), static_cast<uint32_t>(builder.indices.size()), VK_INDEX_TYPE_UINT32, format, uploadBatch)
     {}
 
-    // first copy data from host to staging buffer, and then copy data from staging buffer to device buffer
-    void LveModel::createVertexBuffers(const std::vector<Vertex>& vertices)
+    LveModel::LveModel(LveDevice& device, const Vertex* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, VkIndexType indexType,
+        VertexFormat format, LveUploadBatch* uploadBatch):
+        lveDevice(device),
+        vertexFormat(format)
     {
-        vertex_count = static_cast<uint32_t>(vertices.size());
-        assert(vertex_count >= 3 && "vertex count must be at least 3");
-        uint32_t vertexSize = sizeof(vertices[0]);
+        std::unique_ptr<LveUploadBatch> localBatch;
+        if(uploadBatch == nullptr)
+        {
+            localBatch = std::make_unique<LveUploadBatch>(device.getUploadContext());
+            uploadBatch = localBatch.get();
+        }
+
+        computeBounds(vertices, vertexCount);
+        computeQuantization(vertices, vertexCount);
+        createGeometry(vertices, vertexCount, indices, indexCount, indexType, *uploadBatch);
 
-        LveBuffer stagingBuffer
+        if(localBatch)
         {
-            lveDevice,
-            vertexSize,
-            vertex_count,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
+            localBatch->submitAndWait();
+        }
+    }
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data()); 
-        // unmap will be handled by buffer cleaning up
+    LveModel::~LveModel()
+    {
+        lveDevice.getGeometryPool().free(geometry);
+    }
 
-        vertexBuffer = std::make_unique<LveBuffer>(
-            lveDevice,
-            vertexSize,
-            vertex_count,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
+    void LveModel::computeBounds(const Vertex* vertices, uint32_t vertexCount)
+    {
+        boundingBox.min = glm::vec3{std::numeric_limits<float>::max()};
+        boundingBox.max = glm::vec3{std::numeric_limits<float>::lowest()};
+        for(uint32_t i = 0; i < vertexCount; i++)
+        {
+            boundingBox.min = glm::min(boundingBox.min, vertices[i].position);
+            boundingBox.max = glm::max(boundingBox.max, vertices[i].position);
+        }
 
-        lveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), stagingBuffer.getBufferSize());
+        // centered on the box, the radius from the farthest vertex is tighter than half the box diagonal
+        boundingSphere.center = 0.5f * (boundingBox.min + boundingBox.max);
+        float radiusSquared = 0.0f;
+        for(uint32_t i = 0; i < vertexCount; i++)
+        {
+            const glm::vec3 offset = vertices[i].position - boundingSphere.center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+        boundingSphere.radius = std::sqrt(radiusSquared);
     }
 
-    void LveModel::createIndexBuffers(const std::vector<uint32_t>& indices)
+    void LveModel::computeQuantization(const Vertex* vertices, uint32_t vertexCount)
     {
-        index_count = static_cast<uint32_t>(indices.size());
-        hasIndexBuffer = index_count > 0;
-        if(hasIndexBuffer == false)
+        quantization = Quantization{};
+        if(vertexFormat == VertexFormat::Full)
         {
             return;
         }
 
-        uint32_t indexSize = sizeof(indices[0]);
+        // snorm16 positions around the box center, a flat axis keeps scale 1 (all its positions encode to 0)
+        const glm::vec3 halfExtent = 0.5f * (boundingBox.max - boundingBox.min);
+        quantization.positionOffset = 0.5f * (boundingBox.min + boundingBox.max);
+        for(int axis = 0; axis < 3; axis++)
+        {
+            quantization.positionScale[axis] = halfExtent[axis] > 0.0f ? halfExtent[axis] : 1.0f;
+        }
+
+        // unorm16 uvs over the mesh's uv bounds, tiled uvs outside [0, 1] keep their full range
+        glm::vec2 uvMin{std::numeric_limits<float>::max()};
+        glm::vec2 uvMax{std::numeric_limits<float>::lowest()};
+        for(uint32_t i = 0; i < vertexCount; i++)
+        {
+            uvMin = glm::min(uvMin, vertices[i].uv);
+            uvMax = glm::max(uvMax, vertices[i].uv);
+        }
+        quantization.uvOffset = uvMin;
+        for(int axis = 0; axis < 2; axis++)
+        {
+            const float extent = uvMax[axis] - uvMin[axis];
+            quantization.uvScale[axis] = extent > 0.0f ? extent : 1.0f;
+        }
+    }
+
+    void LveModel::encodeVertices(const Vertex* vertices, uint32_t vertexCount, void* dst) const
+    {
+        assert(vertexFormat != VertexFormat::Full && "full vertices are copied as they are");
+
+        const glm::vec3 invPositionScale = 1.0f / quantization.positionScale;
+        const glm::vec2 invUvScale = 1.0f / quantization.uvScale;
+        const bool hasColor = vertexFormat == VertexFormat::CompactColor;
+        for(uint32_t i = 0; i < vertexCount; i++)
+        {
+            const Vertex& vertex = vertices[i];
+            CompactVertex& out = hasColor ?
+                static_cast<CompactColorVertex*>(dst)[i].base :
+                static_cast<CompactVertex*>(dst)[i];
+
+            // glm's packs clamp and round, the formats' snorm / unorm conversions invert them
+            const glm::vec3 position = (vertex.position - quantization.positionOffset) * invPositionScale;
+            out.position[0] = glm::packSnorm2x16(glm::vec2{position.x, position.y});
+            out.position[1] = glm::packSnorm2x16(glm::vec2{position.z, 0.0f});
+            out.normal = glm::packSnorm2x16(encodeOctahedral(vertex.normal));
+            out.uv = glm::packUnorm2x16((vertex.uv - quantization.uvOffset) * invUvScale);
+            if(hasColor)
+            {
+                static_cast<CompactColorVertex*>(dst)[i].color = glm::packUnorm4x8(glm::vec4{vertex.color, 1.0f});
+            }
+        }
+    }
+
+    LveModel::VertexFormat LveModel::selectVertexFormat(const Vertex* vertices, uint32_t vertexCount, bool allowCompact)
+    {
+        if(allowCompact == false || vertexCount == 0)
+        {
+            return VertexFormat::Full;
+        }
+
+        glm::vec3 positionMin{std::numeric_limits<float>::max()};
+        glm::vec3 positionMax{std::numeric_limits<float>::lowest()};
+        glm::vec2 uvMin{std::numeric_limits<float>::max()};
+        glm::vec2 uvMax{std::numeric_limits<float>::lowest()};
+        bool hasColor = false;
+        for(uint32_t i = 0; i < vertexCount; i++)
+        {
+            const Vertex& vertex = vertices[i];
+            positionMin = glm::min(positionMin, vertex.position);
+            positionMax = glm::max(positionMax, vertex.position);
+            uvMin = glm::min(uvMin, vertex.uv);
+            uvMax = glm::max(uvMax, vertex.uv);
+            hasColor = hasColor || vertex.color != glm::vec3{1.0f};
+        }
+
+        // snorm16 spends 65534 steps on the extent, unorm16 65535
+        const glm::vec3 positionStep = (positionMax - positionMin) / 65534.0f;
+        const glm::vec2 uvStep = (uvMax - uvMin) / 65535.0f;
+        if(std::max({positionStep.x, positionStep.y, positionStep.z}) > MAX_POSITION_STEP ||
+            std::max(uvStep.x, uvStep.y) > MAX_UV_STEP)
+        {
+            return VertexFormat::Full;
+        }
+        return hasColor ? VertexFormat::CompactColor : VertexFormat::Compact;
+    }
+
+    uint32_t LveModel::getVertexStride(VertexFormat format)
+    {
+        switch(format)
+        {
+            case VertexFormat::Compact: return sizeof(CompactVertex);
+            case VertexFormat::CompactColor: return sizeof(CompactColorVertex);
+            default: return sizeof(Vertex);
+        }
+    }
 
-        LveBuffer stagingBuffer
+    const char* LveModel::getVertexFormatName(VertexFormat format)
+    {
+        switch(format)
         {
-            lveDevice,
-            indexSize,
-            index_count,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
+            case VertexFormat::Compact: return "compact";
+            case VertexFormat::CompactColor: return "compact + color";
+            default: return "full";
+        }
+    }
+
+    // data is copied into the batch's staging memory, the batch copies it into the pool's ranges and makes them visible to graphics
+    void LveModel::createGeometry(const Vertex* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, VkIndexType sourceIndexType, LveUploadBatch& uploadBatch)
+    {
+        vertex_count = vertexCount;
+        assert(vertex_count >= 3 && "vertex count must be at least 3");
+        index_count = indexCount;
+        hasIndexBuffer = index_count > 0;
+        assert((sourceIndexType == VK_INDEX_TYPE_UINT32 || selectIndexType(vertex_count) == VK_INDEX_TYPE_UINT16) && "16 bit indices can't address every vertex");
+        indexType = selectIndexType(vertex_count);
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
-        // unmap will be handled by buffer cleaning up
+        LveGeometryPool& pool = lveDevice.getGeometryPool();
+        const uint32_t vertexStride = getVertexStride(vertexFormat);
+        const VkDeviceSize vertexSize = vertexStride * static_cast<VkDeviceSize>(vertex_count);
+        const uint32_t indexStride = getIndexSize(indexType);
+        const VkDeviceSize indexSize = indexStride * static_cast<VkDeviceSize>(index_count);
+        geometry = pool.allocate(vertexSize, vertexStride, indexSize, indexStride);
 
-        indexBuffer = std::make_unique<LveBuffer>(
-            lveDevice,
-            indexSize,
-            index_count,
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
-        
-        lveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), stagingBuffer.getBufferSize());
+        const VkBuffer vertexBuffer = pool.getVertexBuffer(geometry.block);
+        if(vertexFormat == VertexFormat::Full)
+        {
+            uploadBatch.copyToBuffer(vertices, vertexSize, vertexBuffer, geometry.vertexOffset);
+        }
+        else
+        {
+            // encoded straight into the staging memory
+            const StagingRange staging = uploadBatch.stage(nullptr, vertexSize);
+            encodeVertices(vertices, vertex_count, staging.mapped);
+            uploadBatch.copyStagingToBuffer(staging, vertexSize, vertexBuffer, geometry.vertexOffset);
+        }
+        uploadBatch.releaseSharedBufferRange(vertexBuffer, geometry.vertexOffset, vertexSize, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+
+        if(hasIndexBuffer)
+        {
+            const VkBuffer indexBuffer = pool.getIndexBuffer(geometry.block);
+            if(indexType == sourceIndexType)
+            {
+                uploadBatch.copyToBuffer(indices, indexSize, indexBuffer, geometry.indexOffset);
+            }
+            else
+            {
+                // narrowed straight into the staging memory
+                const StagingRange staging = uploadBatch.stage(nullptr, indexSize);
+                const uint32_t* source = static_cast<const uint32_t*>(indices);
+                uint16_t* narrowed = static_cast<uint16_t*>(staging.mapped);
+                for(uint32_t i = 0; i < index_count; i++)
+                {
+                    narrowed[i] = static_cast<uint16_t>(source[i]);
+                }
+                uploadBatch.copyStagingToBuffer(staging, indexSize, indexBuffer, geometry.indexOffset);
+            }
+            uploadBatch.releaseSharedBufferRange(indexBuffer, geometry.indexOffset, indexSize, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+        }
     }
 
-    void LveModel::draw(VkCommandBuffer commandBuffer)
+    void LveModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) const
     {
         if(hasIndexBuffer)
         {
-            vkCmdDrawIndexed(commandBuffer, index_count, 1, 0, 0, 0);
+            vkCmdDrawIndexed(commandBuffer, index_count, instanceCount, getFirstIndex(), getVertexOffset(), firstInstance);
         }
         else 
         {
-            vkCmdDraw(commandBuffer, vertex_count, 1, 0, 0);    
+            vkCmdDraw(commandBuffer, vertex_count, instanceCount, static_cast<uint32_t>(getVertexOffset()), firstInstance);
         }
     }
 
-    void LveModel::bind(VkCommandBuffer commandBuffer)
+    void LveModel::bind(VkCommandBuffer commandBuffer, BoundGeometry& bound) const
     {
-        VkBuffer buffers[] = {vertexBuffer->getBuffer()};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-        if(hasIndexBuffer)
+        // every mesh of a block shares its buffers, firstIndex counts in the bound index type
+        LveGeometryPool& pool = lveDevice.getGeometryPool();
+        if(bound.block != geometry.block)
+        {
+            VkBuffer buffers[] = {pool.getVertexBuffer(geometry.block)};
+            VkDeviceSize offsets[] = {0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+            bound.indexType = VK_INDEX_TYPE_MAX_ENUM;
+            bound.block = geometry.block;
+        }
+        if(hasIndexBuffer && bound.indexType != indexType)
         {
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindIndexBuffer(commandBuffer, pool.getIndexBuffer(geometry.block), 0, indexType);
+            bound.indexType = indexType;
         }
     }
 
@@ -150,4 +325,34 @@ namespace Vk
 
         return attributeDescriptions;
     }
+
+    std::vector<VkVertexInputBindingDescription> LveModel::getBindingDescriptions(VertexFormat format)
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = getVertexStride(format);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
+
+    // locations match the vertex shader variants, the compact formats leave out color (location 1) unless they carry it
+    std::vector<VkVertexInputAttributeDescription> LveModel::getAttributeDescriptions(VertexFormat format)
+    {
+        if(format == VertexFormat::Full)
+        {
+            return Vertex::getAttributeDescriptions();
+        }
+
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+        attributeDescriptions.push_back({0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(CompactVertex, position)});
+        if(format == VertexFormat::CompactColor)
+        {
+            attributeDescriptions.push_back({1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactColorVertex, color)});
+        }
+        attributeDescriptions.push_back({2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal)});
+        attributeDescriptions.push_back({3, 0, VK_FORMAT_R16G16_UNORM, offsetof(CompactVertex, uv)});
+
+        return attributeDescriptions;
+    }
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "lve_device.hpp"
 #include "lve_buffer.hpp"
+#include "lve_geometry_pool.hpp"
+#include "lve_upload_context.hpp"
 
 //libs
 #define GLM_FORCE_RADIANS
@@ -17,7 +19,16 @@ namespace Vk
     class LveModel
     {
     public:
+        // vertex layout in the geometry pool, chosen per mesh at load time (selectVertexFormat)
+        enum class VertexFormat : uint32_t
+        {
+            Full,           // Vertex, 44 bytes of floats
+            Compact,        // CompactVertex, 16 bytes
+            CompactColor,   // CompactVertex + unorm8 rgba color stream, 20 bytes
+        };
+        static constexpr uint32_t VERTEX_FORMAT_COUNT = 3;
 
+        // source vertex of every format, what loaders and the mesh cache produce
         struct Vertex
         {
             glm::vec3 position{};
@@ -34,32 +45,120 @@ namespace Vk
             }
         };
 
+        // positions as snorm16 and uvs as unorm16 relative to the mesh's Quantization, octahedral snorm16 normal
+        struct CompactVertex
+        {
+            uint32_t position[2];   // x, y | z, 0
+            uint32_t normal;
+            uint32_t uv;
+        };
+        struct CompactColorVertex
+        {
+            CompactVertex base;
+            uint32_t color;         // rgba8, a = 1
+        };
+
+        // per mesh dequantization of compact vertices: position = q * positionScale + positionOffset,
+        // uv = q * uvScale + uvOffset. Identity for full vertices
+        struct Quantization
+        {
+            glm::vec3 positionScale{1.0f};
+            glm::vec3 positionOffset{0.0f};
+            glm::vec2 uvScale{1.0f};
+            glm::vec2 uvOffset{0.0f};
+        };
+
         struct Builder
         {
             std::vector<Vertex> vertices{};
             std::vector<uint32_t> indices{};
         };
 
-        LveModel(LveDevice& device, const LveModel::Builder& builder);
+        // local space bounds of the vertex positions, computed once when the model is created
+        struct BoundingBox
+        {
+            glm::vec3 min{};
+            glm::vec3 max{};
+        };
+
+        struct BoundingSphere
+        {
+            glm::vec3 center{};
+            float radius = 0.0f;
+        };
+
+        // what bind() last put on a cmd buffer, start every cmd buffer with a default constructed one
+        struct BoundGeometry
+        {
+            uint32_t block = LveGeometryPool::INVALID_BLOCK;
+            VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+        };
+
+        // uploads through uploadBatch when given (usable once that batch completed), otherwise submits and waits itself
+        LveModel(LveDevice& device, const LveModel::Builder& builder, VertexFormat format = VertexFormat::Full, LveUploadBatch* uploadBatch = nullptr);
+        // copies (or encodes, for compact formats) straight from caller memory (e.g. a mapped mesh cache) into the staging buffers.
+        // indices are uint16_t or uint32_t as indexType says, 32 bit indices are narrowed when selectIndexType(vertexCount) allows
+        LveModel(LveDevice& device, const Vertex* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, VkIndexType indexType,
+            VertexFormat format = VertexFormat::Full, LveUploadBatch* uploadBatch = nullptr);
         ~LveModel();
         LveModel(const LveModel&) = delete;
         LveModel& operator=(const LveModel&) = delete;
 
-        void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer);
+        // compact unless allowCompact is false or 16 bits can't hold the mesh's positions / uvs within MAX_POSITION_STEP /
+        // MAX_UV_STEP, the color stream is kept when any vertex color differs from white (the OBJ default)
+        static VertexFormat selectVertexFormat(const Vertex* vertices, uint32_t vertexCount, bool allowCompact);
+        static uint32_t getVertexStride(VertexFormat format);
+        static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(VertexFormat format);
+        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format);
+        static const char* getVertexFormatName(VertexFormat format);
+        // 16 bit whenever every vertex can be addressed (primitive restart is off, 0xFFFF is a plain index)
+        static VkIndexType selectIndexType(uint32_t vertexCount) { return vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+        static uint32_t getIndexSize(VkIndexType indexType) { return indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4; }
+
+        // largest quantization step a compact mesh may have, in model units / uv units
+        static constexpr float MAX_POSITION_STEP = 1.0f / 4096.0f;
+        static constexpr float MAX_UV_STEP = 1.0f / 8192.0f;
+
+        // binds the vertex / index buffers of the mesh's geometry pool block, shared with every mesh of that block.
+        // Skips what bound already holds and updates it, the index buffer is rebound when the index type changes
+        void bind(VkCommandBuffer commandBuffer, BoundGeometry& bound) const;
+        void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+
+        const BoundingBox& getBoundingBox() const { return boundingBox; }
+        const BoundingSphere& getBoundingSphere() const { return boundingSphere; }
+        uint32_t getVertexCount() const { return vertex_count; }
+        // 0 for meshes without an index buffer
+        uint32_t getIndexCount() const { return hasIndexBuffer ? index_count : 0; }
+        // where the mesh lives in the geometry pool, in vertices / indices of its block
+        uint32_t getGeometryBlock() const { return geometry.block; }
+        int32_t getVertexOffset() const { return static_cast<int32_t>(geometry.vertexOffset / getVertexStride(vertexFormat)); }
+        uint32_t getFirstIndex() const { return static_cast<uint32_t>(geometry.indexOffset / getIndexSize(indexType)); }
+        VkIndexType getIndexType() const { return indexType; }
+        VertexFormat getVertexFormat() const { return vertexFormat; }
+        // the shader's dequantization of this mesh's vertices
+        const Quantization& getQuantization() const { return quantization; }
 
     private:
-        void createVertexBuffers(const std::vector<Vertex>& vertices);
-        void createIndexBuffers(const std::vector<uint32_t>& indices);
+        void computeBounds(const Vertex* vertices, uint32_t vertexCount);
+        // ranges of the compact formats, from the bounding box and the uv bounds
+        void computeQuantization(const Vertex* vertices, uint32_t vertexCount);
+        void encodeVertices(const Vertex* vertices, uint32_t vertexCount, void* dst) const;
+        // allocates the mesh's ranges in the geometry pool and uploads into them
+        void createGeometry(const Vertex* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, VkIndexType sourceIndexType, LveUploadBatch& uploadBatch);
 
         LveDevice& lveDevice;
 
-        std::unique_ptr<LveBuffer> vertexBuffer;
+        LveGeometryPool::Range geometry;
+        VertexFormat vertexFormat = VertexFormat::Full;
+        Quantization quantization;
         uint32_t vertex_count;
 
         bool hasIndexBuffer = false;
-        std::unique_ptr<LveBuffer> indexBuffer;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT32;
         uint32_t index_count;
 
+        BoundingBox boundingBox;
+        BoundingSphere boundingSphere;
+
     };
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+/*************************************************
+Offscreen Target Class:
+1. ring of color/depth images + framebuffers
+2. per-frame fences (no semaphores, nothing is presented)
+3. read back rendered images to host memory
+
+Stands in for LveSwapChain when the engine runs headless
+*************************************************/
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <string>
+#include <vector>
+
+namespace Vk
+{
+    class LveOffscreenTarget
+    {
+    public:
+        static constexpr int MAX_FRAMES_IN_FLIGHT = LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+        static constexpr uint32_t IMAGE_COUNT = MAX_FRAMES_IN_FLIGHT + 1;
+
+        LveOffscreenTarget(LveDevice& device, VkExtent2D extent);
+        ~LveOffscreenTarget();
+
+        LveOffscreenTarget(const LveOffscreenTarget&) = delete;
+        LveOffscreenTarget& operator=(const LveOffscreenTarget&) = delete;
+
+        VkFramebuffer getFrameBuffer(int index) { return framebuffers[index]; }
+        VkRenderPass getRenderPass() { return renderPass; }
+        size_t imageCount() { return colorImages.size(); }
+        VkFormat getImageFormat() { return colorFormat; }
+        VkExtent2D getExtent() { return extent; }
+
+        float extentAspectRatio()
+        {
+            return static_cast<float>(extent.width) / static_cast<float>(extent.height);
+        }
+
+        VkResult acquireNextImage(uint32_t* imageIndex);
+        VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+
+        // blocks until the image is finished, then copies it into tightly packed RGBA8 pixels
+        void readbackImage(uint32_t imageIndex, std::vector<uint8_t>& pixels);
+        // writes the image as binary PPM
+        void saveImageToFile(uint32_t imageIndex, const std::string& filePath);
+
+    private:
+        void createColorResources();
+        void createDepthResources();
+        void createRenderPass();
+        void createFramebuffers();
+        void createSyncObjects();
+
+        VkFormat findColorFormat();
+        VkFormat findDepthFormat();
+
+        LveDevice& device;
+        VkExtent2D extent;
+
+        VkFormat colorFormat;
+        VkFormat depthFormat;
+        VkRenderPass renderPass;
+
+        std::vector<VkImage> colorImages;
+        std::vector<Allocation> colorImageAllocations;
+        std::vector<VkImageView> colorImageViews;
+        std::vector<VkImage> depthImages;
+        std::vector<Allocation> depthImageAllocations;
+        std::vector<VkImageView> depthImageViews;
+        std::vector<VkFramebuffer> framebuffers;
+
+        std::vector<VkFence> inFlightFences;
+        std::vector<VkFence> imagesInFlight;
+        size_t currentFrame = 0;
+        uint32_t nextImage = 0;
+    };
+}
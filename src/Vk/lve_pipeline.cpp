@@ -1,5 +1,6 @@
 #include "lve_pipeline.hpp"
 #include "lve_model.hpp"
+#include "lve_pipeline_cache.hpp"
 
 #include "ThirdParty/utility.hpp"
 
@@ -78,7 +79,7 @@ namespace Vk {
         pipelineInfo.basePipelineIndex = -1;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-        if(vkCreateGraphicsPipelines(lveDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+        if(lveDevice.getPipelineCache().createGraphicsPipeline(pipelineInfo, &graphicsPipeline) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create graphics pipeline");
         }
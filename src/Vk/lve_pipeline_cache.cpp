@@ -0,0 +1,203 @@
+#include "lve_pipeline_cache.hpp"
+
+#include "Platform/atomic_file_writer.hpp"
+#include "Platform/mapped_file.hpp"
+#include "ThirdParty/utility.hpp"
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace Vk
+{
+    LvePipelineCache::LvePipelineCache(LveDevice& device, const std::string& cachePath):
+        lveDevice{device},
+        cachePath{cachePath}
+    {
+        const std::vector<uint8_t> initialData = load();
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = initialData.size();
+        cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+        if(vkCreatePipelineCache(lveDevice.device(), &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+        printf("pipeline cache: loaded %zu bytes from %s\n", initialData.size(), cachePath.c_str());
+    }
+
+    LvePipelineCache::~LvePipelineCache()
+    {
+        try
+        {
+            save();
+        }
+        catch(const std::exception& e)
+        {
+            printf("pipeline cache not written: %s\n", e.what());
+        }
+
+        if(lveDevice.hasPipelineCreationFeedback())
+        {
+            printf("pipeline cache: %u pipelines, %u hits, %u compiles\n", getPipelineCount(), getHitCount(), getCompileCount());
+        }
+        else
+        {
+            printf("pipeline cache: %u pipelines (no creation feedback, hits unknown)\n", getPipelineCount());
+        }
+        vkDestroyPipelineCache(lveDevice.device(), pipelineCache, nullptr);
+    }
+
+    VkResult LvePipelineCache::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline* pipeline)
+    {
+        VkGraphicsPipelineCreateInfo info = pipelineInfo;
+
+        // the driver reports per pipeline whether the cache had it
+        VkPipelineCreationFeedbackEXT feedback{};
+        std::vector<VkPipelineCreationFeedbackEXT> stageFeedbacks(pipelineInfo.stageCount);
+        VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+        if(lveDevice.hasPipelineCreationFeedback())
+        {
+            feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+            feedbackInfo.pNext = info.pNext;
+            feedbackInfo.pPipelineCreationFeedback = &feedback;
+            feedbackInfo.pipelineStageCreationFeedbackCount = pipelineInfo.stageCount;
+            feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedbacks.data();
+            info.pNext = &feedbackInfo;
+        }
+
+        const VkResult result = vkCreateGraphicsPipelines(lveDevice.device(), pipelineCache, 1, &info, nullptr, pipeline);
+        if(result != VK_SUCCESS)
+        {
+            return result;
+        }
+
+        countPipeline(feedback);
+        return result;
+    }
+
+    VkResult LvePipelineCache::createComputePipeline(const VkComputePipelineCreateInfo& pipelineInfo, VkPipeline* pipeline)
+    {
+        VkComputePipelineCreateInfo info = pipelineInfo;
+
+        VkPipelineCreationFeedbackEXT feedback{};
+        VkPipelineCreationFeedbackEXT stageFeedback{};
+        VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+        if(lveDevice.hasPipelineCreationFeedback())
+        {
+            feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+            feedbackInfo.pNext = info.pNext;
+            feedbackInfo.pPipelineCreationFeedback = &feedback;
+            feedbackInfo.pipelineStageCreationFeedbackCount = 1;
+            feedbackInfo.pPipelineStageCreationFeedbacks = &stageFeedback;
+            info.pNext = &feedbackInfo;
+        }
+
+        const VkResult result = vkCreateComputePipelines(lveDevice.device(), pipelineCache, 1, &info, nullptr, pipeline);
+        if(result != VK_SUCCESS)
+        {
+            return result;
+        }
+
+        countPipeline(feedback);
+        return result;
+    }
+
+    void LvePipelineCache::countPipeline(const VkPipelineCreationFeedbackEXT& feedback)
+    {
+        pipelineCount++;
+        if(feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)
+        {
+            if(feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT)
+            {
+                hitCount++;
+            }
+            else
+            {
+                compileCount++;
+            }
+        }
+    }
+
+    void LvePipelineCache::save()
+    {
+        size_t dataSize = 0;
+        if(vkGetPipelineCacheData(lveDevice.device(), pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+        {
+            return;
+        }
+        std::vector<uint8_t> data(dataSize);
+        if(vkGetPipelineCacheData(lveDevice.device(), pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to get pipeline cache data!");
+        }
+
+        const VkPhysicalDeviceProperties& properties = lveDevice.properties;
+        Header header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.vendorID = properties.vendorID;
+        header.deviceID = properties.deviceID;
+        header.driverVersion = properties.driverVersion;
+        memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.dataSize = dataSize;
+        header.dataHash = Util::fnv1a64(data.data(), dataSize);
+
+        Platform::AtomicFileWriter out{cachePath};
+        out.write(&header, sizeof(header));
+        out.write(data.data(), dataSize);
+        out.commit();
+    }
+
+    std::vector<uint8_t> LvePipelineCache::load()
+    {
+        Platform::MappedFile file{cachePath};
+        if(file.isOpen() == false || validate(file.data(), file.size()) == false)
+        {
+            return {};
+        }
+
+        const uint8_t* data = file.data() + sizeof(Header);
+        return std::vector<uint8_t>(data, data + reinterpret_cast<const Header*>(file.data())->dataSize);
+    }
+
+    bool LvePipelineCache::validate(const uint8_t* data, size_t size) const
+    {
+        if(size < sizeof(Header))
+        {
+            return false;
+        }
+
+        // a driver update or another gpu makes the blob useless (drivers should reject it, not all do)
+        const Header* header = reinterpret_cast<const Header*>(data);
+        const VkPhysicalDeviceProperties& properties = lveDevice.properties;
+        if(header->magic != MAGIC || header->version != VERSION ||
+            header->vendorID != properties.vendorID || header->deviceID != properties.deviceID ||
+            header->driverVersion != properties.driverVersion ||
+            memcmp(header->pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        {
+            return false;
+        }
+
+        if(header->dataSize != size - sizeof(Header) || header->dataSize < sizeof(VkPipelineCacheHeaderVersionOne))
+        {
+            return false;
+        }
+
+        const uint8_t* blob = data + sizeof(Header);
+        if(Util::fnv1a64(blob, header->dataSize) != header->dataHash)
+        {
+            return false;
+        }
+
+        // the blob starts with the driver's own header, it has to agree with ours
+        VkPipelineCacheHeaderVersionOne blobHeader;
+        memcpy(&blobHeader, blob, sizeof(blobHeader));
+        return blobHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+            blobHeader.vendorID == properties.vendorID &&
+            blobHeader.deviceID == properties.deviceID &&
+            memcmp(blobHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+}
@@ -0,0 +1,75 @@
+/*************************************************
+Pipeline Cache Class:
+1. device owned VkPipelineCache, every pipeline is created through it
+2. loaded from disk at startup, written back at shutdown, data from another gpu / driver is dropped
+3. counts cache hits vs. compiles (needs VK_EXT_pipeline_creation_feedback, otherwise only the total)
+
+File layout:
+    Header | vkGetPipelineCacheData blob
+*************************************************/
+#pragma once
+
+#include "lve_device.hpp"
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Vk
+{
+    class LvePipelineCache
+    {
+    public:
+        static constexpr uint32_t MAGIC = 0x5045564C; // "LVEP"
+        static constexpr uint32_t VERSION = 1;
+
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint32_t driverVersion;
+            uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+            uint64_t dataSize;
+            uint64_t dataHash;      // fnv1a64 of the blob, catches truncated / corrupted files
+        };
+
+        LvePipelineCache(LveDevice& device, const std::string& cachePath = "./build/pipeline_cache.bin");
+        // saves the cache and prints the hit statistics
+        ~LvePipelineCache();
+
+        LvePipelineCache(const LvePipelineCache&) = delete;
+        LvePipelineCache& operator=(const LvePipelineCache&) = delete;
+
+        VkPipelineCache getPipelineCache() const { return pipelineCache; }
+
+        // vkCreateGraphicsPipelines through the cache, thread safe
+        VkResult createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline* pipeline);
+        // vkCreateComputePipelines through the cache, thread safe
+        VkResult createComputePipeline(const VkComputePipelineCreateInfo& pipelineInfo, VkPipeline* pipeline);
+
+        void save();
+
+        uint32_t getPipelineCount() const { return pipelineCount.load(); }
+        uint32_t getHitCount() const { return hitCount.load(); }
+        uint32_t getCompileCount() const { return compileCount.load(); }
+
+    private:
+        // empty when the file is missing, stale or malformed
+        std::vector<uint8_t> load();
+        bool validate(const uint8_t* data, size_t size) const;
+        // the creation feedback of one successfully created pipeline
+        void countPipeline(const VkPipelineCreationFeedbackEXT& feedback);
+
+        LveDevice& lveDevice;
+        std::string cachePath;
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+        std::atomic<uint32_t> pipelineCount{0};
+        std::atomic<uint32_t> hitCount{0};
+        std::atomic<uint32_t> compileCount{0};
+    };
+}
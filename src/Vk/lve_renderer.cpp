@@ -1,4 +1,5 @@
 #include "lve_renderer.hpp"
+#include "lve_geometry_pool.hpp"
 
 // std
 #include <stdexcept>
@@ -6,15 +7,28 @@
 
 namespace Vk
 {
-    LveRenderer::LveRenderer(Platform::MyWindow& window, LveDevice& device):
-        myWindow(window), lveDevice(device)
+    LveRenderer::LveRenderer(Platform::MyWindow& window, LveDevice& device, uint32_t recordingThreadCount, bool pipelineStatistics):
+        myWindow(window),
+        lveDevice(device),
+        gpuProfiler(device, LveSwapChain::MAX_FRAMES_IN_FLIGHT, pipelineStatistics),
+        recordingThreadCount(recordingThreadCount)
     {
-        recreateSwapChain();
+        assert(recordingThreadCount > 0 && "need at least one recording thread");
+        if(myWindow.isHeadless())
+        {
+            offscreenTarget = std::make_unique<LveOffscreenTarget>(lveDevice, myWindow.getExtent());
+        }
+        else 
+        {
+            recreateSwapChain();
+        }
         createCommandBuffers();
+        createThreadCommandPools();
     }
 
     LveRenderer::~LveRenderer()
     {
+        destroyThreadCommandPools();
         freeCommandBuffers();
     }
 
@@ -71,11 +85,54 @@ namespace Vk
         commandBuffers.clear();
     }
     
+    void LveRenderer::createThreadCommandPools()
+    {
+        threadCommandPools.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT * recordingThreadCount);
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = lveDevice.findPhysicalQueueFamilies().graphicsFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // reset as a whole every frame
+
+        for(auto& threadPool : threadCommandPools)
+        {
+            if(vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &threadPool.commandPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create thread command pool");
+            }
+        }
+    }
+
+    void LveRenderer::destroyThreadCommandPools()
+    {
+        // destroying a pool frees its cmd buffers
+        for(auto& threadPool : threadCommandPools)
+        {
+            vkDestroyCommandPool(lveDevice.device(), threadPool.commandPool, nullptr);
+        }
+        threadCommandPools.clear();
+    }
+
+    void LveRenderer::resetThreadCommandPools(int frameIndex)
+    {
+        for(uint32_t i = 0; i < recordingThreadCount; i++)
+        {
+            auto& threadPool = threadCommandPools[frameIndex * recordingThreadCount + i];
+            if(threadPool.usedCount > 0)
+            {
+                vkResetCommandPool(lveDevice.device(), threadPool.commandPool, 0);
+                threadPool.usedCount = 0;
+            }
+        }
+    }
+
     VkCommandBuffer LveRenderer::beginFrame()
     {
         assert(isFrameStarted == false && "can't call beginFrame() while alread in progress");
         
-        auto result = lveSwapChain->acquireNextImage(&currentImageIndex);
+        auto result = offscreenTarget ? 
+            offscreenTarget->acquireNextImage(&currentImageIndex) : 
+            lveSwapChain->acquireNextImage(&currentImageIndex);
 
         if(result == VK_ERROR_OUT_OF_DATE_KHR) // window resized
         {
@@ -90,6 +147,11 @@ namespace Vk
 
         isFrameStarted = true;
 
+        // acquireNextImage waited on this frame's fence, its secondary cmd buffers are no longer in use
+        resetThreadCommandPools(currentFrameIndex);
+        // and no frame draws the geometry unloaded while this slot last recorded
+        lveDevice.getGeometryPool().beginFrame(currentFrameIndex);
+
         auto commandBuffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -98,6 +160,9 @@ namespace Vk
         {
             throw std::runtime_error("failed to begin recording command buffer");
         }
+
+        // same fence as above, the queries this slot wrote MAX_FRAMES_IN_FLIGHT frames ago are available
+        gpuProfiler.beginFrame(commandBuffer, currentFrameIndex);
         return commandBuffer;
     }
 
@@ -111,6 +176,18 @@ namespace Vk
             throw std::runtime_error("failed to record command buffer");
         }
 
+        if(offscreenTarget)
+        {
+            // nothing to present and nothing to resize
+            offscreenTarget->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+            lastSubmittedImageIndex = currentImageIndex;
+            hasSubmittedFrame = true;
+
+            isFrameStarted = false;
+            currentFrameIndex = (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+            return;
+        }
+
         auto result = lveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
 
         if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || myWindow.wasWindowResized())
@@ -127,18 +204,26 @@ namespace Vk
         currentFrameIndex = (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
-    void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
+    void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents)
     {
         assert(isFrameStarted && "can't call beginSwapChainRenderPass() if frame is not in progress");
         assert(commandBuffer == getCurrentCommandBuffer() && "can't begin render pass on cmd buffer from a different frame");
     
-         VkRenderPassBeginInfo renderPassInfo{};
+        renderPassScope = gpuProfiler.beginScope(commandBuffer, "RenderPass");
+        // queries active across vkCmdExecuteCommands need inheritedQueries
+        if(contents == VK_SUBPASS_CONTENTS_INLINE || lveDevice.getEnabledFeatures().inheritedQueries)
+        {
+            gpuProfiler.beginStatistics(commandBuffer);
+        }
+
+        VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = lveSwapChain->getRenderPass();
-        renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex);
+        renderPassInfo.renderPass = getSwapChainRenderPass();
+        renderPassInfo.framebuffer = getCurrentFramebuffer();
 
+        const VkExtent2D extent = getRenderExtent();
         renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
+        renderPassInfo.renderArea.extent = extent;
 
         std::array<VkClearValue, 2> clearValues{};
         clearValues[0].color = {{0.01f, 0.01f, 0.01f, 1.0f}};
@@ -146,16 +231,26 @@ namespace Vk
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+        // a subpass recorded in secondary cmd buffers only accepts vkCmdExecuteCommands, each secondary sets its own state
+        if(contents == VK_SUBPASS_CONTENTS_INLINE)
+        {
+            setViewportAndScissor(commandBuffer);
+        }
+    }
+
+    void LveRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer)
+    {
+        const VkExtent2D extent = getRenderExtent();
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float>(lveSwapChain->getSwapChainExtent().width);
-        viewport.height = static_cast<float>(lveSwapChain->getSwapChainExtent().height);
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        VkRect2D scissor{{0, 0}, lveSwapChain->getSwapChainExtent()};
+        VkRect2D scissor{{0, 0}, extent};
         vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     }
@@ -166,6 +261,85 @@ namespace Vk
         assert(commandBuffer == getCurrentCommandBuffer() && "can't end render pass on cmd buffer from a different frame");
     
         vkCmdEndRenderPass(commandBuffer);
+
+        gpuProfiler.endStatistics(commandBuffer);
+        gpuProfiler.endScope(commandBuffer, renderPassScope);
+        renderPassScope = LveGpuProfiler::INVALID_SCOPE;
+    }
+
+    VkCommandBuffer LveRenderer::beginSecondaryCommandBuffer(uint32_t threadIndex)
+    {
+        assert(isFrameStarted && "can't begin a secondary cmd buffer if frame is not in progress");
+        assert(threadIndex < recordingThreadCount && "thread index out of range");
+
+        auto& threadPool = threadCommandPools[currentFrameIndex * recordingThreadCount + threadIndex];
+        if(threadPool.usedCount == threadPool.secondaryCommandBuffers.size())
+        {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandPool = threadPool.commandPool;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer newCommandBuffer;
+            if(vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &newCommandBuffer) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to allocate secondary command buffer");
+            }
+            threadPool.secondaryCommandBuffers.push_back(newCommandBuffer);
+        }
+        VkCommandBuffer commandBuffer = threadPool.secondaryCommandBuffers[threadPool.usedCount++];
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = getSwapChainRenderPass();
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = getCurrentFramebuffer();
+        inheritanceInfo.pipelineStatistics = gpuProfiler.getActiveStatisticsFlags();
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to begin recording secondary command buffer");
+        }
+
+        setViewportAndScissor(commandBuffer);
+        return commandBuffer;
+    }
+
+    void LveRenderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer)
+    {
+        if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record secondary command buffer");
+        }
+    }
+
+    void LveRenderer::saveLastFrame(const std::string& filePath)
+    {
+        assert(offscreenTarget && "can only save frames when rendering headless");
+        assert(isFrameStarted == false && "can't save a frame while a frame is in progress");
+        if(hasSubmittedFrame == false)
+        {
+            return;
+        }
+        offscreenTarget->saveImageToFile(lastSubmittedImageIndex, filePath);
+    }
+
+    VkFramebuffer LveRenderer::getCurrentFramebuffer() const
+    {
+        return offscreenTarget ? 
+            offscreenTarget->getFrameBuffer(currentImageIndex) : 
+            lveSwapChain->getFrameBuffer(currentImageIndex);
+    }
+
+    VkExtent2D LveRenderer::getRenderExtent() const
+    {
+        return offscreenTarget ? offscreenTarget->getExtent() : lveSwapChain->getSwapChainExtent();
     }
 
 };
\ No newline at end of file
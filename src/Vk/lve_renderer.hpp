@@ -1,8 +1,10 @@
 /*************************************************
 Renderer Class:
-1. SwapChain
+1. SwapChain (or offscreen target when the window is headless)
 2. cmd buffers' life cycle
-3. draw a frame
+3. per-thread, per-frame command pools for secondary cmd buffers (multi-threaded recording)
+4. draw a frame
+5. gpu profiler: the render pass is timed (and its pipeline statistics counted) automatically
 
 We only have one render in an application
 *************************************************/
@@ -11,6 +13,8 @@ We only have one render in an application
 #include "Platform/my_window.hpp"
 #include "lve_device.hpp"
 #include "lve_swap_chain.hpp"
+#include "lve_offscreen_target.hpp"
+#include "lve_gpu_profiler.hpp"
 
 // std
 #include <memory>
@@ -21,17 +25,28 @@ namespace Vk {
     class LveRenderer
     {
     public:
-        LveRenderer(Platform::MyWindow& window, LveDevice& device);
+        // recordingThreadCount: how many threads may record secondary command buffers concurrently
+        // pipelineStatistics: let the gpu profiler count primitives / shader invocations of the render pass
+        LveRenderer(Platform::MyWindow& window, LveDevice& device, uint32_t recordingThreadCount = 1, bool pipelineStatistics = false);
         ~LveRenderer();
 
         LveRenderer(const LveRenderer&) = delete;
         LveRenderer& operator=(const LveRenderer&) = delete;
 
         [[nodiscard("neglect vkRenderPass")]]
-        VkRenderPass getSwapChainRenderPass() const { return lveSwapChain->getRenderPass(); }
+        VkRenderPass getSwapChainRenderPass() const 
+        { 
+            return offscreenTarget ? offscreenTarget->getRenderPass() : lveSwapChain->getRenderPass(); 
+        }
         
         [[nodiscard("neglect aspect ratio")]]
-        float getAspectRatio() const { return lveSwapChain->extentAspectRatio(); }
+        float getAspectRatio() const 
+        { 
+            return offscreenTarget ? offscreenTarget->extentAspectRatio() : lveSwapChain->extentAspectRatio(); 
+        }
+
+        [[nodiscard("neglect isHeadless")]]
+        bool isHeadless() const { return offscreenTarget != nullptr; }
 
         [[nodiscard("neglect isFrameInProgress")]]
         bool isFrameInProgress() const { return isFrameStarted; }
@@ -48,22 +63,56 @@ namespace Vk {
             return currentFrameIndex;
         }
 
+        uint32_t getRecordingThreadCount() const { return recordingThreadCount; }
+
+        LveGpuProfiler& getGpuProfiler() { return gpuProfiler; }
+
         VkCommandBuffer beginFrame();
         void endFrame();
-        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        // use VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS when the pass is recorded with beginSecondaryCommandBuffer()
+        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
         void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+        // a secondary cmd buffer inheriting the current frame's render pass / framebuffer, viewport and scissor already set.
+        // Only the thread owning threadIndex may call this concurrently, buffers are recycled once the frame's fence signaled
+        VkCommandBuffer beginSecondaryCommandBuffer(uint32_t threadIndex);
+        void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+
+        // headless only: read back the image submitted by the last endFrame() and write it as PPM
+        void saveLastFrame(const std::string& filePath);
+
     private:
         void createCommandBuffers();
         void freeCommandBuffers();
+        void createThreadCommandPools();
+        void destroyThreadCommandPools();
+        void resetThreadCommandPools(int frameIndex);
         void recreateSwapChain();
+        void setViewportAndScissor(VkCommandBuffer commandBuffer);
+
+        VkFramebuffer getCurrentFramebuffer() const;
+        VkExtent2D getRenderExtent() const;
 
         Platform::MyWindow& myWindow;
         LveDevice& lveDevice;
         std::unique_ptr<LveSwapChain> lveSwapChain;
+        std::unique_ptr<LveOffscreenTarget> offscreenTarget;
         std::vector<VkCommandBuffer> commandBuffers;
+        LveGpuProfiler gpuProfiler;
+        LveGpuProfiler::ScopeId renderPassScope{LveGpuProfiler::INVALID_SCOPE};
+
+        struct ThreadCommandPool
+        {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> secondaryCommandBuffers;
+            uint32_t usedCount = 0;
+        };
+        uint32_t recordingThreadCount;
+        std::vector<ThreadCommandPool> threadCommandPools; // [frameIndex * recordingThreadCount + threadIndex]
 
         uint32_t currentImageIndex;
+        uint32_t lastSubmittedImageIndex{0};
+        bool hasSubmittedFrame{false};
         int currentFrameIndex{0};
         bool isFrameStarted{false};
     };
@@ -0,0 +1,69 @@
+#include "lve_ring_buffer.hpp"
+
+#include "lve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace Vk
+{
+    LveRingBuffer::LveRingBuffer(LveDevice& device, VkDeviceSize frameSize, VkBufferUsageFlags usageFlags)
+    {
+        // every offset handed out must be valid as a dynamic offset for both uniform and storage descriptors
+        const auto& limits = device.properties.limits;
+        alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+        this->frameSize = (frameSize + alignment - 1) / alignment * alignment;
+
+        // one extra frame of slack at the end: a descriptor window of up to frameSize bytes stays inside the
+        // buffer for any dynamic offset handed out by the last region
+        buffer = std::make_unique<LveBuffer>(
+            device,
+            this->frameSize,
+            LveSwapChain::MAX_FRAMES_IN_FLIGHT + 1,
+            usageFlags,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        buffer->map();
+    }
+
+    LveRingBuffer::~LveRingBuffer()
+    {
+    }
+
+    void LveRingBuffer::beginFrame(int frameIndex)
+    {
+        assert(frameIndex >= 0 && frameIndex < LveSwapChain::MAX_FRAMES_IN_FLIGHT && "frame index out of range");
+        frameBegin = static_cast<VkDeviceSize>(frameIndex) * frameSize;
+        head = frameBegin;
+    }
+
+    void* LveRingBuffer::allocate(VkDeviceSize size, uint32_t& dynamicOffset)
+    {
+        const VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+        if(offset + size > frameBegin + frameSize)
+        {
+            throw std::runtime_error("ring buffer frame region overflow!");
+        }
+
+        head = offset + size;
+        dynamicOffset = static_cast<uint32_t>(offset);
+        return static_cast<char*>(buffer->getMappedMemory()) + offset;
+    }
+
+    uint32_t LveRingBuffer::push(const void* data, VkDeviceSize size)
+    {
+        uint32_t dynamicOffset = 0;
+        void* dst = allocate(size, dynamicOffset);
+        memcpy(dst, data, size);
+        return dynamicOffset;
+    }
+
+    VkDescriptorBufferInfo LveRingBuffer::descriptorInfo(VkDeviceSize range) const
+    {
+        assert(range <= frameSize && "descriptor window larger than a frame region");
+        return buffer->descriptorInfo(range, 0);
+    }
+}
@@ -0,0 +1,54 @@
+/*************************************************
+Ring Buffer Class:
+1. one persistently mapped host visible buffer split into MAX_FRAMES_IN_FLIGHT regions
+2. linear allocation of transient per-frame data (per object uniforms, instance data)
+3. allocations are addressed through dynamic offsets, so a single descriptor set covers the whole ring
+
+A region is only rewritten after the renderer waited on that frame's fence
+*************************************************/
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <memory>
+
+namespace Vk
+{
+    class LveRingBuffer
+    {
+    public:
+        LveRingBuffer(LveDevice& device, VkDeviceSize frameSize, VkBufferUsageFlags usageFlags);
+        ~LveRingBuffer();
+
+        LveRingBuffer(const LveRingBuffer&) = delete;
+        LveRingBuffer& operator=(const LveRingBuffer&) = delete;
+
+        // rewinds to the region of this frame, everything pushed during the previous use of the region is dropped
+        void beginFrame(int frameIndex);
+
+        // copies data into the current frame region and returns its dynamic offset
+        uint32_t push(const void* data, VkDeviceSize size);
+        template<typename T>
+        uint32_t push(const T& data) { return push(&data, sizeof(T)); }
+
+        // reserves space without copying, the caller writes through the returned pointer
+        void* allocate(VkDeviceSize size, uint32_t& dynamicOffset);
+
+        // descriptor covering one dynamic "window" of the ring, offset 0 + range (at most one frame region)
+        VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const;
+
+        VkBuffer getBuffer() const { return buffer->getBuffer(); }
+        VkDeviceSize getFrameSize() const { return frameSize; }
+        VkDeviceSize getFrameUsedSize() const { return head - frameBegin; }
+
+    private:
+        VkDeviceSize frameSize;
+        VkDeviceSize alignment;
+        VkDeviceSize frameBegin = 0;
+        VkDeviceSize head = 0;
+
+        std::unique_ptr<LveBuffer> buffer;
+    };
+}
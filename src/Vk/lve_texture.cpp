@@ -1,38 +1,180 @@
 #include "lve_texture.hpp"
-#include "lve_buffer.hpp"
+#include "lve_upload_context.hpp"
 
 // lib
 #define STB_IMAGE_IMPLEMENTATION
 #include "ThirdParty\stb_image.h"
 
 // std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
 #include <iostream>
 
 namespace Vk
 {
+    static VkDeviceSize getMipChainSize(int width, int height, uint32_t levelCount)
+    {
+        VkDeviceSize size = 0;
+        for(uint32_t level = 0; level < levelCount; level++)
+        {
+            size += static_cast<VkDeviceSize>(std::max(width >> level, 1)) * std::max(height >> level, 1) * 4;
+        }
+        return size;
+    }
+
+    static float srgbToLinear(uint8_t value)
+    {
+        static const auto table = []
+        {
+            std::array<float, 256> t{};
+            for(int i = 0; i < 256; i++)
+            {
+                const float c = i / 255.0f;
+                t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return t;
+        }();
+        return table[value];
+    }
+
+    static uint8_t linearToSrgb(float value)
+    {
+        // 12 bit input is plenty for an 8 bit result
+        static const auto table = []
+        {
+            std::array<uint8_t, 4096> t{};
+            for(int i = 0; i < 4096; i++)
+            {
+                const float c = i / 4095.0f;
+                const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                t[i] = static_cast<uint8_t>(std::clamp(s, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+            return t;
+        }();
+        return table[static_cast<int>(std::clamp(value, 0.0f, 1.0f) * 4095.0f + 0.5f)];
+    }
+
     void LveTexture::Builder::loadTextureFromFile(const std::string& path)
     {
+        releaseData();
+
         // load texture using stbi_load()
-        data = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-        if (!data) {
+        stbiData = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!stbiData) {
             throw std::runtime_error("failed to load texture image!");
         }
+        data = stbiData;
+        mipLevels = 1;
+    }
+
+    void LveTexture::Builder::setExternalData(int width, int height, uint32_t mipLevels, const void* data)
+    {
+        releaseData();
+
+        this->width = width;
+        this->height = height;
+        this->channels = 4;
+        this->mipLevels = mipLevels;
+        this->data = data;
+    }
+
+    void LveTexture::Builder::generateMipmaps()
+    {
+        assert(data != nullptr && "generateMipmaps needs mip 0");
+
+        const uint32_t levelCount = getMipLevelCount(width, height);
+        std::vector<uint8_t> chain(getMipChainSize(width, height, levelCount));
+        memcpy(chain.data(), data, getLevelOffset(1));
+
+        // 2x2 box filter, odd edges clamp to the last row / column
+        for(uint32_t level = 1; level < levelCount; level++)
+        {
+            const int srcWidth = std::max(width >> (level - 1), 1);
+            const int srcHeight = std::max(height >> (level - 1), 1);
+            const int dstWidth = std::max(width >> level, 1);
+            const int dstHeight = std::max(height >> level, 1);
+            const uint8_t* src = chain.data() + getMipChainSize(width, height, level - 1);
+            uint8_t* dst = chain.data() + getMipChainSize(width, height, level);
+
+            for(int y = 0; y < dstHeight; y++)
+            {
+                const int y0 = std::min(2 * y, srcHeight - 1);
+                const int y1 = std::min(2 * y + 1, srcHeight - 1);
+                for(int x = 0; x < dstWidth; x++)
+                {
+                    const int x0 = std::min(2 * x, srcWidth - 1);
+                    const int x1 = std::min(2 * x + 1, srcWidth - 1);
+                    const uint8_t* texels[4] = {
+                        src + (y0 * srcWidth + x0) * 4,
+                        src + (y0 * srcWidth + x1) * 4,
+                        src + (y1 * srcWidth + x0) * 4,
+                        src + (y1 * srcWidth + x1) * 4,
+                    };
+
+                    uint8_t* out = dst + (y * dstWidth + x) * 4;
+                    for(int c = 0; c < 3; c++)
+                    {
+                        const float sum = srgbToLinear(texels[0][c]) + srgbToLinear(texels[1][c]) + srgbToLinear(texels[2][c]) + srgbToLinear(texels[3][c]);
+                        out[c] = linearToSrgb(sum * 0.25f);
+                    }
+                    // alpha is linear already
+                    out[3] = static_cast<uint8_t>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+                }
+            }
+        }
+
+        releaseData();
+        channels = 4;
+        mipChain = std::move(chain);
+        mipLevels = levelCount;
+        data = mipChain.data();
+    }
+
+    VkDeviceSize LveTexture::Builder::getLevelOffset(uint32_t level) const
+    {
+        return getMipChainSize(width, height, level);
+    }
+
+    void LveTexture::Builder::releaseData()
+    {
+        if(stbiData)
+            stbi_image_free(stbiData);
+        stbiData = nullptr;
+        mipChain.clear();
+        data = nullptr;
+        mipLevels = 1;
     }
 
     LveTexture::Builder::~Builder()
     {
-        if(data)
-            stbi_image_free(data);
+        releaseData();
     }
 
     LveTexture::LveTexture(LveDevice& device, const Builder& builder): 
         lveDevice(device),
         width(builder.width),
         height(builder.height),
-        channels(builder.channels)
+        channels(builder.channels),
+        // without blit support only the levels the builder brings are used
+        mipLevels(supportsBlitMipmaps(device) ? getMipLevelCount(builder.width, builder.height) : builder.mipLevels)
+    {
+        createTexture(builder);
+        createTextureImageView();
+        createTextureSampler();
+    }
+
+    LveTexture::LveTexture(LveDevice& device, int width, int height, uint32_t mipLevels): 
+        lveDevice(device),
+        width(width),
+        height(height),
+        channels(4),
+        mipLevels(mipLevels)
     {
-        createTexture(builder.data);
+        createImage();
         createTextureImageView();
         createTextureSampler();
     }
@@ -43,32 +185,50 @@ namespace Vk
 
         vkDestroyImageView(lveDevice.device(), textureImageView, nullptr);
 
-        vkDestroyImage(lveDevice.device(), textureImage, nullptr);
-        vkFreeMemory(lveDevice.device(), textureImageMemory, nullptr);
+        lveDevice.destroyImage(textureImage, textureImageAllocation);
     }
 
-    void LveTexture::createTexture(void* data)
+    uint32_t LveTexture::getMipLevelCount(int width, int height)
     {
-        if(data == nullptr)
+        uint32_t levels = 1;
+        for(int size = std::max(width, height); size > 1; size >>= 1)
+        {
+            levels++;
+        }
+        return levels;
+    }
+
+    bool LveTexture::supportsBlitMipmaps(LveDevice& device)
+    {
+        return device.isFormatSupported(
+            FORMAT,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT);
+    }
+
+    void LveTexture::createTexture(const Builder& builder)
+    {
+        if(builder.data == nullptr)
         {
             // TODO: create empty texture
             assert(false);
         }
 
-        // create staging buffer
-        LveBuffer stagingBuffer
-        {
-            lveDevice,
-            static_cast<VkDeviceSize>(width * height * 4),
-            1,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
+        // the builder may bring more levels than the image holds when blits are not supported
+        const uint32_t uploadedLevels = std::min(builder.mipLevels, mipLevels);
+        const VkDeviceSize uploadSize = builder.getLevelOffset(uploadedLevels);
 
-        // copy data to staging buffer
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer(data);
+        createImage();
 
+        // staging copy, transitions, copies and blits share one submission
+        LveUploadBatch uploadBatch{lveDevice.getUploadContext()};
+        const StagingRange staging = uploadBatch.stage(builder.data, uploadSize);
+        recordUpload(uploadBatch, staging, uploadedLevels);
+        uploadBatch.submitAndWait();
+    }
+
+    void LveTexture::createImage()
+    {
         // image create info
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -76,21 +236,144 @@ namespace Vk
         imageInfo.extent.width = static_cast<uint32_t>(width);
         imageInfo.extent.height = static_cast<uint32_t>(height);
         imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
+        imageInfo.mipLevels = mipLevels;
         imageInfo.arrayLayers = 1;
-        imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+        imageInfo.format = FORMAT;
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        // transfer src: every level is the blit source of the next one
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.flags = 0; // Optional
 
-        lveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        lveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+    }
+
+    void LveTexture::recordUpload(LveUploadBatch& uploadBatch, const StagingRange& staging, uint32_t uploadedLevels)
+    {
+        assert(uploadedLevels >= 1 && uploadedLevels <= mipLevels && "mip 0 has to come from the staging buffer");
+
+        uploadBatch.transitionImageLayout(textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+
+        std::vector<VkBufferImageCopy> regions(uploadedLevels);
+        for(uint32_t level = 0; level < uploadedLevels; level++)
+        {
+            VkBufferImageCopy& region = regions[level];
+            region.bufferOffset = staging.offset + getMipChainSize(width, height, level);
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {static_cast<uint32_t>(std::max(width >> level, 1)), static_cast<uint32_t>(std::max(height >> level, 1)), 1};
+        }
+
+        vkCmdCopyBufferToImage(uploadBatch.getCommandBuffer(), staging.buffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, uploadedLevels, regions.data());
 
-        lveDevice.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        lveDevice.copyBufferToImage(stagingBuffer.getBuffer(), textureImage, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1);
-        lveDevice.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        // uploaded levels that are not a blit source are final already
+        const uint32_t finalLevels = uploadedLevels < mipLevels ? uploadedLevels - 1 : uploadedLevels;
+        if(finalLevels > 0)
+        {
+            uploadBatch.releaseImage(
+                textureImage,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                0, finalLevels,
+                VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        }
+
+        if(uploadedLevels < mipLevels)
+        {
+            // transfer queues can not blit, the blit source and the generated levels move to the graphics side
+            uploadBatch.releaseImage(
+                textureImage,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                uploadedLevels - 1, mipLevels - uploadedLevels + 1,
+                VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            recordMipmapBlits(uploadBatch.getGraphicsCommandBuffer(), uploadedLevels);
+        }
+    }
+
+    void LveTexture::recordMipmapBlits(VkCommandBuffer commandBuffer, uint32_t firstGeneratedLevel)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = textureImage;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        // each level is written (copy or blit), turned into the source of the next one, then made shader readable
+        for(uint32_t level = firstGeneratedLevel; level < mipLevels; level++)
+        {
+            barrier.subresourceRange.baseMipLevel = level - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier
+            );
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {std::max(width >> (level - 1), 1), std::max(height >> (level - 1), 1), 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {std::max(width >> level, 1), std::max(height >> level, 1), 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(
+                commandBuffer,
+                textureImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit,
+                VK_FILTER_LINEAR);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier
+            );
+        }
+
+        // the last level was only ever written
+        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
     }
 
     void LveTexture::createTextureImageView()
@@ -99,10 +382,10 @@ namespace Vk
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = textureImage;
         viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+        viewInfo.format = FORMAT;
         viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.levelCount = mipLevels;
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = 1;
 
@@ -130,7 +413,7 @@ namespace Vk
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = 0.0f;
+        samplerInfo.maxLod = static_cast<float>(mipLevels);
 
         if (vkCreateSampler(lveDevice.device(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
         {
@@ -154,6 +437,18 @@ namespace Vk
     {
         Builder builder;
         builder.loadTextureFromFile(filePath);
+        // the gpu blits the chain when it can, otherwise it is filtered here
+        if(supportsBlitMipmaps(device) == false)
+        {
+            builder.generateMipmaps();
+        }
+        return std::make_unique<LveTexture>(device, builder);
+    }
+
+    std::unique_ptr<LveTexture> LveTexture::createSolidColorTexture(LveDevice& device, const uint8_t rgba[4])
+    {
+        Builder builder;
+        builder.setExternalData(1, 1, 1, rgba);
         return std::make_unique<LveTexture>(device, builder);
     }
 
@@ -5,49 +5,91 @@
 // std
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace Vk
 {
+    class LveUploadBatch;
+    struct StagingRange;
+
     class LveTexture
     {
     public:
+        static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
 
+        // rgba8 pixels, every mip level tightly packed after the previous one, mip 0 first
         struct Builder
         {
-            int width;
-            int height;
-            int channels;
-            void* data = nullptr;
+            int width = 0;
+            int height = 0;
+            int channels = 0;
+            uint32_t mipLevels = 1;         // levels present in data, the rest are generated on upload
+            const void* data = nullptr;
 
-            void loadTextureFromFile(const std::string& path);
+            Builder() = default;
             ~Builder();
+            Builder(const Builder&) = delete;
+            Builder& operator=(const Builder&) = delete;
+
+            // decodes mip 0 only
+            void loadTextureFromFile(const std::string& path);
+            // points at levels owned by the caller (e.g. a cooked cache mapping) that outlive the builder
+            void setExternalData(int width, int height, uint32_t mipLevels, const void* data);
+            // cpu box filter down to 1x1, averages in linear space since the data is srgb
+            void generateMipmaps();
+
+            VkDeviceSize getLevelOffset(uint32_t level) const;
+            VkDeviceSize getDataSize() const { return getLevelOffset(mipLevels); }
+
+        private:
+            void releaseData();
+
+            void* stbiData = nullptr;
+            std::vector<uint8_t> mipChain;
         };
 
         LveTexture(LveDevice& device, const Builder& builder);
+        // creates the image, view and sampler only, the caller records the upload with recordUpload()
+        LveTexture(LveDevice& device, int width, int height, uint32_t mipLevels);
         ~LveTexture();
 
         LveTexture(const LveTexture&) = delete;
         LveTexture& operator=(const LveTexture&) = delete;
 
         static std::unique_ptr<LveTexture> createTextureFromFile(LveDevice& device, const std::string& filePath);
+        // 1x1 texture, rgba is in memory order r, g, b, a
+        static std::unique_ptr<LveTexture> createSolidColorTexture(LveDevice& device, const uint8_t rgba[4]);
         VkDescriptorImageInfo getDescriptorImageInfo();
 
+        // full chain down to 1x1
+        static uint32_t getMipLevelCount(int width, int height);
+        // the gpu blit chain needs linear filtering and blit src / dst support for FORMAT
+        static bool supportsBlitMipmaps(LveDevice& device);
+
+        uint32_t getMipLevels() const { return mipLevels; }
+        // records the copy of the first uploadedLevels levels (packed like Builder data) from staging, blits the
+        // remaining levels on the graphics side and leaves the whole image graphics owned in SHADER_READ_ONLY
+        void recordUpload(LveUploadBatch& uploadBatch, const StagingRange& staging, uint32_t uploadedLevels);
+
     private:
         // create 2d rgba texture by default
-        void createTexture(void* data);
+        void createTexture(const Builder& builder);
+        void createImage();
         void createTextureImageView();
         void createTextureSampler();
+        void recordMipmapBlits(VkCommandBuffer commandBuffer, uint32_t firstGeneratedLevel);
 
         LveDevice& lveDevice;
 
         int width;
         int height;
         int channels;
+        uint32_t mipLevels;
         VkImage textureImage;
-        VkDeviceMemory textureImageMemory;
+        Allocation textureImageAllocation;
 
         VkImageView textureImageView;
 
         VkSampler textureSampler;
     };
-}
\ No newline at end of file
+}
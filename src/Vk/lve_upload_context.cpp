@@ -0,0 +1,541 @@
+#include "lve_upload_context.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+
+namespace Vk
+{
+    LveUploadContext::LveUploadContext(LveDevice& device): lveDevice{device}
+    {
+        const QueueFamilyIndices indices = lveDevice.findPhysicalQueueFamilies();
+        graphicsFamily = indices.graphicsFamily;
+        transferFamily = indices.transferFamily;
+    }
+
+    LveUploadContext::~LveUploadContext()
+    {
+        waitIdle();
+
+        assert(retiredWithWaiters.empty() && "upload context destroyed while a thread waits on it");
+        for(auto& submission : freeSubmissions)
+        {
+            destroySubmission(*submission);
+        }
+    }
+
+    bool LveUploadContext::isComplete(UploadTicket ticket)
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        collectLocked();
+        return ticket <= completedTicket;
+    }
+
+    void LveUploadContext::wait(UploadTicket ticket)
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        assert(ticket < nextTicket && "waiting on a ticket that was never submitted");
+
+        // batches without graphics side work finish on the transfer queue and may overtake older ones,
+        // waiting front to back keeps "ticket <= completedTicket" exact
+        while(true)
+        {
+            collectLocked();
+            if(ticket <= completedTicket)
+            {
+                return;
+            }
+
+            // other threads keep submitting / collecting while this one blocks
+            Submission* submission = inFlight.front().get();
+            submission->waiters++;
+            VkFence fence = submission->fence;
+            lock.unlock();
+            vkWaitForFences(lveDevice.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+            lock.lock();
+            submission->waiters--;
+        }
+    }
+
+    void LveUploadContext::waitIdle()
+    {
+        UploadTicket lastTicket;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            lastTicket = nextTicket - 1;
+        }
+        wait(lastTicket);
+    }
+
+    void LveUploadContext::collect()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        collectLocked();
+    }
+
+    std::unique_ptr<LveUploadContext::Submission> LveUploadContext::acquireSubmission()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            collectLocked();
+            if(freeSubmissions.empty() == false)
+            {
+                auto submission = std::move(freeSubmissions.back());
+                freeSubmissions.pop_back();
+                return submission;
+            }
+        }
+
+        // one pool per slot, so recording threads never share a pool
+        auto submission = std::make_unique<Submission>();
+        submission->commandPool = createCommandPool(transferFamily, submission->commandBuffer);
+
+        if(hasDedicatedTransferQueue())
+        {
+            submission->graphicsCommandPool = createCommandPool(graphicsFamily, submission->graphicsCommandBuffer);
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if(vkCreateSemaphore(lveDevice.device(), &semaphoreInfo, nullptr, &submission->transferComplete) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create upload semaphore!");
+            }
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if(vkCreateFence(lveDevice.device(), &fenceInfo, nullptr, &submission->fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create upload fence!");
+        }
+
+        return submission;
+    }
+
+    VkCommandPool LveUploadContext::createCommandPool(uint32_t queueFamily, VkCommandBuffer& commandBuffer)
+    {
+        VkCommandPool commandPool;
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = queueFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        if(vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create upload command pool!");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+        if(vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+        return commandPool;
+    }
+
+    std::unique_ptr<LveBuffer> LveUploadContext::acquireStagingBuffer(VkDeviceSize minSize)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            auto it = std::find_if(freeStagingBuffers.begin(), freeStagingBuffers.end(),
+                [minSize](const auto& buffer){ return buffer->getBufferSize() >= minSize; });
+            if(it != freeStagingBuffers.end())
+            {
+                auto buffer = std::move(*it);
+                freeStagingBuffers.erase(it);
+                freeStagingSize -= buffer->getBufferSize();
+                return buffer;
+            }
+        }
+
+        auto buffer = std::make_unique<LveBuffer>(
+            lveDevice,
+            std::max(minSize, STAGING_CHUNK_SIZE),
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            1,
+            AllocationStrategy::Linear);
+        buffer->map();
+        return buffer;
+    }
+
+    UploadTicket LveUploadContext::submit(std::unique_ptr<Submission> submission)
+    {
+        const bool graphicsSide = submission->graphicsRecorded;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &submission->commandBuffer;
+        if(graphicsSide)
+        {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &submission->transferComplete;
+        }
+
+        // taking the queue locks under the context lock keeps tickets in queue order
+        std::lock_guard<std::mutex> lock{mutex};
+        {
+            std::lock_guard<std::mutex> queueLock{lveDevice.transferQueueMutex()};
+            if(vkQueueSubmit(lveDevice.transferQueue(), 1, &submitInfo, graphicsSide ? VK_NULL_HANDLE : submission->fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to submit upload batch!");
+            }
+        }
+
+        if(graphicsSide)
+        {
+            const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            VkSubmitInfo graphicsSubmitInfo{};
+            graphicsSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            graphicsSubmitInfo.waitSemaphoreCount = 1;
+            graphicsSubmitInfo.pWaitSemaphores = &submission->transferComplete;
+            graphicsSubmitInfo.pWaitDstStageMask = &waitStage;
+            graphicsSubmitInfo.commandBufferCount = 1;
+            graphicsSubmitInfo.pCommandBuffers = &submission->graphicsCommandBuffer;
+
+            std::lock_guard<std::mutex> queueLock{lveDevice.queueMutex()};
+            if(vkQueueSubmit(lveDevice.graphicsQueue(), 1, &graphicsSubmitInfo, submission->fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to submit upload batch!");
+            }
+        }
+
+        submission->ticket = nextTicket++;
+        const UploadTicket ticket = submission->ticket;
+        inFlight.push_back(std::move(submission));
+        return ticket;
+    }
+
+    void LveUploadContext::release(std::unique_ptr<Submission> submission)
+    {
+        // never submitted, the command buffer is reset with the pool
+        std::lock_guard<std::mutex> lock{mutex};
+        recycleLocked(std::move(submission));
+    }
+
+    void LveUploadContext::collectLocked()
+    {
+        // retire in submission order, stop at the first unfinished one
+        while(inFlight.empty() == false && vkGetFenceStatus(lveDevice.device(), inFlight.front()->fence) == VK_SUCCESS)
+        {
+            auto submission = std::move(inFlight.front());
+            inFlight.pop_front();
+            completedTicket = submission->ticket;
+
+            if(submission->waiters > 0)
+            {
+                retiredWithWaiters.push_back(std::move(submission));
+            }
+            else
+            {
+                recycleLocked(std::move(submission));
+            }
+        }
+
+        for(auto it = retiredWithWaiters.begin(); it != retiredWithWaiters.end();)
+        {
+            if((*it)->waiters == 0)
+            {
+                recycleLocked(std::move(*it));
+                it = retiredWithWaiters.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void LveUploadContext::recycleLocked(std::unique_ptr<Submission> submission)
+    {
+        vkResetFences(lveDevice.device(), 1, &submission->fence);
+        vkResetCommandPool(lveDevice.device(), submission->commandPool, 0);
+        if(submission->graphicsCommandPool != VK_NULL_HANDLE)
+        {
+            vkResetCommandPool(lveDevice.device(), submission->graphicsCommandPool, 0);
+        }
+        submission->graphicsRecorded = false;
+        submission->ticket = 0;
+
+        // keep the chunks for the next batches, bounded so one big level load does not pin its staging forever
+        for(auto& buffer : submission->stagingBuffers)
+        {
+            if(freeStagingSize + buffer->getBufferSize() <= MAX_IDLE_STAGING_SIZE)
+            {
+                freeStagingSize += buffer->getBufferSize();
+                freeStagingBuffers.push_back(std::move(buffer));
+            }
+        }
+        submission->stagingBuffers.clear();
+
+        freeSubmissions.push_back(std::move(submission));
+    }
+
+    void LveUploadContext::destroySubmission(Submission& submission)
+    {
+        vkDestroyFence(lveDevice.device(), submission.fence, nullptr);
+        vkDestroyCommandPool(lveDevice.device(), submission.commandPool, nullptr);
+        if(submission.graphicsCommandPool != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(lveDevice.device(), submission.transferComplete, nullptr);
+            vkDestroyCommandPool(lveDevice.device(), submission.graphicsCommandPool, nullptr);
+        }
+    }
+
+    LveUploadBatch::LveUploadBatch(LveUploadContext& context):
+        context{context},
+        submission{context.acquireSubmission()}
+    {
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(submission->commandBuffer, &beginInfo);
+        if(submission->graphicsCommandBuffer != VK_NULL_HANDLE)
+        {
+            vkBeginCommandBuffer(submission->graphicsCommandBuffer, &beginInfo);
+        }
+    }
+
+    LveUploadBatch::~LveUploadBatch()
+    {
+        if(submission)
+        {
+            // only reached while an exception unwinds past the batch, throwing here would terminate
+            assert(std::uncaught_exceptions() > 0 && "upload batch destroyed without submit()");
+            try
+            {
+                submitAndWait();
+            }
+            catch(const std::exception& e)
+            {
+                printf("upload batch not submitted: %s\n", e.what());
+            }
+        }
+    }
+
+    VkCommandBuffer LveUploadBatch::getGraphicsCommandBuffer()
+    {
+        assert(submission && "batch already submitted");
+        if(context.hasDedicatedTransferQueue() == false)
+        {
+            return getCommandBuffer();
+        }
+
+        empty = false;
+        submission->graphicsRecorded = true;
+        return submission->graphicsCommandBuffer;
+    }
+
+    StagingRange LveUploadBatch::stage(const void* data, VkDeviceSize size, VkDeviceSize alignment)
+    {
+        assert(submission && "batch already submitted");
+
+        VkDeviceSize offset = (stagingOffset + alignment - 1) / alignment * alignment;
+        if(stagingBuffer == nullptr || offset + size > stagingBuffer->getBufferSize())
+        {
+            submission->stagingBuffers.push_back(context.acquireStagingBuffer(size));
+            stagingBuffer = submission->stagingBuffers.back().get();
+            offset = 0;
+        }
+        stagingOffset = offset + size;
+
+        StagingRange range{
+            stagingBuffer->getBuffer(),
+            offset,
+            static_cast<uint8_t*>(stagingBuffer->getMappedMemory()) + offset
+        };
+        if(data != nullptr)
+        {
+            memcpy(range.mapped, data, size);
+        }
+        return range;
+    }
+
+    void LveUploadBatch::copyToBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+    {
+        copyStagingToBuffer(stage(data, size), size, dstBuffer, dstOffset);
+    }
+
+    void LveUploadBatch::copyStagingToBuffer(const StagingRange& range, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+    {
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = range.offset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(getCommandBuffer(), range.buffer, dstBuffer, 1, &copyRegion);
+    }
+
+    void LveUploadBatch::copyBufferToImage(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount)
+    {
+        VkBufferImageCopy region{};
+        region.bufferOffset = bufferOffset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = layerCount;
+
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {width, height, 1};
+
+        vkCmdCopyBufferToImage(getCommandBuffer(), buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+
+    void LveUploadBatch::transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+    {
+        if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+            // the fragment shader stage only exists on the graphics side
+            releaseImage(image, oldLayout, newLayout, 0, mipLevels, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+            return;
+        }
+        if (oldLayout != VK_IMAGE_LAYOUT_UNDEFINED || newLayout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+            throw std::invalid_argument("unsupported layout transition!");
+        }
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            getCommandBuffer(),
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
+    }
+
+    void LveUploadBatch::releaseBuffer(VkBuffer buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+    {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccessMask;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+
+        if(context.hasDedicatedTransferQueue() == false)
+        {
+            vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+            return;
+        }
+
+        // identical barriers on both queues, the release ignores the dst half and the acquire the src half
+        barrier.srcQueueFamilyIndex = context.transferFamily;
+        barrier.dstQueueFamilyIndex = context.graphicsFamily;
+
+        VkBufferMemoryBarrier release = barrier;
+        release.dstAccessMask = 0;
+        vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &release, 0, nullptr);
+
+        VkBufferMemoryBarrier acquire = barrier;
+        acquire.srcAccessMask = 0;
+        vkCmdPipelineBarrier(getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0, 0, nullptr, 1, &acquire, 0, nullptr);
+    }
+
+    void LveUploadBatch::releaseSharedBufferRange(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+    {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccessMask;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = buffer;
+        barrier.offset = offset;
+        barrier.size = size;
+
+        // with a dedicated transfer queue the graphics side waits for the transfer semaphore first, the barrier
+        // then goes there (the transfer cmd buffer itself otherwise)
+        vkCmdPipelineBarrier(getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+    void LveUploadBatch::releaseImage(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount,
+        VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = dstAccessMask;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = baseMipLevel;
+        barrier.subresourceRange.levelCount = levelCount;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        if(context.hasDedicatedTransferQueue() == false)
+        {
+            vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            return;
+        }
+
+        // the layout transition happens once, between the release and the acquire
+        barrier.srcQueueFamilyIndex = context.transferFamily;
+        barrier.dstQueueFamilyIndex = context.graphicsFamily;
+
+        VkImageMemoryBarrier release = barrier;
+        release.dstAccessMask = 0;
+        vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &release);
+
+        VkImageMemoryBarrier acquire = barrier;
+        acquire.srcAccessMask = 0;
+        vkCmdPipelineBarrier(getGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &acquire);
+    }
+
+    UploadTicket LveUploadBatch::submit()
+    {
+        assert(submission && "batch already submitted");
+
+        vkEndCommandBuffer(submission->commandBuffer);
+        if(submission->graphicsCommandBuffer != VK_NULL_HANDLE)
+        {
+            vkEndCommandBuffer(submission->graphicsCommandBuffer);
+        }
+        stagingBuffer = nullptr;
+        stagingOffset = 0;
+
+        // nothing recorded, nothing to wait for
+        if(empty)
+        {
+            context.release(std::move(submission));
+            return 0;
+        }
+        return context.submit(std::move(submission));
+    }
+
+    void LveUploadBatch::submitAndWait()
+    {
+        context.wait(submit());
+    }
+}
@@ -0,0 +1,147 @@
+/*************************************************
+Upload Context Class:
+1. hands out recording slots (command pool + command buffer + fence) and staging chunks, thread safe
+2. LveUploadBatch: records many copies / layout transitions into one command buffer, stages data into
+   shared staging chunks and submits once with a fence, no vkQueueWaitIdle
+3. finished submissions are retired in order, their slots and staging chunks are recycled
+4. runs on the dedicated transfer queue when the device has one: the batch records a second, graphics side
+   command buffer that waits on a semaphore and acquires the resources the transfer side released,
+   without a dedicated family both sides are the same graphics command buffer
+
+A batch belongs to the thread that records it, any number of threads may record their own batches.
+A ticket completes once the graphics side finished, resources are owned by the graphics family then.
+*************************************************/
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Vk
+{
+    // increases with every submission, tickets up to the last retired one are complete
+    using UploadTicket = uint64_t;
+
+    struct StagingRange
+    {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        void* mapped;           // already offset
+    };
+
+    class LveUploadContext
+    {
+    public:
+        static constexpr VkDeviceSize STAGING_CHUNK_SIZE = 16 * 1024 * 1024;      // bigger requests get a chunk of their own
+        static constexpr VkDeviceSize MAX_IDLE_STAGING_SIZE = 64 * 1024 * 1024;   // recycled chunks beyond this are freed
+
+        LveUploadContext(LveDevice& device);
+        ~LveUploadContext();
+
+        LveUploadContext(const LveUploadContext&) = delete;
+        LveUploadContext& operator=(const LveUploadContext&) = delete;
+
+        bool isComplete(UploadTicket ticket);
+        void wait(UploadTicket ticket);
+        void waitIdle();
+        // retires finished submissions, every other call does this too
+        void collect();
+
+        bool hasDedicatedTransferQueue() const { return transferFamily != graphicsFamily; }
+
+    private:
+        friend class LveUploadBatch;
+
+        struct Submission
+        {
+            VkCommandPool commandPool = VK_NULL_HANDLE;              // transfer family
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            // dedicated transfer queue only: acquire barriers and graphics only commands (blits)
+            VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+            VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+            VkSemaphore transferComplete = VK_NULL_HANDLE;
+            bool graphicsRecorded = false;
+            VkFence fence = VK_NULL_HANDLE;                          // signaled by the last submit of the batch
+            std::vector<std::unique_ptr<LveBuffer>> stagingBuffers;
+            UploadTicket ticket = 0;
+            uint32_t waiters = 0;       // threads blocked on the fence outside the lock, recycling waits for them
+        };
+
+        std::unique_ptr<Submission> acquireSubmission();
+        VkCommandPool createCommandPool(uint32_t queueFamily, VkCommandBuffer& commandBuffer);
+        std::unique_ptr<LveBuffer> acquireStagingBuffer(VkDeviceSize minSize);
+        UploadTicket submit(std::unique_ptr<Submission> submission);
+        void release(std::unique_ptr<Submission> submission);
+
+        void collectLocked();
+        void recycleLocked(std::unique_ptr<Submission> submission);
+        void destroySubmission(Submission& submission);
+
+        LveDevice& lveDevice;
+        uint32_t graphicsFamily;
+        uint32_t transferFamily;
+
+        std::mutex mutex;
+        std::deque<std::unique_ptr<Submission>> inFlight;            // submission order
+        std::vector<std::unique_ptr<Submission>> retiredWithWaiters;
+        std::vector<std::unique_ptr<Submission>> freeSubmissions;
+        std::vector<std::unique_ptr<LveBuffer>> freeStagingBuffers;
+        VkDeviceSize freeStagingSize = 0;
+        UploadTicket nextTicket = 1;
+        UploadTicket completedTicket = 0;
+    };
+
+    class LveUploadBatch
+    {
+    public:
+        explicit LveUploadBatch(LveUploadContext& context);
+        // call submit() or submitAndWait() on the success path, a batch an exception unwinds past is
+        // submitted and waited for here, errors are only logged
+        ~LveUploadBatch();
+
+        LveUploadBatch(const LveUploadBatch&) = delete;
+        LveUploadBatch& operator=(const LveUploadBatch&) = delete;
+
+        // for recording custom copy commands (transfer queue), the batch counts as non empty afterwards
+        VkCommandBuffer getCommandBuffer() { empty = false; return submission->commandBuffer; }
+        // executes after getCommandBuffer() on the graphics queue, for commands a transfer queue can not run
+        // (blits, shader stage barriers), resources written on the transfer side have to be released first
+        VkCommandBuffer getGraphicsCommandBuffer();
+
+        // copies size bytes into staging memory that lives until the batch completed
+        StagingRange stage(const void* data, VkDeviceSize size, VkDeviceSize alignment = 16);
+        void copyToBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+        // for data written into a stage(nullptr, size) range by the caller
+        void copyStagingToBuffer(const StagingRange& range, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+        void copyBufferToImage(VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
+        // UNDEFINED -> TRANSFER_DST on the transfer side, TRANSFER_DST -> SHADER_READ_ONLY releases to the graphics side
+        void transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
+
+        // hands a resource written by the transfer side to the graphics family (release + acquire barrier pair),
+        // a plain barrier when both sides share the family. dst masks describe the first graphics side use
+        void releaseBuffer(VkBuffer buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+        // for buffers created sharedWithTransfer that the graphics side keeps using while a range is written: no ownership
+        // transfer, only the written range is made visible to its first graphics side use
+        void releaseSharedBufferRange(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+        void releaseImage(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseMipLevel, uint32_t levelCount,
+            VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+
+        // non blocking, the batch can not be recorded into afterwards
+        UploadTicket submit();
+        void submitAndWait();
+
+    private:
+        LveUploadContext& context;
+        std::unique_ptr<LveUploadContext::Submission> submission;
+
+        LveBuffer* stagingBuffer = nullptr;     // current chunk, owned by submission
+        VkDeviceSize stagingOffset = 0;
+        bool empty = true;
+    };
+}
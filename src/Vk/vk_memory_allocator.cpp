@@ -0,0 +1,388 @@
+#include "vk_memory_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+
+namespace Vk {
+
+    // a block is never bigger than this, smaller heaps get heapSize / 8
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    struct MemoryBlock {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        void* mapped = nullptr;
+        AllocationStrategy strategy = AllocationStrategy::FreeList;
+
+        // FreeList
+        RangeAllocator ranges;
+
+        // Linear
+        VkDeviceSize linearOffset = 0;
+        ResourceKind lastKind = ResourceKind::Linear;
+        uint32_t linearAllocationCount = 0;
+
+        uint32_t allocationCount() const
+        {
+            return strategy == AllocationStrategy::Linear ? linearAllocationCount : ranges.getAllocationCount();
+        }
+    };
+
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    static VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return alignment > 1 ? value / alignment * alignment : value;
+    }
+
+    MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice): device(device)
+    {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        bufferImageGranularity = properties.limits.bufferImageGranularity;
+        nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+        maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+    }
+
+    MemoryAllocator::~MemoryAllocator()
+    {
+        for (auto& block : blocks)
+        {
+            if (block->allocationCount() > 0)
+            {
+                fprintf(stderr, "memory allocator: block of type %u destroyed with %u live allocations\n",
+                    block->memoryTypeIndex, block->allocationCount());
+            }
+            if (block->mapped)
+            {
+                vkUnmapMemory(device, block->memory);
+            }
+            vkFreeMemory(device, block->memory, nullptr);
+        }
+        blocks.clear();
+    }
+
+    uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+    {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        {
+            if ((typeFilter & (1 << i)) &&
+                (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryTypeIndex) const
+    {
+        const uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+        const VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+        return std::min(DEFAULT_BLOCK_SIZE, alignUp(heapSize / 8, 1024 * 1024));
+    }
+
+    MemoryBlock* MemoryAllocator::createBlock(uint32_t memoryTypeIndex, AllocationStrategy strategy)
+    {
+        auto block = std::make_unique<MemoryBlock>();
+        block->size = getBlockSize(memoryTypeIndex);
+        block->memoryTypeIndex = memoryTypeIndex;
+        block->strategy = strategy;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block->size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate memory block!");
+        }
+
+        if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            // keep host visible blocks mapped for their whole life, buffers sharing a block can't map it individually
+            if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to map memory block!");
+            }
+        }
+
+        if (strategy == AllocationStrategy::FreeList)
+        {
+            block->ranges.reset(block->size);
+        }
+
+        blocks.push_back(std::move(block));
+        return blocks.back().get();
+    }
+
+    void MemoryAllocator::destroyBlock(MemoryBlock* block)
+    {
+        auto it = std::find_if(blocks.begin(), blocks.end(), [block](const auto& b) { return b.get() == block; });
+        assert(it != blocks.end());
+
+        if (block->mapped)
+        {
+            vkUnmapMemory(device, block->memory);
+        }
+        vkFreeMemory(device, block->memory, nullptr);
+        blocks.erase(it);
+    }
+
+    bool MemoryAllocator::allocateFromBlock(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, ResourceKind kind, Allocation& allocation)
+    {
+        VkDeviceSize offset = 0;
+        if (block.strategy == AllocationStrategy::Linear)
+        {
+            offset = alignUp(block.linearOffset, alignment);
+            if (block.linearAllocationCount > 0 && block.lastKind != kind &&
+                (block.linearOffset - 1) / bufferImageGranularity == offset / bufferImageGranularity)
+            {
+                offset = alignUp(offset, bufferImageGranularity);
+            }
+            if (offset + size > block.size)
+            {
+                return false;
+            }
+            block.linearOffset = offset + size;
+            block.lastKind = kind;
+            block.linearAllocationCount++;
+        }
+        else
+        {
+            auto result = block.ranges.allocate(size, alignment, static_cast<uint8_t>(kind), bufferImageGranularity);
+            if (!result)
+            {
+                return false;
+            }
+            offset = *result;
+        }
+
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        allocation.memoryTypeIndex = block.memoryTypeIndex;
+        allocation.block = &block;
+        return true;
+    }
+
+    Allocation MemoryAllocator::allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex)
+    {
+        Allocation allocation{};
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate dedicated memory!");
+        }
+
+        if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            if (vkMapMemory(device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to map dedicated memory!");
+            }
+        }
+
+        allocation.offset = 0;
+        allocation.size = size;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.block = nullptr;
+
+        dedicatedAllocationCount++;
+        dedicatedBytes += size;
+        return allocation;
+    }
+
+    Allocation MemoryAllocator::allocate(
+        const VkMemoryRequirements& requirements,
+        VkMemoryPropertyFlags properties,
+        ResourceKind kind,
+        AllocationStrategy strategy)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+        const VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+        // big resources get their own memory, they would only fragment the blocks
+        const VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+        if (requirements.size > blockSize / 2)
+        {
+            return allocateDedicated(requirements.size, memoryTypeIndex);
+        }
+
+        VkDeviceSize alignment = requirements.alignment;
+        if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        {
+            // flushing one allocation must never touch its neighbours' atoms
+            alignment = std::max(alignment, nonCoherentAtomSize);
+        }
+
+        Allocation allocation{};
+        for (auto& block : blocks)
+        {
+            if (block->memoryTypeIndex == memoryTypeIndex && block->strategy == strategy &&
+                allocateFromBlock(*block, requirements.size, alignment, kind, allocation))
+            {
+                return allocation;
+            }
+        }
+
+        if (blocks.size() + dedicatedAllocationCount >= maxMemoryAllocationCount)
+        {
+            throw std::runtime_error("maxMemoryAllocationCount reached!");
+        }
+
+        MemoryBlock* block = createBlock(memoryTypeIndex, strategy);
+        if (!allocateFromBlock(*block, requirements.size, alignment, kind, allocation))
+        {
+            throw std::runtime_error("failed to sub allocate from a new memory block!");
+        }
+        return allocation;
+    }
+
+    void MemoryAllocator::free(Allocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (allocation.block == nullptr)
+        {
+            if (allocation.mapped)
+            {
+                vkUnmapMemory(device, allocation.memory);
+            }
+            vkFreeMemory(device, allocation.memory, nullptr);
+            dedicatedAllocationCount--;
+            dedicatedBytes -= allocation.size;
+            allocation = Allocation{};
+            return;
+        }
+
+        MemoryBlock* block = allocation.block;
+        if (block->strategy == AllocationStrategy::Linear)
+        {
+            assert(block->linearAllocationCount > 0);
+            block->linearAllocationCount--;
+            if (block->linearAllocationCount == 0)
+            {
+                block->linearOffset = 0;
+            }
+        }
+        else
+        {
+            block->ranges.free(allocation.offset);
+        }
+
+        // give empty blocks back to the driver, but keep one per memory type / strategy around to avoid churn
+        if (block->allocationCount() == 0)
+        {
+            const bool hasSibling = std::any_of(blocks.begin(), blocks.end(), [block](const auto& b) {
+                return b.get() != block && b->memoryTypeIndex == block->memoryTypeIndex && b->strategy == block->strategy;
+            });
+            if (hasSibling)
+            {
+                destroyBlock(block);
+            }
+        }
+
+        allocation = Allocation{};
+    }
+
+    VkMappedMemoryRange MemoryAllocator::getMappedRange(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset) const
+    {
+        const VkDeviceSize memorySize = allocation.block ? allocation.block->size : allocation.size;
+        const VkDeviceSize begin = allocation.offset + offset;
+        const VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+
+        VkMappedMemoryRange mappedRange{};
+        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mappedRange.memory = allocation.memory;
+        mappedRange.offset = alignDown(begin, nonCoherentAtomSize);
+        mappedRange.size = std::min(alignUp(end, nonCoherentAtomSize), memorySize) - mappedRange.offset;
+        return mappedRange;
+    }
+
+    VkResult MemoryAllocator::flush(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+    {
+        VkMappedMemoryRange mappedRange = getMappedRange(allocation, size, offset);
+        return vkFlushMappedMemoryRanges(device, 1, &mappedRange);
+    }
+
+    VkResult MemoryAllocator::invalidate(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+    {
+        VkMappedMemoryRange mappedRange = getMappedRange(allocation, size, offset);
+        return vkInvalidateMappedMemoryRanges(device, 1, &mappedRange);
+    }
+
+    MemoryStats MemoryAllocator::getStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        MemoryStats stats{};
+        VkDeviceSize totalFree = 0;
+        for (auto& block : blocks)
+        {
+            stats.blockCount++;
+            stats.blockBytes += block->size;
+            stats.allocationCount += block->allocationCount();
+
+            if (block->strategy == AllocationStrategy::Linear)
+            {
+                // a linear block only reuses its tail until it is empty again
+                const VkDeviceSize tail = block->size - block->linearOffset;
+                stats.usedBytes += block->linearOffset;
+                stats.freeRangeCount += tail > 0 ? 1 : 0;
+                stats.largestFreeRange = std::max(stats.largestFreeRange, tail);
+                totalFree += tail;
+            }
+            else
+            {
+                stats.usedBytes += block->ranges.getUsedSize();
+                stats.freeRangeCount += block->ranges.getFreeRangeCount();
+                stats.largestFreeRange = std::max(stats.largestFreeRange, static_cast<VkDeviceSize>(block->ranges.getLargestFreeRange()));
+                totalFree += block->size - block->ranges.getUsedSize();
+            }
+        }
+
+        stats.dedicatedAllocationCount = dedicatedAllocationCount;
+        stats.dedicatedBytes = dedicatedBytes;
+        stats.allocationCount += dedicatedAllocationCount;
+        stats.deviceMemoryCount = stats.blockCount + dedicatedAllocationCount;
+        stats.fragmentation = totalFree > 0 ? 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(totalFree) : 0.0f;
+        return stats;
+    }
+
+    void MemoryAllocator::printStats()
+    {
+        MemoryStats stats = getStats();
+        printf("GPU memory: %u allocations in %u vkDeviceMemory (%u blocks, %u dedicated)\n",
+            stats.allocationCount, stats.deviceMemoryCount, stats.blockCount, stats.dedicatedAllocationCount);
+        printf("    blocks %.2f MiB, used %.2f MiB, dedicated %.2f MiB\n",
+            stats.blockBytes / (1024.0 * 1024.0), stats.usedBytes / (1024.0 * 1024.0), stats.dedicatedBytes / (1024.0 * 1024.0));
+        printf("    free ranges %u, largest %.2f KiB, fragmentation %.1f%%\n",
+            stats.freeRangeCount, stats.largestFreeRange / 1024.0, stats.fragmentation * 100.0f);
+    }
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "vk_range_allocator.hpp"
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Vk {
+
+    enum class AllocationStrategy {
+        FreeList,   // long lived resources, best-fit with coalescing
+        Linear,     // short lived resources (staging), bump pointer that rewinds once the block is empty
+    };
+
+    enum class ResourceKind : uint8_t {
+        Linear = 1,     // buffers and linear tiled images
+        Optimal = 2,    // optimal tiled images
+    };
+
+    struct MemoryBlock;
+
+    // Allocation: a sub range of a VkDeviceMemory block (or a dedicated VkDeviceMemory when block == nullptr)
+    struct Allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;             // host visible memory is persistently mapped, already offset
+        uint32_t memoryTypeIndex = 0;
+        MemoryBlock* block = nullptr;
+    };
+
+    struct MemoryStats {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedAllocationCount = 0;
+        uint32_t allocationCount = 0;       // sub allocations + dedicated allocations
+        uint32_t deviceMemoryCount = 0;     // live vkAllocateMemory objects
+        VkDeviceSize blockBytes = 0;
+        VkDeviceSize usedBytes = 0;
+        VkDeviceSize dedicatedBytes = 0;
+        uint32_t freeRangeCount = 0;
+        VkDeviceSize largestFreeRange = 0;
+        float fragmentation = 0.0f;         // 1 - largest free range / total free bytes
+    };
+
+    // MemoryAllocator: sub allocates buffers and images from large VkDeviceMemory blocks, one block list per memory type.
+    // Thread safe, LveDevice owns one and every buffer / image creation goes through it.
+    class MemoryAllocator {
+    public:
+        MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator&) = delete;
+        MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+        Allocation allocate(
+            const VkMemoryRequirements& requirements,
+            VkMemoryPropertyFlags properties,
+            ResourceKind kind,
+            AllocationStrategy strategy = AllocationStrategy::FreeList);
+        void free(Allocation& allocation);
+
+        // offset / size are relative to the allocation, VK_WHOLE_SIZE means up to the allocation's end
+        VkResult flush(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset);
+        VkResult invalidate(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset);
+
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+        MemoryStats getStats();
+        void printStats();
+
+    private:
+        MemoryBlock* createBlock(uint32_t memoryTypeIndex, AllocationStrategy strategy);
+        void destroyBlock(MemoryBlock* block);
+        bool allocateFromBlock(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, ResourceKind kind, Allocation& allocation);
+        Allocation allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex);
+        VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+        VkMappedMemoryRange getMappedRange(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+
+        VkDevice device;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkDeviceSize bufferImageGranularity;
+        VkDeviceSize nonCoherentAtomSize;
+        uint32_t maxMemoryAllocationCount;
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        uint32_t dedicatedAllocationCount = 0;
+        VkDeviceSize dedicatedBytes = 0;
+    };
+
+}
@@ -0,0 +1,162 @@
+#include "vk_range_allocator.hpp"
+
+// std
+#include <cassert>
+#include <limits>
+
+namespace Vk {
+
+    static uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    void RangeAllocator::reset(uint64_t newCapacity)
+    {
+        capacity = newCapacity;
+        usedSize = 0;
+        allocationCount = 0;
+        ranges.clear();
+        freeBySize.clear();
+        if (capacity > 0)
+        {
+            ranges[0] = Range{capacity, KIND_FREE};
+            freeBySize.emplace(capacity, 0);
+        }
+    }
+
+    bool RangeAllocator::isKindConflict(uint8_t a, uint8_t b)
+    {
+        return a != KIND_FREE && b != KIND_FREE && a != b;
+    }
+
+    bool RangeAllocator::isOnSamePage(uint64_t endOfFirst, uint64_t startOfSecond, uint64_t granularity)
+    {
+        // endOfFirst is exclusive
+        return granularity > 1 && (endOfFirst - 1) / granularity == startOfSecond / granularity;
+    }
+
+    void RangeAllocator::insertFree(uint64_t offset, uint64_t size)
+    {
+        ranges[offset] = Range{size, KIND_FREE};
+        freeBySize.emplace(size, offset);
+    }
+
+    void RangeAllocator::eraseFree(uint64_t offset, uint64_t size)
+    {
+        auto bySize = freeBySize.equal_range(size);
+        for (auto it = bySize.first; it != bySize.second; ++it)
+        {
+            if (it->second == offset)
+            {
+                freeBySize.erase(it);
+                break;
+            }
+        }
+        ranges.erase(offset);
+    }
+
+    std::optional<uint64_t> RangeAllocator::allocate(uint64_t size, uint64_t alignment, uint8_t kind, uint64_t granularity)
+    {
+        assert(size > 0 && kind != KIND_FREE && "allocation must have a size and a used kind");
+
+        uint64_t bestOffset = 0;
+        uint64_t bestFreeOffset = 0;
+        uint64_t bestFreeSize = std::numeric_limits<uint64_t>::max();
+
+        // best fit: walk free ranges in increasing size, the first one that fits after padding wins
+        for (auto it = freeBySize.lower_bound(size); it != freeBySize.end(); ++it)
+        {
+            const uint64_t freeSize = it->first;
+            const uint64_t freeOffset = it->second;
+
+            auto rangeIt = ranges.find(freeOffset);
+            uint64_t offset = alignUp(freeOffset, alignment);
+
+            // a free range is always surrounded by used ranges (or the block ends), check both neighbours
+            if (rangeIt != ranges.begin())
+            {
+                auto prev = std::prev(rangeIt);
+                if (isKindConflict(prev->second.kind, kind) && isOnSamePage(prev->first + prev->second.size, offset, granularity))
+                {
+                    offset = alignUp(offset, granularity);
+                }
+            }
+
+            const uint64_t end = offset + size;
+            if (end > freeOffset + freeSize)
+            {
+                continue;
+            }
+
+            auto next = std::next(rangeIt);
+            if (next != ranges.end() && isKindConflict(kind, next->second.kind) && isOnSamePage(end, next->first, granularity))
+            {
+                continue;
+            }
+
+            bestOffset = offset;
+            bestFreeOffset = freeOffset;
+            bestFreeSize = freeSize;
+            break;
+        }
+
+        if (bestFreeSize == std::numeric_limits<uint64_t>::max())
+        {
+            return std::nullopt;
+        }
+
+        // split the chosen free range into [padding][allocation][tail]
+        eraseFree(bestFreeOffset, bestFreeSize);
+        if (bestOffset > bestFreeOffset)
+        {
+            insertFree(bestFreeOffset, bestOffset - bestFreeOffset);
+        }
+        ranges[bestOffset] = Range{size, kind};
+        const uint64_t end = bestOffset + size;
+        const uint64_t freeEnd = bestFreeOffset + bestFreeSize;
+        if (freeEnd > end)
+        {
+            insertFree(end, freeEnd - end);
+        }
+
+        usedSize += size;
+        allocationCount++;
+        return bestOffset;
+    }
+
+    void RangeAllocator::free(uint64_t offset)
+    {
+        auto it = ranges.find(offset);
+        assert(it != ranges.end() && it->second.kind != KIND_FREE && "freeing a range that was never allocated");
+
+        uint64_t freeOffset = it->first;
+        uint64_t freeSize = it->second.size;
+        usedSize -= freeSize;
+        allocationCount--;
+
+        // coalesce with free neighbours
+        auto next = std::next(it);
+        if (next != ranges.end() && next->second.kind == KIND_FREE)
+        {
+            freeSize += next->second.size;
+            eraseFree(next->first, next->second.size);
+        }
+        if (it != ranges.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->second.kind == KIND_FREE)
+            {
+                freeOffset = prev->first;
+                freeSize += prev->second.size;
+                ranges.erase(offset);
+                eraseFree(prev->first, prev->second.size);
+                insertFree(freeOffset, freeSize);
+                return;
+            }
+        }
+        ranges.erase(offset);
+        insertFree(freeOffset, freeSize);
+    }
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace Vk {
+
+    // RangeAllocator: best-fit free-list over an abstract range [0, capacity). Adjacent free ranges are coalesced.
+    // Every used range carries a small "kind" tag. Two neighbouring used ranges of different kinds never share a
+    // granularity page (used for bufferImageGranularity: linear vs. optimal resources).
+    class RangeAllocator {
+    public:
+        static constexpr uint8_t KIND_FREE = 0;
+
+        RangeAllocator() = default;
+        explicit RangeAllocator(uint64_t capacity) { reset(capacity); }
+
+        void reset(uint64_t capacity);
+
+        // returns the offset of the new range, or nothing when no free range can hold it
+        std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment, uint8_t kind = 1, uint64_t granularity = 1);
+        void free(uint64_t offset);
+
+        uint64_t getCapacity() const { return capacity; }
+        uint64_t getUsedSize() const { return usedSize; }
+        uint32_t getAllocationCount() const { return allocationCount; }
+        uint32_t getFreeRangeCount() const { return static_cast<uint32_t>(freeBySize.size()); }
+        uint64_t getLargestFreeRange() const { return freeBySize.empty() ? 0 : freeBySize.rbegin()->first; }
+        bool isEmpty() const { return allocationCount == 0; }
+
+    private:
+        struct Range {
+            uint64_t size;
+            uint8_t kind;
+        };
+
+        static bool isKindConflict(uint8_t a, uint8_t b);
+        static bool isOnSamePage(uint64_t endOfFirst, uint64_t startOfSecond, uint64_t granularity);
+
+        void insertFree(uint64_t offset, uint64_t size);
+        void eraseFree(uint64_t offset, uint64_t size);
+
+        uint64_t capacity = 0;
+        uint64_t usedSize = 0;
+        uint32_t allocationCount = 0;
+
+        std::map<uint64_t, Range> ranges;                   // every range, free or used, keyed by offset
+        std::multimap<uint64_t, uint64_t> freeBySize;       // free ranges: size -> offset
+    };
+
+}
@@ -11,22 +11,35 @@
 
 // std
 #include <cassert>
+#include <cstring>
 #include <iostream>
 
 namespace Vk
 {
-    ShaderEffect::ShaderEffect(VkDevice device, DescriptorLayoutCache& layoutCache, const std::string& vertShaderPath, const std::string& fragShaderPath):
-        device(device), layoutCache(layoutCache)
+    ShaderEffect::ShaderEffect(VkDevice device, DescriptorLayoutCache& layoutCache, const std::string& vertShaderPath, const std::string& fragShaderPath, const std::vector<ReflectionOverride>& overrides):
+        device(device), layoutCache(layoutCache), overrides(overrides)
     {
         loadShaderFromFile(vertShaderPath, fragShaderPath);
         createDescriptorSetLayouts();
         createPipelineLayout();
     }
 
+    ShaderEffect::ShaderEffect(VkDevice device, DescriptorLayoutCache& layoutCache, const std::string& compShaderPath, const std::vector<ReflectionOverride>& overrides):
+        device(device), layoutCache(layoutCache), overrides(overrides)
+    {
+        auto compShaderCode = Util::readFile(compShaderPath);
+        compShader = createShaderModule(compShaderCode);
+        getShaderReflection(compShaderCode);
+        createDescriptorSetLayouts();
+        createPipelineLayout();
+    }
+
     ShaderEffect::~ShaderEffect()
     {
+        // modules of stages the effect doesn't have are VK_NULL_HANDLE, destroying those is a no-op
         vkDestroyShaderModule(device, vertShader, nullptr);
         vkDestroyShaderModule(device, fragShader, nullptr);
+        vkDestroyShaderModule(device, compShader, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     }
 
@@ -34,28 +47,28 @@ namespace Vk
     {
         // load vertex shader
         auto vertShaderCode = Util::readFile(vertShaderPath);
-        VkShaderModuleCreateInfo createInfoVert{};
-        createInfoVert.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfoVert.codeSize = vertShaderCode.size();
-        createInfoVert.pCode = reinterpret_cast<const uint32_t*>(vertShaderCode.data());
-        if(vkCreateShaderModule(device, &createInfoVert, nullptr, &vertShader) != VK_SUCCESS)
-        {
-            throw std::runtime_error("faile to create shader module");
-        }
+        vertShader = createShaderModule(vertShaderCode);
         getShaderReflection(vertShaderCode);
 
         // load frag shader
         auto fragShaderCode = Util::readFile(fragShaderPath);
-        VkShaderModuleCreateInfo createInfoFrag{};
-        createInfoFrag.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfoFrag.codeSize = fragShaderCode.size();
-        createInfoFrag.pCode = reinterpret_cast<const uint32_t*>(fragShaderCode.data());
-        if(vkCreateShaderModule(device, &createInfoFrag, nullptr, &fragShader) != VK_SUCCESS)
+        fragShader = createShaderModule(fragShaderCode);
+        getShaderReflection(fragShaderCode);
+
+    }
+
+    VkShaderModule ShaderEffect::createShaderModule(const std::vector<char>& shaderCode)
+    {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = shaderCode.size();
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+        VkShaderModule shaderModule;
+        if(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
         {
             throw std::runtime_error("faile to create shader module");
         }
-        getShaderReflection(fragShaderCode);
-
+        return shaderModule;
     }
 
     void ShaderEffect::getShaderReflection(const std::vector<char>& shaderCode)
@@ -99,6 +112,13 @@ namespace Vk
                 VkDescriptorSetLayoutBinding& out_binding = out_layout.bindings[bindingID];
                 out_binding.binding = bindingID;
                 out_binding.descriptorType = static_cast<VkDescriptorType>(refl_binding.descriptor_type);
+                for(const auto& ov : overrides)
+                {
+                    if(strcmp(refl_binding.name, ov.name) == 0)
+                    {
+                        out_binding.descriptorType = ov.overridenType;
+                    }
+                }
                 out_binding.descriptorCount = 1;
                 for (uint32_t i_dim = 0; i_dim < refl_binding.array.dims_count; ++i_dim) {
                     out_binding.descriptorCount *= refl_binding.array.dims[i_dim];
@@ -113,7 +133,7 @@ namespace Vk
                     assert(
                         descriptorSignature[name].setId == setID &&
                         descriptorSignature[name].bindingId == bindingID &&
-                        descriptorSignature[name].type == static_cast<VkDescriptorType>(refl_binding.descriptor_type) &&
+                        descriptorSignature[name].type == out_binding.descriptorType &&
                         "error in set and binding type");
 
                     descriptorSignature[name].stageFlags |= out_binding.stageFlags;
@@ -123,7 +143,7 @@ namespace Vk
                     SetAndBinding setAndBinding{
                     static_cast<uint32_t>(setID),
                     bindingID,
-                    static_cast<VkDescriptorType>(refl_binding.descriptor_type),
+                    out_binding.descriptorType,
                     out_binding.stageFlags
                     };
                     descriptorSignature[name] = setAndBinding;
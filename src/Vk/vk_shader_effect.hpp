@@ -10,11 +10,25 @@ namespace Vk
     class ShaderEffect
     {
     public:
+        // reflection can't tell whether a buffer is addressed with dynamic offsets, let the system decide per binding name
+        struct ReflectionOverride
+        {
+            const char* name;
+            VkDescriptorType overridenType;
+        };
+
         ShaderEffect(
             VkDevice device, 
             DescriptorLayoutCache& layoutCache, 
             const std::string& vertShaderPath, 
-            const std::string& fragShaderPath);
+            const std::string& fragShaderPath,
+            const std::vector<ReflectionOverride>& overrides = {});
+        // compute only effect, the layout comes from the compute shader alone
+        ShaderEffect(
+            VkDevice device, 
+            DescriptorLayoutCache& layoutCache, 
+            const std::string& compShaderPath,
+            const std::vector<ReflectionOverride>& overrides);
         ~ShaderEffect();
         ShaderEffect(const ShaderEffect&) = delete;
         ShaderEffect& operator=(const ShaderEffect&) = delete;
@@ -32,6 +46,7 @@ namespace Vk
         VkDescriptorSetLayout getSetLayout(int setId) const { return setLayouts[setId]; }
         VkShaderModule getVertShaderModule() const { return vertShader; }
         VkShaderModule getFragShaderModule() const { return fragShader; }
+        VkShaderModule getCompShaderModule() const { return compShader; }
 
         void printDescriptorSignatures() const
         {
@@ -55,15 +70,18 @@ namespace Vk
             VkDescriptorSetLayoutCreateInfo create_info{};
             std::vector<VkDescriptorSetLayoutBinding> bindings;
         };
-        VkShaderModule vertShader;
-        VkShaderModule fragShader;
+        VkShaderModule vertShader = VK_NULL_HANDLE;
+        VkShaderModule fragShader = VK_NULL_HANDLE;
+        VkShaderModule compShader = VK_NULL_HANDLE;
         std::vector<ReflectSetLayoutData> reflectionData; 
 
         VkDevice device;
         DescriptorLayoutCache& layoutCache;
+        std::vector<ReflectionOverride> overrides;
         
         
         void loadShaderFromFile(const std::string& vertShaderPath, const std::string& fragShaderPath);
+        VkShaderModule createShaderModule(const std::vector<char>& shaderCode);
         void getShaderReflection(const std::vector<char>& shaderCode);
         void createDescriptorSetLayouts();
         void createPipelineLayout();
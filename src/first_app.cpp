@@ -2,12 +2,15 @@
 
 #include "Vk/lve_buffer.hpp"
 
+#include "Platform/cpu_profiler.hpp"
+
 #include "EngineCore/camera.hpp"
 #include "EngineCore/keyboard_movement_controller.hpp"
 #include "EngineCore/model.hpp"
 
 #include "EngineSystems/simple_render_system.hpp"
 #include "EngineSystems/point_light_system.hpp"
+#include "EngineSystems/transform_system.hpp"
 
 //libs
 #define GLM_FORCE_RADIANS
@@ -17,10 +20,18 @@
 
 // std
 #include <chrono>
+#include <cstdio>
+#include <filesystem>
 
 
-FirstApp::FirstApp()
+FirstApp::FirstApp(const AppConfig& config): config(config)
 {
+    Platform::CpuProfiler::setThreadName("Main");
+    if(config.tracePath.empty() == false)
+    {
+        // asset loading is part of the trace
+        Platform::CpuProfiler::beginCapture(config.tracePath, config.traceFrames);
+    }
     loadGameObjects();
 }
 
@@ -48,8 +59,11 @@ void FirstApp::run()
         descriptorLayoutCache,
         lveRenderer.getSwapChainRenderPass(),
         textureManager,
-        descriptorAllocator
+        descriptorAllocator,
+        MAX_OBJECTS,
+        config.cpuCulling == false
     };
+    EngineSystem::TransformSystem transformSystem;
     EngineSystem::PointLightSystem pointLightSystem{
         lveDevice, 
         descriptorLayoutCache,
@@ -58,50 +72,93 @@ void FirstApp::run()
     };
 
     simpleRenderSystem.createDescriptorSetPerFrame("ubo", globalUbo->descriptorInfo(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+    simpleRenderSystem.createDescriptorSetPerFrame("clusterLightSsbo", frameRing.descriptorInfo(frameRing.getFrameSize()), VK_SHADER_STAGE_FRAGMENT_BIT);
+    simpleRenderSystem.createDescriptorSetPerFrame("clusterSsbo", frameRing.descriptorInfo(frameRing.getFrameSize()), VK_SHADER_STAGE_FRAGMENT_BIT);
+    simpleRenderSystem.createDescriptorSetPerFrame("clusterLightIndexSsbo", frameRing.descriptorInfo(frameRing.getFrameSize()), VK_SHADER_STAGE_FRAGMENT_BIT);
     simpleRenderSystem.finishCreateDescriptorSetPerFrame();
 
     pointLightSystem.createDescriptorSetPerFrame("ubo", globalUbo->descriptorInfo(), VK_SHADER_STAGE_VERTEX_BIT);
     pointLightSystem.finishCreateDescriptorSetPerFrame();
 
+    simpleRenderSystem.createDescriptorSetPerObject("instanceSsbo", frameRing.descriptorInfo(frameRing.getFrameSize()));
+    pointLightSystem.createDescriptorSetPerObject("lightSsbo", frameRing.descriptorInfo(frameRing.getFrameSize()));
+
     //=================================== update camera object .etc =================================
 
     EngineCore::Camera camera{};
     camera.setViewTarget(glm::vec3{-1.f, -2.f, 2.f}, glm::vec3{0.0f, 0.0f, 2.5f});
 
-    auto viewerObject = EngineCore::GameObject::createGameObject(lveDevice, descriptorAllocator, descriptorLayoutCache);
-    viewerObject.transform.translation.z = -2.5f;
+    const EngineCore::Entity viewerObject = registry.create();
+    registry.add<EngineCore::TransformComponent>(viewerObject).setTranslation({0.0f, 0.0f, -2.5f});
     EngineCore::KeyboardMovementController cameraController{};
 
-    auto currentTime = std::chrono::high_resolution_clock::now();
+    if(config.captureDir.empty() == false)
+    {
+        std::filesystem::create_directories(config.captureDir);
+    }
 
-    while(!myWindow.shouldClose())
+    // captured frames should show the real textures, not the placeholder
+    if(myWindow.isHeadless())
     {
-        glfwPollEvents();
+        textureManager.finishPendingUploads();
+    }
+
+    // with more than one thread the render pass is recorded into secondary cmd buffers
+    const bool parallelRecording = jobSystem.getThreadCount() > 1;
+    std::vector<VkCommandBuffer> secondaryCommandBuffers;
+
+    Vk::LveGpuProfiler& gpuProfiler = lveRenderer.getGpuProfiler();
+    float gpuProfileLogTimer = 0.0f;
 
+    auto currentTime = std::chrono::high_resolution_clock::now();
+    const auto startTime = currentTime;
+    uint32_t renderedFrames = 0;
+
+    while(!myWindow.shouldClose() && (config.frameCount == 0 || renderedFrames < config.frameCount))
+    {
+        // counts the previous frame, its zones are complete by now
+        Platform::CpuProfiler::markFrame();
+        CPU_ZONE("Frame");
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
         currentTime = newTime;
 
-        float fps = 1.0f / frameTime;
-        std::string title = std::string("hello vulkan!   FPS: ") + std::to_string(fps);
-        glfwSetWindowTitle(myWindow.getGLFWwindow(), title.c_str());
+        if(myWindow.isHeadless() == false)
+        {
+            glfwPollEvents();
+
+            float fps = 1.0f / frameTime;
+            std::string title = std::string("hello vulkan!   FPS: ") + std::to_string(fps);
+            glfwSetWindowTitle(myWindow.getGLFWwindow(), title.c_str());
 
-        cameraController.moveInPlaneXZ(myWindow.getGLFWwindow(), frameTime, viewerObject);
-        camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+            cameraController.moveInPlaneXZ(myWindow.getGLFWwindow(), frameTime, registry.get<EngineCore::TransformComponent>(viewerObject));
+        }
+        const auto& viewerTransform = registry.get<EngineCore::TransformComponent>(viewerObject);
+        camera.setViewYXZ(viewerTransform.getTranslation(), viewerTransform.getRotation());
+
+        // submits decoded textures and swaps in the ones whose upload finished, never waits
+        textureManager.update();
 
         float aspect = lveRenderer.getAspectRatio();
         camera.setPerspectiveProjection(glm::radians(50.0f), aspect, 0.1f, 1000.0f);
 
-        if(auto commandBuffer = lveRenderer.beginFrame())
+        VkCommandBuffer commandBuffer;
+        {
+            CPU_ZONE("LveRenderer::beginFrame");
+            commandBuffer = lveRenderer.beginFrame();
+        }
+        if(commandBuffer)
         {
             int frameIndex = lveRenderer.getFrameIndex();
+            frameRing.beginFrame(frameIndex);
             EngineCore::FrameInfo frameInfo
             {
                 frameIndex,
                 frameTime,
                 commandBuffer,
                 camera,
-                gameObjects
+                registry,
+                frameRing
             };
 
             // update
@@ -109,54 +166,153 @@ void FirstApp::run()
             ubo.projection = camera.getProjection();
             ubo.view = camera.getView();
             ubo.inverseView = camera.getInverseView();
-            pointLightSystem.update(frameInfo, ubo);
+            {
+                CPU_ZONE("PointLightSystem::update");
+                pointLightSystem.update(frameInfo);
+            }
+            // world matrices of everything that moved, the render systems only read them
+            transformSystem.update(registry);
+            pointLightSystem.writeLightClusters(frameInfo, ubo);
             globalUbo->writeToBuffer(&ubo);
 
-            // render
-            lveRenderer.beginSwapChainRenderPass(commandBuffer);
+            // gpu driven culling writes this frame's indirect draws, has to happen outside the render pass
+            if(simpleRenderSystem.isGpuDriven())
+            {
+                auto cullScope = gpuProfiler.beginScope(commandBuffer, "GpuCulling");
+                simpleRenderSystem.recordGpuCulling(frameInfo);
+                gpuProfiler.endScope(commandBuffer, cullScope);
+            }
 
-            // order matters
-            simpleRenderSystem.renderGameObjects(frameInfo);
-            pointLightSystem.render(frameInfo);
+            // render
+            if(parallelRecording)
+            {
+                lveRenderer.beginSwapChainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+                secondaryCommandBuffers.clear();
+
+                // the workers' secondaries execute in order between these two timestamps
+                VkCommandBuffer scopeCommandBuffer = lveRenderer.beginSecondaryCommandBuffer(0);
+                auto simpleScope = gpuProfiler.beginScope(scopeCommandBuffer, "SimpleRenderSystem");
+                lveRenderer.endSecondaryCommandBuffer(scopeCommandBuffer);
+                secondaryCommandBuffers.push_back(scopeCommandBuffer);
+
+                {
+                    CPU_ZONE("SimpleRenderSystem::renderGameObjects");
+                    simpleRenderSystem.renderGameObjectsParallel(frameInfo, lveRenderer, jobSystem, secondaryCommandBuffers);
+                }
+
+                // lights are few and blended back to front, record them last on the main thread
+                EngineCore::FrameInfo lightFrameInfo = frameInfo;
+                lightFrameInfo.commandBuffer = lveRenderer.beginSecondaryCommandBuffer(0);
+                gpuProfiler.endScope(lightFrameInfo.commandBuffer, simpleScope);
+                auto lightScope = gpuProfiler.beginScope(lightFrameInfo.commandBuffer, "PointLightSystem");
+                {
+                    CPU_ZONE("PointLightSystem::render");
+                    pointLightSystem.render(lightFrameInfo);
+                }
+                gpuProfiler.endScope(lightFrameInfo.commandBuffer, lightScope);
+                lveRenderer.endSecondaryCommandBuffer(lightFrameInfo.commandBuffer);
+                secondaryCommandBuffers.push_back(lightFrameInfo.commandBuffer);
+
+                vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+            }
+            else
+            {
+                lveRenderer.beginSwapChainRenderPass(commandBuffer);
+
+                // order matters
+                auto simpleScope = gpuProfiler.beginScope(commandBuffer, "SimpleRenderSystem");
+                {
+                    CPU_ZONE("SimpleRenderSystem::renderGameObjects");
+                    simpleRenderSystem.renderGameObjects(frameInfo);
+                }
+                gpuProfiler.endScope(commandBuffer, simpleScope);
+
+                auto lightScope = gpuProfiler.beginScope(commandBuffer, "PointLightSystem");
+                {
+                    CPU_ZONE("PointLightSystem::render");
+                    pointLightSystem.render(frameInfo);
+                }
+                gpuProfiler.endScope(commandBuffer, lightScope);
+            }
 
             lveRenderer.endSwapChainRenderPass(commandBuffer);
-            lveRenderer.endFrame();
+            {
+                CPU_ZONE("LveRenderer::endFrame");
+                lveRenderer.endFrame();
+            }
+
+            if(config.captureDir.empty() == false && lveRenderer.isHeadless())
+            {
+                char fileName[32];
+                std::snprintf(fileName, sizeof(fileName), "frame_%05u.ppm", renderedFrames);
+                CPU_ZONE("LveRenderer::saveLastFrame");
+                lveRenderer.saveLastFrame((std::filesystem::path(config.captureDir) / fileName).string());
+            }
+            renderedFrames++;
+        }
+
+        gpuProfileLogTimer += frameTime;
+        if(gpuProfileLogTimer >= GPU_PROFILE_LOG_INTERVAL)
+        {
+            gpuProfiler.printAverages();
+            if(simpleRenderSystem.isGpuDriven())
+            {
+                const auto& drawTable = simpleRenderSystem.getDrawTable();
+                printf("culling: on gpu, %u instances in %zu batches", drawTable.getInstanceCount(), drawTable.getBatches().size());
+            }
+            else
+            {
+                const auto& culling = simpleRenderSystem.getCullingStats();
+                printf("culling: %u visible, %u culled", culling.visible, culling.culled);
+            }
+            printf(" | transforms: %u rebuilt, %u objects uploaded | lights: %zu, %u cluster entries\n",
+                transformSystem.getUpdatedCount(), simpleRenderSystem.getUploadedCount(),
+                registry.getPool<EngineCore::PointLightComponent>().size(), pointLightSystem.getClusteredIndexCount());
+            gpuProfileLogTimer = 0.0f;
         }
 
     }
 
     vkDeviceWaitIdle(lveDevice.device());
+    // the run ended before traceFrames frames
+    Platform::CpuProfiler::endCapture();
+
+    float totalTime = std::chrono::duration<float, std::chrono::seconds::period>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    if(renderedFrames > 0)
+    {
+        printf("Rendered %u frames in %.3f s, average %.3f ms/frame (%.1f FPS)\n",
+            renderedFrames, totalTime, 1000.0f * totalTime / renderedFrames, renderedFrames / totalTime);
+    }
+    gpuProfiler.printAverages();
+    lveDevice.getAllocator().printStats();
 }
 
 void FirstApp::loadGameObjects()
 {
-    std::shared_ptr<EngineCore::Model> model = EngineCore::Model::createModelFromFile(lveDevice, textureManager, descriptorAllocator, descriptorLayoutCache, "./assets/models/flat_vase.obj", "./assets/textures/");
-    auto flatVase = EngineCore::GameObject::createGameObject(lveDevice, descriptorAllocator, descriptorLayoutCache);
-    flatVase.model = model;
-    flatVase.transform.translation = {-0.5f, 0.5f, 0.0f};
-    flatVase.transform.scale = glm::vec3{3.0f, 2.0f, 3.0f};
-    gameObjects.emplace(flatVase.getId(), std::move(flatVase));
-
-    model = EngineCore::Model::createModelFromFile(lveDevice, textureManager, descriptorAllocator, descriptorLayoutCache, "./assets/models/smooth_vase.obj", "./assets/textures/");
-    auto smoothVase = EngineCore::GameObject::createGameObject(lveDevice, descriptorAllocator, descriptorLayoutCache);
-    smoothVase.model = model;
-    smoothVase.transform.translation = {0.5f, 0.5f, 0.0f};
-    smoothVase.transform.scale = glm::vec3{3.0f, 2.0f, 3.0f};
-    gameObjects.emplace(smoothVase.getId(), std::move(smoothVase));
-
-    model = EngineCore::Model::createModelFromFile(lveDevice, textureManager, descriptorAllocator, descriptorLayoutCache, "./assets/models/quad.obj", "./assets/textures/");
-    auto floor = EngineCore::GameObject::createGameObject(lveDevice, descriptorAllocator, descriptorLayoutCache);
-    floor.model = model;
-    floor.transform.translation = {0.0f, 0.5f, 0.0f};
-    floor.transform.scale = glm::vec3{3.0f, 1.0f, 3.0f};
-    gameObjects.emplace(floor.getId(), std::move(floor));
-
-    model = EngineCore::Model::createModelFromFile(lveDevice, textureManager, descriptorAllocator, descriptorLayoutCache, "./assets/models/cube.obj", "./assets/textures/");
-    auto cube = EngineCore::GameObject::createGameObject(lveDevice, descriptorAllocator, descriptorLayoutCache);
-    cube.model = model;
-    cube.transform.translation = {0.0f, 0.0f, -1.0f};
-    cube.transform.scale = glm::vec3{0.25f, 0.25f, 0.25f};
-    gameObjects.emplace(cube.getId(), std::move(cube));
+    CPU_ZONE("FirstApp::loadGameObjects");
+    // one entity per placed mesh: a transform and the (shared) model
+    auto addMeshEntity = [this](std::shared_ptr<EngineCore::Model> model, glm::vec3 translation, glm::vec3 scale)
+    {
+        const EngineCore::Entity entity = registry.create();
+        auto& transform = registry.add<EngineCore::TransformComponent>(entity);
+        transform.setTranslation(translation);
+        transform.setScale(scale);
+        registry.add<EngineCore::ModelComponent>(entity, {std::move(model)});
+    };
+
+    std::shared_ptr<EngineCore::Model> model = EngineCore::Model::createModelFromFile(lveDevice, textureManager, descriptorAllocator, descriptorLayoutCache, "./assets/models/flat_vase.obj", "./assets/textures/", config.fullVertices == false);
+    addMeshEntity(model, {-0.5f, 0.5f, 0.0f}, glm::vec3{3.0f, 2.0f, 3.0f});
+
+    model = EngineCore::Model::createModelFromFile(lveDevice, textureManager, descriptorAllocator, descriptorLayoutCache, "./assets/models/smooth_vase.obj", "./assets/textures/", config.fullVertices == false);
+    addMeshEntity(model, {0.5f, 0.5f, 0.0f}, glm::vec3{3.0f, 2.0f, 3.0f});
+
+    model = EngineCore::Model::createModelFromFile(lveDevice, textureManager, descriptorAllocator, descriptorLayoutCache, "./assets/models/quad.obj", "./assets/textures/", config.fullVertices == false);
+    addMeshEntity(model, {0.0f, 0.5f, 0.0f}, glm::vec3{3.0f, 1.0f, 3.0f});
+
+    model = EngineCore::Model::createModelFromFile(lveDevice, textureManager, descriptorAllocator, descriptorLayoutCache, "./assets/models/cube.obj", "./assets/textures/", config.fullVertices == false);
+    addMeshEntity(model, {0.0f, 0.0f, -1.0f}, glm::vec3{0.25f, 0.25f, 0.25f});
 
 
     std::vector<glm::vec3> lightColors{
@@ -170,15 +326,13 @@ void FirstApp::loadGameObjects()
 
     for(int i=0; i < lightColors.size(); i++)
     {
-        auto pointLight = EngineCore::GameObject::makePointLight(lveDevice, descriptorAllocator, descriptorLayoutCache, 0.2f);
-        pointLight.color = lightColors[i];
+        const EngineCore::Entity pointLight = registry.createPointLight(0.2f, 0.1f, lightColors[i]);
         auto rotateLight = glm::rotate(
             glm::mat4(1.0f),
             (i * glm::two_pi<float>()) / lightColors.size(),
             {0.0f, -1.0f, 0.0f}
         );
-        pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.0f, -1.0f, -1.0f, 1.0f));
-        gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+        registry.get<EngineCore::TransformComponent>(pointLight).setTranslation(glm::vec3(rotateLight * glm::vec4(-1.0f, -1.0f, -1.0f, 1.0f)));
     }   
 
 
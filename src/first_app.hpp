@@ -3,20 +3,41 @@
 #include "Platform/my_window.hpp"
 #include "Vk/lve_device.hpp"
 #include "Vk/lve_renderer.hpp"
+#include "Vk/lve_ring_buffer.hpp"
 
-#include "EngineCore/game_object.hpp"
+#include "EngineCore/registry.hpp"
+#include "EngineCore/job_system.hpp"
 #include "EngineCore/texture_manager.hpp"
 
 // std
 #include <memory>
+#include <string>
+
+struct AppConfig
+{
+    bool headless = false;      // render into offscreen targets, no window / surface / swap chain
+    uint32_t frameCount = 0;    // stop after this many frames, 0 runs until the window closes
+    std::string captureDir;     // headless only: write every rendered frame as PPM into this directory
+    uint32_t recordingThreads = 0; // threads recording draw calls, 0 uses every core, 1 records inline on the main thread
+    bool pipelineStatistics = false;    // gpu profiler also counts primitives / shader invocations of the render pass
+    std::string tracePath;      // write a chrome trace of the cpu zones (loading + the first traceFrames frames) to this file
+    uint32_t traceFrames = 120;
+    bool cpuCulling = false;    // cull and record one draw per submesh on the cpu even when the gpu driven path is available
+    bool fullVertices = false;  // upload every mesh with 32 bit float vertices instead of letting it pick a compact format
+    uint32_t benchmarkTransforms = 0;   // run the transform kernel benchmark with this many transforms instead of the app
+    uint32_t benchmarkMeshOptimizer = 0; // run the mesh optimizer benchmark on a sphere grid of this size instead of the app
+};
 
 class FirstApp
 {
 public:
     static constexpr int WIDTH = 800;
     static constexpr int HEIGHT = 600;
+    static constexpr VkDeviceSize FRAME_RING_SIZE = 4 * 1024 * 1024; // transient data per frame in flight
+    static constexpr uint32_t MAX_OBJECTS = 16 * 1024;              // entity indices that can be drawn, sizes the persistent object buffer
+    static constexpr float GPU_PROFILE_LOG_INTERVAL = 2.0f;         // seconds between gpu timing logs
 
-    FirstApp();
+    FirstApp(const AppConfig& config = AppConfig{});
     ~FirstApp();
 
     FirstApp(const FirstApp&) = delete;
@@ -27,13 +48,17 @@ public:
 private:
     void loadGameObjects();
 
-    Platform::MyWindow myWindow{WIDTH, HEIGHT, "hello vulkan"};
+    AppConfig config;
+
+    Platform::MyWindow myWindow{WIDTH, HEIGHT, "hello vulkan", config.headless};
     Vk::LveDevice lveDevice{myWindow};
-    Vk::LveRenderer lveRenderer{myWindow, lveDevice};
+    EngineCore::JobSystem jobSystem{config.recordingThreads};
+    Vk::LveRenderer lveRenderer{myWindow, lveDevice, jobSystem.getThreadCount(), config.pipelineStatistics};
     EngineCore::TextureManager textureManager{lveDevice};
     Vk::DescriptorAllocator descriptorAllocator{lveDevice.device()};
     Vk::DescriptorLayoutCache descriptorLayoutCache{lveDevice.device()};
+    Vk::LveRingBuffer frameRing{lveDevice, FRAME_RING_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
 
-    EngineCore::GameObject::Map gameObjects;
+    EngineCore::Registry registry;
 
 };
\ No newline at end of file
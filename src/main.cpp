@@ -1,14 +1,107 @@
 #include "first_app.hpp"
+#include "EngineCore/mesh_optimizer.hpp"
+#include "EngineCore/transform_kernel.hpp"
 
 // std
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main()
+// usage: VulkanGameEngine [--headless] [--frames N] [--capture DIR] [--threads N] [--pipeline-stats] [--trace FILE] [--trace-frames N] [--cpu-culling] [--full-vertices]
+//        VulkanGameEngine --bench-transforms [N]
+//        VulkanGameEngine --bench-mesh-optimizer [N]
+static AppConfig parseCommandLine(int argc, char** argv)
+{
+    AppConfig config{};
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::strcmp(argv[i], "--headless") == 0)
+        {
+            config.headless = true;
+        }
+        else if(std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            config.frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+        {
+            config.captureDir = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            config.recordingThreads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(std::strcmp(argv[i], "--pipeline-stats") == 0)
+        {
+            config.pipelineStatistics = true;
+        }
+        else if(std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            config.tracePath = argv[++i];
+        }
+        else if(std::strcmp(argv[i], "--trace-frames") == 0 && i + 1 < argc)
+        {
+            config.traceFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if(std::strcmp(argv[i], "--cpu-culling") == 0)
+        {
+            config.cpuCulling = true;
+        }
+        else if(std::strcmp(argv[i], "--full-vertices") == 0)
+        {
+            config.fullVertices = true;
+        }
+        else if(std::strcmp(argv[i], "--bench-transforms") == 0)
+        {
+            config.benchmarkTransforms = 10000;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                // 0 would mean no benchmark and start the app
+                config.benchmarkTransforms = std::max<uint32_t>(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)), 1);
+            }
+        }
+        else if(std::strcmp(argv[i], "--bench-mesh-optimizer") == 0)
+        {
+            config.benchmarkMeshOptimizer = 128;
+            if(i + 1 < argc && argv[i + 1][0] != '-')
+            {
+                // 0 would mean no benchmark and start the app, the smallest grid is 2x2
+                config.benchmarkMeshOptimizer = std::max<uint32_t>(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)), 2);
+            }
+        }
+        else
+        {
+            throw std::invalid_argument(std::string("unknown argument: ") + argv[i]);
+        }
+    }
+
+    if(config.headless && config.frameCount == 0)
+    {
+        // a headless run has no window to close
+        config.frameCount = 100;
+    }
+    return config;
+}
+
+int main(int argc, char** argv)
 {
-    FirstApp app{};
     try {
+        const AppConfig config = parseCommandLine(argc, argv);
+        if(config.benchmarkTransforms > 0)
+        {
+            // cpu only, no window or device
+            EngineCore::TransformKernel::runBenchmark(config.benchmarkTransforms);
+            return EXIT_SUCCESS;
+        }
+        if(config.benchmarkMeshOptimizer > 0)
+        {
+            EngineCore::MeshOptimizer::runBenchmark(config.benchmarkMeshOptimizer);
+            return EXIT_SUCCESS;
+        }
+
+        FirstApp app{config};
         app.run();
     } catch (const std::exception &e) {
         std::cerr << e.what() << '\n';
@@ -16,4 +109,4 @@ int main()
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}